@@ -0,0 +1,49 @@
+;; Six digit packed BCD counter at $40-$42 (low byte first), incremented
+;; 51200 times. The emulator does not implement decimal mode, so digits
+;; are carried with binary arithmetic. Leaves the 16-bit sum of the low
+;; counter byte after every increment at $FE-$FF.
+;; checksum $C400
+$4000   LDAI #$00
+        STAZ $40
+        STAZ $41
+        STAZ $42
+        STAZ $FE
+        STAZ $FF
+        STAZ $13
+        LDAI #200
+        STAZ $12
+COUNT   JSR INCBCD
+        CLC
+        LDAZ $40
+        ADCZ $FE
+        STAZ $FE
+        LDAZ $FF
+        ADCI #$00
+        STAZ $FF
+        DECZ $13
+        BNE COUNT
+        DECZ $12
+        BNE COUNT
+        BRK
+INCBCD  LDXI #$00
+DIGIT   LDAZX $40
+        CLC
+        ADCI #$01
+        TAY
+        ANDI #$0F
+        CMPI #$0A
+        BNE KEEP
+        TYA
+        CLC
+        ADCI #$06
+        CMPI #$A0
+        BNE STORE
+        LDAI #$00
+        STAZX $40
+        INX
+        CPXI #$03
+        BNE DIGIT
+        RTS
+KEEP    TYA
+STORE   STAZX $40
+        RTS
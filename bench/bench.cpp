@@ -0,0 +1,85 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the shared benchmark scaffolding.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+#include "util.h"
+
+/**
+ * Return monotonic wall time in seconds.
+ */
+double bench_seconds()
+{
+    return clockSeconds();
+}
+
+/**
+ * Return monotonic wall time in microseconds.
+ */
+double bench_microseconds()
+{
+    return clockSeconds() * 1e6;
+}
+
+/**
+ * Return monotonic wall time in nanoseconds.
+ */
+double bench_nanoseconds()
+{
+    return clockSeconds() * 1e9;
+}
+
+/**
+ * Return the file name part of a path.
+ */
+const char* bench_name(const char* path)
+{
+    const char* slash = strrchr(path, '/');
+
+    return slash ? slash + 1 : path;
+}
+
+/**
+ * Assemble a program and save its initial state.
+ */
+int bench_load(const char* source, uint16_t start, MACHINE_STATE* initial)
+{
+    if (assemble(source) != 0)
+    {
+        fprintf(stderr, "Error: cannot assemble %s\n", source);
+        return 1;
+    }
+
+    reset(start);
+    saveState(initial);
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#ifndef _BENCH_H_
+#define _BENCH_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Scaffolding shared by the benchmarks: monotonic wall clock readings
+ *   (from clockSeconds in util.h) in the unit each benchmark reports,
+ *   and loading a program into a saved initial machine state.
+ *
+ */
+
+#include "l6502.h"
+
+/**
+ * Return monotonic wall time in seconds.
+ */
+double bench_seconds();
+
+/**
+ * Return monotonic wall time in microseconds.
+ */
+double bench_microseconds();
+
+/**
+ * Return monotonic wall time in nanoseconds.
+ */
+double bench_nanoseconds();
+
+/**
+ * Return the file name part of a path.
+ */
+const char* bench_name(const char* path);
+
+/**
+ * Assemble the source file, reset the machine to start at the given
+ * address and save that state, reporting a failure on stderr.
+ *
+ * @param source assembly source file
+ * @param start address execution begins at
+ * @param initial filled in with the machine state before the run
+ * @return int 0 on success; otherwise, 1
+ */
+int bench_load(const char* source, uint16_t start, MACHINE_STATE* initial);
+
+#endif
@@ -0,0 +1,57 @@
+;; Bubble sort of 256 pseudo-random bytes at $5000-$50FF, stopping early
+;; once a pass makes no swaps. The bytes come from a 16-bit Galois LFSR
+;; (taps $B400, seed $ACE1). Leaves a Fletcher checksum (sums modulo 256)
+;; of the sorted array at $FE-$FF.
+;; checksum $2FB5
+$4000   LDAI #$E1
+        STAZ $E0
+        LDAI #$AC
+        STAZ $E1
+        LDXI #$00
+FILL    JSR RAND
+        STAX $5000
+        INX
+        BNE FILL
+        LDAI #$FF
+        STAZ $12
+PASS    LDXI #$00
+        STXZ $13
+INNER   LDAX $5000
+        CMPX $5001
+        BCC NOSWAP
+        BEQ NOSWAP
+        TAY
+        LDAX $5001
+        STAX $5000
+        TYA
+        STAX $5001
+        INCZ $13
+NOSWAP  INX
+        CPXZ $12
+        BNE INNER
+        LDAZ $13
+        BEQ SORTED
+        DECZ $12
+        BNE PASS
+SORTED  LDAI #$00
+        STAZ $FE
+        STAZ $FF
+        TAX
+SUM     LDAX $5000
+        CLC
+        ADCZ $FE
+        STAZ $FE
+        CLC
+        ADCZ $FF
+        STAZ $FF
+        INX
+        BNE SUM
+        BRK
+RAND    LSRZ $E1
+        RORZ $E0
+        BCC RANDOK
+        LDAZ $E1
+        EORI #$B4
+        STAZ $E1
+RANDOK  LDAZ $E0
+        RTS
@@ -0,0 +1,58 @@
+;; CRC-16/CCITT-FALSE (polynomial $1021, initial value $FFFF), bit at a
+;; time, over 1K of pseudo-random bytes at $5000-$53FF. The bytes come
+;; from a 16-bit Galois LFSR (taps $B400, seed $ACE1). Leaves the CRC at
+;; $FE-$FF.
+;; checksum $409F
+$4000   LDAI #$E1
+        STAZ $E0
+        LDAI #$AC
+        STAZ $E1
+        LDAI #$00
+        STAZ $10
+        LDAI #$50
+        STAZ $11
+        LDXI #$04
+        LDYI #$00
+FILL    JSR RAND
+        STAIY $10
+        INY
+        BNE FILL
+        INCZ $11
+        DEX
+        BNE FILL
+        LDAI #$FF
+        STAZ $FE
+        STAZ $FF
+        LDAI #$50
+        STAZ $11
+        LDAI #$04
+        STAZ $12
+BYTE    LDAIY $10
+        EORZ $FF
+        STAZ $FF
+        LDXI #$08
+SHIFT   ASLZ $FE
+        ROLZ $FF
+        BCC NOXOR
+        LDAZ $FF
+        EORI #$10
+        STAZ $FF
+        LDAZ $FE
+        EORI #$21
+        STAZ $FE
+NOXOR   DEX
+        BNE SHIFT
+        INY
+        BNE BYTE
+        INCZ $11
+        DECZ $12
+        BNE BYTE
+        BRK
+RAND    LSRZ $E1
+        RORZ $E0
+        BCC RANDOK
+        LDAZ $E1
+        EORI #$B4
+        STAZ $E1
+RANDOK  LDAZ $E0
+        RTS
@@ -0,0 +1,81 @@
+;; CRC-32 (reflected polynomial $EDB88320, initial value and final XOR
+;; $FFFFFFFF), bit at a time, over 1K of pseudo-random bytes at
+;; $5000-$53FF. The bytes come from a 16-bit Galois LFSR (taps $B400,
+;; seed $ACE1). Leaves the CRC at $F0-$F3 and its two halves XORed
+;; together at $FE-$FF.
+;; checksum $34D5
+$4000   LDAI #$E1
+        STAZ $E0
+        LDAI #$AC
+        STAZ $E1
+        LDAI #$00
+        STAZ $10
+        LDAI #$50
+        STAZ $11
+        LDXI #$04
+        LDYI #$00
+FILL    JSR RAND
+        STAIY $10
+        INY
+        BNE FILL
+        INCZ $11
+        DEX
+        BNE FILL
+        LDAI #$FF
+        STAZ $F0
+        STAZ $F1
+        STAZ $F2
+        STAZ $F3
+        LDAI #$50
+        STAZ $11
+        LDAI #$04
+        STAZ $12
+BYTE    LDAIY $10
+        EORZ $F0
+        STAZ $F0
+        LDXI #$08
+SHIFT   LSRZ $F3
+        RORZ $F2
+        RORZ $F1
+        RORZ $F0
+        BCC NOXOR
+        LDAZ $F3
+        EORI #$ED
+        STAZ $F3
+        LDAZ $F2
+        EORI #$B8
+        STAZ $F2
+        LDAZ $F1
+        EORI #$83
+        STAZ $F1
+        LDAZ $F0
+        EORI #$20
+        STAZ $F0
+NOXOR   DEX
+        BNE SHIFT
+        INY
+        BNE BYTE
+        INCZ $11
+        DECZ $12
+        BNE BYTE
+        LDXI #$03
+FINAL   LDAZX $F0
+        EORI #$FF
+        STAZX $F0
+        DEX
+        BPL FINAL
+        LDAZ $F0
+        EORZ $F2
+        STAZ $FE
+        LDAZ $F1
+        EORZ $F3
+        STAZ $FF
+        BRK
+RAND    LSRZ $E1
+        RORZ $E0
+        BCC RANDOK
+        LDAZ $E1
+        EORI #$B4
+        STAZ $E1
+RANDOK  LDAZ $E0
+        RTS
@@ -0,0 +1,51 @@
+;; Insertion sort of 256 pseudo-random bytes at $5000-$50FF. The bytes
+;; come from a 16-bit Galois LFSR (taps $B400, seed $ACE1). Leaves a
+;; Fletcher checksum (sums modulo 256) of the sorted array at $FE-$FF.
+;; checksum $2FB5
+$4000   LDAI #$E1
+        STAZ $E0
+        LDAI #$AC
+        STAZ $E1
+        LDXI #$00
+FILL    JSR RAND
+        STAX $5000
+        INX
+        BNE FILL
+        LDXI #$01
+INSERT  LDAX $5000
+        STAZ $12
+        TXA
+        TAY
+SHIFT   LDAY $4FFF
+        CMPZ $12
+        BCC PLACE
+        BEQ PLACE
+        STAY $5000
+        DEY
+        BNE SHIFT
+PLACE   LDAZ $12
+        STAY $5000
+        INX
+        BNE INSERT
+        LDAI #$00
+        STAZ $FE
+        STAZ $FF
+        TAX
+SUM     LDAX $5000
+        CLC
+        ADCZ $FE
+        STAZ $FE
+        CLC
+        ADCZ $FF
+        STAZ $FF
+        INX
+        BNE SUM
+        BRK
+RAND    LSRZ $E1
+        RORZ $E0
+        BCC RANDOK
+        LDAZ $E1
+        EORI #$B4
+        STAZ $E1
+RANDOK  LDAZ $E0
+        RTS
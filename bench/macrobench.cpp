@@ -0,0 +1,226 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Macro workload benchmark. Assembles each program of the benchmark
+ *   corpus, runs it unthrottled to BRK for a fixed number of iterations
+ *   and reports emulated MIPS, emulated cycles per second and the
+ *   program's checksum.
+ *
+ *   Every program starts at $4000 and leaves a 16-bit checksum at
+ *   $FE (low) and $FF (high). A ";; checksum $xxxx" line in the source
+ *   gives the expected value; a mismatch fails the run.
+ *
+ *   Usage: macrobench [-i iterations] <source> [<source> ...]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "l6502.h"
+#include "bench.h"
+#include "util.h"
+
+/**
+ * Address every program starts at and address of its checksum.
+ */
+static const uint16_t kStart = 0x4000;
+static const uint16_t kChecksum = 0x00fe;
+
+/**
+ * Instruction limit for the counted run, which catches a program that
+ * never reaches BRK.
+ */
+static const uint64_t kMaxInstructions = 1ULL << 32;
+
+/**
+ * Read the expected checksum from the ";; checksum $xxxx" source header.
+ *
+ * @return int 0 if found, -1 if not
+ */
+static int expected(const char* source, uint16_t* checksum)
+{
+    FILE* fp = fopen(source, "r");
+    if (!fp) return -1;
+
+    char line[256];
+    int nStatus = -1;
+
+    while (fgets(line, sizeof line, fp))
+    {
+        char hex[8];
+
+        if (sscanf(line, ";; checksum $%7[0-9A-Fa-f]", hex) == 1)
+        {
+            for (char* p = hex; *p; p++) if (*p >= 'a') *p -= 'a' - 'A';
+            *checksum = getHex(hex);
+            nStatus = 0;
+            break;
+        }
+    }
+
+    fclose(fp);
+
+    return nStatus;
+}
+
+/**
+ * Return the checksum the last run left in memory.
+ */
+static uint16_t checksum()
+{
+    uint8_t bytes[2];
+
+    readBlock(kChecksum, bytes, sizeof bytes);
+
+    return (uint16_t)(bytes[1] << 8 | bytes[0]);
+}
+
+/**
+ * Benchmark one program.
+ *
+ * @return int 0 on success; otherwise, 1
+ */
+static int measure(const char* source, unsigned int iterations, MACHINE_STATE* initial,
+                   uint64_t* totalInstructions, double* totalElapsed)
+{
+    uint16_t want = 0;
+    const char* name = bench_name(source);
+
+    if (expected(source, &want) != 0)
+    {
+        fprintf(stderr, "Error: %s has no checksum line\n", source);
+        return 1;
+    }
+
+    if (bench_load(source, kStart, initial) != 0) return 1;
+
+    // One counted run gives the (fixed) instruction count per iteration
+    uint64_t instructions = 0;
+
+    while (brk() != 1)
+    {
+        step();
+
+        if (++instructions == kMaxInstructions)
+        {
+            fprintf(stderr, "Error: %s did not reach BRK\n", source);
+            return 1;
+        }
+    }
+
+    uint64_t cycleCount = cycles();
+    uint16_t got = checksum();
+    double elapsed = 0.0;
+
+    if (got != want)
+    {
+        printf("%-14s %12llu %12llu %10s %10s %10s  $%04X FAIL\n", name,
+            (unsigned long long)instructions, (unsigned long long)cycleCount,
+            "-", "-", "-", got);
+        return 1;
+    }
+
+    for (unsigned int i=0; i < iterations && got == want; i++)
+    {
+        loadState(initial);
+
+        double start = bench_seconds();
+        resume();
+        elapsed += bench_seconds() - start;
+
+        got = checksum();
+    }
+
+    double mips = instructions * iterations / elapsed / 1e6;
+    double mhz = cycleCount * iterations / elapsed / 1e6;
+
+    printf("%-14s %12llu %12llu %10.3f %10.2f %10.2f  $%04X %s\n", name,
+        (unsigned long long)instructions, (unsigned long long)cycleCount,
+        elapsed, mips, mhz, got, got == want ? "ok" : "FAIL");
+
+    *totalInstructions += instructions * iterations;
+    *totalElapsed += elapsed;
+
+    return got == want ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int iterations = 20;
+    int chOption;
+
+    while ((chOption = getopt(argc, argv, "i:h")) != -1)
+    {
+        switch (chOption)
+        {
+        case 'i':
+            iterations = (unsigned int)atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-i iterations] <source> [<source> ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc || iterations == 0)
+    {
+        fprintf(stderr, "Usage: %s [-i iterations] <source> [<source> ...]\n", argv[0]);
+        return 1;
+    }
+
+    MACHINE_STATE* initial = (MACHINE_STATE*)malloc(sizeof(MACHINE_STATE));
+    if (!initial) return 1;
+
+    initialize(0);
+
+    printf("%-14s %12s %12s %10s %10s %10s  %s\n", "program", "inst/iter",
+        "cycles/iter", "seconds", "MIPS", "MHz", "checksum");
+
+    int nStatus = 0;
+    uint64_t totalInstructions = 0;
+    double totalElapsed = 0.0;
+
+    for (int arg=optind; arg < argc; arg++)
+    {
+        if (measure(argv[arg], iterations, initial, &totalInstructions, &totalElapsed) != 0)
+        {
+            nStatus = 1;
+        }
+    }
+
+    if (totalElapsed > 0.0)
+    {
+        printf("%-14s %12s %12s %10.3f %10.2f\n", "total", "", "", totalElapsed,
+            totalInstructions / totalElapsed / 1e6);
+    }
+
+    cleanup();
+    free(initial);
+
+    return nStatus;
+}
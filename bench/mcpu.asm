@@ -0,0 +1,12 @@
+;; Multi-CPU benchmark workload. Each core spins on private memory and
+;; bumps a counter in the shared window once every 256 iterations. The
+;; loop never terminates; the benchmark stops it with a cycle limit.
+$4000   LDXI #$00
+loop    LDAZ $10
+        ADCI #$01
+        STAZ $10
+        STAX $3000
+        INX
+        BNE loop
+        INCA $0200
+        JMP loop
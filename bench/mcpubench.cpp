@@ -0,0 +1,118 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Multi-CPU scaling benchmark. Runs the same workload on 1, 2, 4, ...
+ *   cores up to the host's hardware concurrency and reports aggregate
+ *   emulated MHz and parallel efficiency relative to a single core.
+ *
+ *   Usage: mcpubench <source> [<cycles per core>] [<quantum>]
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#include "l6502.h"
+#include "bench.h"
+#include "multicpu.h"
+
+/**
+ * Run the workload on the given number of cores, returning aggregate
+ * emulated MHz or a negative value on failure.
+ */
+static double measure(const char* source, unsigned int count,
+                      uint64_t maxCycles, unsigned int quantum)
+{
+    CORE_DESCRIPTOR cores[kMaxCores];
+
+    for (unsigned int core=0; core < count; core++)
+    {
+        cores[core].source = source;
+        cores[core].object = 0;
+        cores[core].address = 0x4000;
+        cores[core].cycles = 0;
+        cores[core].halted = false;
+    }
+
+    double start = bench_seconds();
+    int nStatus = multicpu_run(cores, count, 0x0200, 0x02ff, quantum, maxCycles);
+    double elapsed = bench_seconds() - start;
+
+    // The workload never halts, so the cycle limit is the normal stop
+    if (nStatus != 0 && nStatus != ETIMEDOUT) return -1.0;
+
+    uint64_t total = 0;
+    for (unsigned int core=0; core < count; core++) total += cores[core].cycles;
+
+    return total / elapsed / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <source> [<cycles per core>] [<quantum>]\n", argv[0]);
+        return 1;
+    }
+
+    const char* source = argv[1];
+    uint64_t maxCycles = (argc > 2) ? strtoull(argv[2], 0, 10) : 20000000;
+    unsigned int quantum = (argc > 3) ? (unsigned int)atoi(argv[3]) : 10000;
+    unsigned int hardware = std::thread::hardware_concurrency();
+
+    if (hardware == 0) hardware = 1;
+    if (hardware > kMaxCores) hardware = kMaxCores;
+
+    initialize(0);
+
+    printf("%6s %12s %10s %10s\n", "cores", "MHz", "speedup", "efficiency");
+
+    double base = 0.0;
+
+    for (unsigned int count=1; ; count *= 2)
+    {
+        if (count > hardware) count = hardware;
+
+        double mhz = measure(source, count, maxCycles, quantum);
+
+        if (mhz < 0.0)
+        {
+            fprintf(stderr, "Error: run with %u cores failed\n", count);
+            return 1;
+        }
+
+        if (count == 1) base = mhz;
+
+        printf("%6u %12.2f %10.2f %9.0f%%\n", count, mhz, mhz / base, 100.0 * mhz / base / count);
+
+        if (count == hardware) break;
+    }
+
+    cleanup();
+
+    return 0;
+}
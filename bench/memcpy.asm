@@ -0,0 +1,76 @@
+;; Block copy through indirect indexed pointers. Fills $5000-$5FFF with
+;; pseudo-random bytes from a 16-bit Galois LFSR (taps $B400, seed
+;; $ACE1), then copies the 4K block to $6000 and back eight times.
+;; Leaves a Fletcher checksum (sums modulo 256) of $6000-$6FFF at $FE-$FF.
+;;
+;; Source pointer $10-$11, destination pointer $14-$15.
+;; checksum $E82E
+$4000   LDAI #$E1
+        STAZ $E0
+        LDAI #$AC
+        STAZ $E1
+        LDAI #$00
+        STAZ $10
+        STAZ $14
+        LDAI #$50
+        STAZ $11
+        LDXI #$10
+        LDYI #$00
+FILL    JSR RAND
+        STAIY $10
+        INY
+        BNE FILL
+        INCZ $11
+        DEX
+        BNE FILL
+        LDAI #$08
+        STAZ $12
+TRIP    LDAI #$50
+        STAZ $11
+        LDAI #$60
+        STAZ $15
+        JSR COPY
+        LDAI #$60
+        STAZ $11
+        LDAI #$50
+        STAZ $15
+        JSR COPY
+        DECZ $12
+        BNE TRIP
+        LDAI #$00
+        STAZ $FE
+        STAZ $FF
+        LDAI #$60
+        STAZ $11
+        LDXI #$10
+SUM     LDAIY $10
+        CLC
+        ADCZ $FE
+        STAZ $FE
+        CLC
+        ADCZ $FF
+        STAZ $FF
+        INY
+        BNE SUM
+        INCZ $11
+        DEX
+        BNE SUM
+        BRK
+COPY    LDXI #$10
+COPYPG  LDAIY $10
+        STAIY $14
+        INY
+        BNE COPYPG
+        INCZ $11
+        INCZ $15
+        DEX
+        BNE COPYPG
+        RTS
+RAND    LSRZ $E1
+        RORZ $E0
+        BCC RANDOK
+        LDAZ $E1
+        EORI #$B4
+        STAZ $E1
+RANDOK  LDAZ $E0
+        RTS
@@ -0,0 +1,20 @@
+;; Memory-heavy workload for the scaling benchmark. Sweeps every byte of
+;; $0200-$FFFF outside the code page $40, XORing it with a running value
+;; so each access is a read and a write.
+$4000   LDAI #$00
+        STAZ $10
+        LDAI #$02
+        STAZ $11
+        LDYI #$00
+PAGE    LDAZ $11
+        CMPI #$40
+        BEQ NEXT
+TOUCH   TXA
+        EORIY $10
+        STAIY $10
+        INX
+        INY
+        BNE TOUCH
+NEXT    INCZ $11
+        BNE PAGE
+        BRK
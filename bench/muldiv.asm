@@ -0,0 +1,116 @@
+;; 16-bit multiply and divide, extending the 8-bit divide in sample2.asm.
+;; For 256 pairs of pseudo-random words A and B, taken from successive
+;; states of a 16-bit Galois LFSR (taps $B400, seed $ACE1), computes the
+;; 32-bit product P = A * B by shift and add, then divides the word
+;; A XOR P(low) by D = (B >> 1) OR 1 by restoring division. Leaves the
+;; 16-bit sum of P(low), P(high), quotient and remainder over all pairs
+;; at $FE-$FF.
+;;
+;; Multiplier $20-$21, multiplicand $22-$23, product $24-$27,
+;; dividend and quotient $30-$31, divisor $32-$33, remainder $34-$35.
+;; checksum $F061
+$4000   LDAI #$E1
+        STAZ $E0
+        LDAI #$AC
+        STAZ $E1
+        LDAI #$00
+        STAZ $FE
+        STAZ $FF
+        STAZ $12
+PAIR    JSR RAND
+        STAZ $20
+        STAZ $30
+        LDAZ $E1
+        STAZ $21
+        STAZ $31
+        JSR RAND
+        STAZ $22
+        LDAZ $E1
+        STAZ $23
+        LSR
+        STAZ $33
+        LDAZ $22
+        ROR
+        ORAI #$01
+        STAZ $32
+        LDAI #$00
+        STAZ $26
+        STAZ $27
+        LDXI #$10
+MULBIT  LSRZ $21
+        RORZ $20
+        BCC MULSKIP
+        CLC
+        LDAZ $26
+        ADCZ $22
+        STAZ $26
+        LDAZ $27
+        ADCZ $23
+        STAZ $27
+MULSKIP RORZ $27
+        RORZ $26
+        RORZ $25
+        RORZ $24
+        DEX
+        BNE MULBIT
+        LDAZ $30
+        EORZ $24
+        STAZ $30
+        LDAZ $31
+        EORZ $25
+        STAZ $31
+        LDAI #$00
+        STAZ $34
+        STAZ $35
+        LDXI #$10
+DIVBIT  ASLZ $30
+        ROLZ $31
+        ROLZ $34
+        ROLZ $35
+        LDAZ $35
+        CMPZ $33
+        BCC DIVSKIP
+        BNE DIVSUB
+        LDAZ $34
+        CMPZ $32
+        BCC DIVSKIP
+DIVSUB  SEC
+        LDAZ $32
+        EORI #$FF
+        ADCZ $34
+        STAZ $34
+        LDAZ $33
+        EORI #$FF
+        ADCZ $35
+        STAZ $35
+        INCZ $30
+DIVSKIP DEX
+        BNE DIVBIT
+        LDXI #$24
+        JSR ADDSUM
+        LDXI #$26
+        JSR ADDSUM
+        LDXI #$30
+        JSR ADDSUM
+        LDXI #$34
+        JSR ADDSUM
+        DECZ $12
+        BEQ DONE
+        JMP PAIR
+DONE    BRK
+ADDSUM  CLC
+        LDAZX $00
+        ADCZ $FE
+        STAZ $FE
+        LDAZX $01
+        ADCZ $FF
+        STAZ $FF
+        RTS
+RAND    LSRZ $E1
+        RORZ $E0
+        BCC RANDOK
+        LDAZ $E1
+        EORI #$B4
+        STAZ $E1
+RANDOK  LDAZ $E0
+        RTS
@@ -0,0 +1,529 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Per-opcode microbenchmark. For every implemented opcode a tight loop
+ *   of unrolled copies of the instruction is generated, with separate
+ *   cases for indexed accesses that do and do not cross a page and for
+ *   branches that are and are not taken. Each loop is stepped for a fixed
+ *   instruction budget several times and host nanoseconds per emulated
+ *   instruction are reported with the spread across repetitions.
+ *
+ *   Results can be written as JSON and compared against an earlier run.
+ *
+ *   Usage: opbench [-r reps] [-n instructions] [-f filter] [-o json]
+ *                  [-b baseline json] [-t percent]
+ *
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "l6502.h"
+#include "bench.h"
+#include "profile.h"
+#include "json.h"
+
+/**
+ * Loop body location and size. The body is followed by JMP to its start.
+ */
+static const uint16_t kBody = 0x4000;
+static const unsigned int kCopies = 512;
+
+/**
+ * Operand locations. Absolute data lives at kData, zero page data at
+ * kZeroPage and the indirect pointers at kPointer (near) and
+ * kPointer+2 (page crossing when indexed by kCrossIndex).
+ */
+static const uint16_t kData = 0x3000;
+static const uint8_t kZeroPage = 0x10;
+static const uint8_t kPointer = 0x80;
+static const uint16_t kJumpTable = 0x2000;
+static const uint8_t kCrossIndex = 0x20;
+static const uint16_t kReturn = 0xea10;
+
+/**
+ * A generated benchmark loop and its results.
+ */
+typedef struct
+{
+    std::string name;     // Instruction symbol plus variant, e.g. LDAX/cross
+    uint8_t opcode;
+    MACHINE_STATE* state; // Machine state the loop starts from
+    double mean;          // Mean ns per instruction
+    double stddev;        // Standard deviation across repetitions
+    double best;          // Fastest repetition
+} BENCH_CASE;
+
+/**
+ * Set a flag in both the flag array and the status register.
+ */
+static void setFlag(MACHINE_STATE* state, unsigned int index, uint8_t mask, bool value)
+{
+    state->flags[index] = value ? 1 : 0;
+    if (value) state->p |= mask; else state->p &= ~mask;
+}
+
+/**
+ * Set the flag tested by a branch opcode so the branch goes the
+ * requested way. Returns false if symbol is not a branch.
+ */
+static bool setBranch(MACHINE_STATE* state, const char* symbol, bool taken)
+{
+    static const struct { const char* symbol; unsigned int index; uint8_t mask; bool set; } branches[] =
+    {
+        { "BCC", 0, 0x01, false }, { "BCS", 0, 0x01, true },
+        { "BNE", 1, 0x02, false }, { "BEQ", 1, 0x02, true },
+        { "BVC", 5, 0x40, false }, { "BVS", 5, 0x40, true },
+        { "BPL", 6, 0x80, false }, { "BMI", 6, 0x80, true },
+    };
+
+    for (unsigned int i=0; i < sizeof branches / sizeof branches[0]; i++)
+    {
+        if (strcmp(symbol, branches[i].symbol) == 0)
+        {
+            setFlag(state, branches[i].index, branches[i].mask,
+                    taken ? branches[i].set : !branches[i].set);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Build the starting machine state for one opcode. Indexed modes use
+ * cross to select a page crossing effective address; branches use cross
+ * to select the taken outcome.
+ */
+static MACHINE_STATE* build(uint8_t opcode, const char* symbol, uint8_t bytes, bool cross)
+{
+    MACHINE_STATE* state = (MACHINE_STATE*)calloc(1, sizeof(MACHINE_STATE));
+    if (!state) return 0;
+
+    uint8_t* memory = state->memory;
+
+    state->pc = kBody;
+    state->sp = 0xff;
+    state->p = 0x20;
+
+    memory[kPointer] = kData & 0xff;
+    memory[kPointer+1] = kData >> 8;
+    memory[kPointer+2] = 0xf0;
+    memory[kPointer+3] = kData >> 8;
+
+    ADDRESSING_MODE mode = profile_addressing(opcode);
+    uint16_t base = cross ? (uint16_t)(kData + 0xf0) : kData;
+
+    state->x = state->y = cross ? kCrossIndex : 1;
+
+    uint16_t ip = kBody;
+
+    for (unsigned int copy=0; copy < kCopies; copy++)
+    {
+        // Pops are paired with a matching push so the stack never wraps,
+        // and the time is averaged over the pair. RTS and RTI are reached
+        // through JSR $EA10, which leaves the return address on the $EA
+        // byte: RTS resumes after it while PHP; RTI resumes on it and
+        // executes it as NOP.
+        if (opcode == 0x68 || opcode == 0x28)
+        {
+            memory[ip++] = opcode - 0x20;
+        }
+        else if (opcode == 0x60 || opcode == 0x40)
+        {
+            memory[ip] = 0x20;
+            memory[ip+1] = kReturn & 0xff;
+            memory[ip+2] = kReturn >> 8;
+            memory[kReturn] = (opcode == 0x40) ? 0x08 : opcode;
+            memory[kReturn+1] = opcode;
+            ip += 3;
+            continue;
+        }
+
+        uint16_t next = ip + bytes;
+
+        memory[ip] = opcode;
+
+        switch (mode)
+        {
+        case kModeImmediate:
+            memory[ip+1] = 0x01;
+            break;
+        case kModeZeroPage:
+        case kModeZeroPageX:
+        case kModeZeroPageY:
+            memory[ip+1] = kZeroPage;
+            break;
+        case kModeAbsolute:
+            // JMP and JSR continue with the next copy
+            if (opcode == 0x4c || opcode == 0x20)
+            {
+                memory[ip+1] = next & 0xff;
+                memory[ip+2] = next >> 8;
+            }
+            else
+            {
+                memory[ip+1] = kData & 0xff;
+                memory[ip+2] = kData >> 8;
+            }
+            break;
+        case kModeAbsoluteX:
+        case kModeAbsoluteY:
+            memory[ip+1] = base & 0xff;
+            memory[ip+2] = base >> 8;
+            break;
+        case kModeIndirect:
+            memory[kJumpTable + 2*copy] = next & 0xff;
+            memory[kJumpTable + 2*copy + 1] = next >> 8;
+            memory[ip+1] = (kJumpTable + 2*copy) & 0xff;
+            memory[ip+2] = (kJumpTable + 2*copy) >> 8;
+            break;
+        case kModeIndexedIndirect:
+            state->x = 0;
+            memory[ip+1] = kPointer;
+            break;
+        case kModeIndirectIndexed:
+            memory[ip+1] = cross ? kPointer+2 : kPointer;
+            break;
+        case kModeRelative:
+            memory[ip+1] = 0x00;
+            break;
+        default:
+            break;
+        }
+
+        ip = next;
+    }
+
+    memory[ip] = 0x4c;
+    memory[ip+1] = kBody & 0xff;
+    memory[ip+2] = kBody >> 8;
+
+    setBranch(state, symbol, cross);
+
+    return state;
+}
+
+/**
+ * Generate the benchmark cases for every implemented opcode whose
+ * symbol contains filter.
+ */
+static void generate(std::vector<BENCH_CASE>& cases, const char* filter)
+{
+    for (unsigned int opcode=0; opcode < 256; opcode++)
+    {
+        const char* symbol;
+        uint8_t bytes;
+
+        if (!opcodeInfo(opcode, &symbol, 0, &bytes, 0)) continue;
+
+        // BRK stops the machine without advancing
+        if (opcode == 0x00) continue;
+
+        if (filter && !strstr(symbol, filter)) continue;
+
+        ADDRESSING_MODE mode = profile_addressing(opcode);
+        bool bVariants = false;
+        const char* variants[2] = { "", "" };
+
+        if (mode == kModeAbsoluteX || mode == kModeAbsoluteY || mode == kModeIndirectIndexed)
+        {
+            bVariants = true;
+            variants[0] = "/same";
+            variants[1] = "/cross";
+        }
+        else if (opcode == 0x68 || opcode == 0x28 || opcode == 0x60 || opcode == 0x40)
+        {
+            variants[0] = "/pair";
+        }
+        else if (mode == kModeRelative)
+        {
+            bVariants = true;
+            variants[0] = "/not";
+            variants[1] = "/taken";
+        }
+
+        for (unsigned int variant=0; variant < (bVariants ? 2u : 1u); variant++)
+        {
+            BENCH_CASE bench;
+
+            bench.name = std::string(symbol) + variants[variant];
+            bench.opcode = opcode;
+            bench.state = build(opcode, symbol, bytes, variant == 1);
+            bench.mean = bench.stddev = bench.best = 0.0;
+
+            if (bench.state) cases.push_back(bench);
+        }
+    }
+}
+
+/**
+ * Step a case for reps repetitions of count instructions each.
+ *
+ * @return int 0 on success; EFAULT if the loop escaped its body
+ */
+static int measure(BENCH_CASE& bench, unsigned int reps, unsigned int count)
+{
+    std::vector<double> samples;
+
+    loadState(bench.state);
+
+    // Warm up caches and branch predictors
+    for (unsigned int i=0; i < count / 10; i++) step();
+
+    for (unsigned int rep=0; rep < reps; rep++)
+    {
+        double start = bench_nanoseconds();
+        for (unsigned int i=0; i < count; i++) step();
+        samples.push_back((bench_nanoseconds() - start) / count);
+    }
+
+    uint16_t address = pc();
+
+    if ((address < kBody || address > kBody + kCopies * 3) &&
+        address != kReturn && address != kReturn + 1) return EFAULT;
+
+    double sum = 0.0;
+    bench.best = samples[0];
+
+    for (unsigned int i=0; i < samples.size(); i++)
+    {
+        sum += samples[i];
+        if (samples[i] < bench.best) bench.best = samples[i];
+    }
+
+    bench.mean = sum / samples.size();
+
+    double squares = 0.0;
+    for (unsigned int i=0; i < samples.size(); i++)
+    {
+        squares += (samples[i] - bench.mean) * (samples[i] - bench.mean);
+    }
+
+    bench.stddev = samples.size() > 1 ? sqrt(squares / (samples.size() - 1)) : 0.0;
+
+    return 0;
+}
+
+/**
+ * Read mean ns per instruction by case name from a JSON results file.
+ *
+ * @return int 0 on success; otherwise, error number
+ */
+static int readBaseline(const char* filename, std::map<std::string, double>& baseline)
+{
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) return errno;
+
+    std::string text;
+    char buffer[4096];
+    size_t length;
+
+    while ((length = fread(buffer, 1, sizeof buffer, fp)) > 0) text.append(buffer, length);
+    fclose(fp);
+
+    JsonValue root;
+    if (!json_parse(text.c_str(), root)) return EINVAL;
+
+    const JsonValue* results = root.find("results");
+    if (!results || results->type != kJsonArray) return EINVAL;
+
+    for (unsigned int i=0; i < results->items.size(); i++)
+    {
+        const JsonValue* name = results->items[i].find("name");
+        const JsonValue* ns = results->items[i].find("ns");
+
+        if (name && ns && name->type == kJsonString && ns->type == kJsonNumber)
+        {
+            baseline[name->string] = ns->number;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Write the results as JSON.
+ *
+ * @return int 0 on success; otherwise, error number
+ */
+static int writeJson(const char* filename, const std::vector<BENCH_CASE>& cases,
+                     unsigned int reps, unsigned int count)
+{
+    FILE* fp = fopen(filename, "w");
+    if (!fp) return errno;
+
+    fprintf(fp, "{\"repetitions\":%u,\"instructions\":%u,\"results\":[", reps, count);
+
+    for (unsigned int i=0; i < cases.size(); i++)
+    {
+        const BENCH_CASE& bench = cases[i];
+        std::string name;
+
+        json_quote(name, bench.name.c_str());
+
+        fprintf(fp, "%s\n{\"name\":%s,\"opcode\":%u,\"mode\":\"%s\",\"ns\":%.3f,\"stddev\":%.3f,\"min\":%.3f}",
+            i ? "," : "", name.c_str(), bench.opcode, profile_mode(bench.opcode),
+            bench.mean, bench.stddev, bench.best);
+    }
+
+    fprintf(fp, "\n]}\n");
+
+    return fclose(fp) == 0 ? 0 : errno;
+}
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-r reps] [-n instructions] [-f filter] [-o json] [-b baseline] [-t percent]\n", name);
+    fprintf(stderr, "  -r  repetitions per opcode (default 5)\n");
+    fprintf(stderr, "  -n  instructions stepped per repetition (default 200000)\n");
+    fprintf(stderr, "  -f  only benchmark symbols containing filter, e.g. LDA\n");
+    fprintf(stderr, "  -o  write results as JSON\n");
+    fprintf(stderr, "  -b  compare against a JSON file written by -o\n");
+    fprintf(stderr, "  -t  exit 1 if any case is slower than the baseline by more than percent\n");
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int reps = 5;
+    unsigned int count = 200000;
+    const char* filter = 0;
+    const char* output = 0;
+    const char* baselineName = 0;
+    double threshold = 0.0;
+    int chOption;
+
+    while ((chOption = getopt(argc, argv, "r:n:f:o:b:t:h")) != -1)
+    {
+        switch (chOption)
+        {
+        case 'r': reps = (unsigned int)atoi(optarg); break;
+        case 'n': count = (unsigned int)atoi(optarg); break;
+        case 'f': filter = optarg; break;
+        case 'o': output = optarg; break;
+        case 'b': baselineName = optarg; break;
+        case 't': threshold = atof(optarg); break;
+        default: usage(argv[0]); return 1;
+        }
+    }
+
+    if (reps == 0 || count == 0)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    std::map<std::string, double> baseline;
+
+    if (baselineName)
+    {
+        int nError = readBaseline(baselineName, baseline);
+
+        if (nError != 0)
+        {
+            fprintf(stderr, "Error: cannot read baseline %s (%s)\n", baselineName, strerror(nError));
+            return 1;
+        }
+    }
+
+    initialize(0);
+
+    std::vector<BENCH_CASE> cases;
+    generate(cases, filter);
+
+    printf("%-12s %-18s %10s %10s %10s", "case", "mode", "ns/inst", "stddev", "min");
+    if (baselineName) printf(" %10s", "delta");
+    printf("\n");
+
+    int nStatus = 0;
+    unsigned int regressions = 0;
+
+    for (unsigned int i=0; i < cases.size(); i++)
+    {
+        BENCH_CASE& bench = cases[i];
+
+        if (measure(bench, reps, count) != 0)
+        {
+            fprintf(stderr, "Error: %s left its loop\n", bench.name.c_str());
+            free(bench.state);
+            cases.erase(cases.begin() + i--);
+            nStatus = 1;
+            continue;
+        }
+
+        printf("%-12s %-18s %10.2f %10.2f %10.2f", bench.name.c_str(),
+            profile_mode(bench.opcode), bench.mean, bench.stddev, bench.best);
+
+        if (baselineName)
+        {
+            std::map<std::string, double>::const_iterator it = baseline.find(bench.name);
+
+            if (it != baseline.end() && it->second > 0.0)
+            {
+                double delta = 100.0 * (bench.mean - it->second) / it->second;
+
+                printf(" %+9.1f%%", delta);
+
+                if (threshold > 0.0 && delta > threshold) regressions++;
+            }
+            else
+            {
+                printf(" %10s", "new");
+            }
+        }
+
+        printf("\n");
+    }
+
+    if (output)
+    {
+        int nError = writeJson(output, cases, reps, count);
+
+        if (nError != 0)
+        {
+            fprintf(stderr, "Error: cannot write %s (%s)\n", output, strerror(nError));
+            nStatus = 1;
+        }
+    }
+
+    if (regressions)
+    {
+        fprintf(stderr, "%u cases slower than baseline by more than %.1f%%\n", regressions, threshold);
+        nStatus = 1;
+    }
+
+    for (unsigned int i=0; i < cases.size(); i++) free(cases[i].state);
+
+    cleanup();
+
+    return nStatus;
+}
@@ -0,0 +1,191 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Reset benchmark. Runs each program from $4000 to BRK, then puts the
+ *   machine back to its state before the run, the way a test harness or
+ *   fuzzer does between cases. Reports the pages the program wrote and
+ *   the mean time per reset for a full 64K copy (loadState) and for a
+ *   copy of only the dirty pages (restoreState). Only the reset is timed;
+ *   the cost of reading the clock is measured and subtracted.
+ *
+ *   Usage: resetbench [-n resets] <source> [<source> ...]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "l6502.h"
+#include "bench.h"
+
+/**
+ * Address every program starts at
+ */
+static const uint16_t kStart = 0x4000;
+
+/**
+ * Cycle limit for one run, which catches a program that never reaches BRK
+ */
+static const uint64_t kMaxCycles = 100000000;
+
+/**
+ * Return the mean cost of one pair of clock reads in nanoseconds.
+ */
+static double clockOverhead(unsigned int resets)
+{
+    double total = 0.0;
+
+    for (unsigned int i=0; i < resets; i++)
+    {
+        double start = bench_nanoseconds();
+        total += bench_nanoseconds() - start;
+    }
+
+    return total / resets;
+}
+
+/**
+ * Run the program and time the reset that follows, returning the mean
+ * nanoseconds per reset or a negative value if a run failed.
+ */
+static double measure(const MACHINE_STATE* initial, unsigned int resets, bool bDirty)
+{
+    double total = 0.0;
+
+    for (unsigned int i=0; i < resets; i++)
+    {
+        if (runFor(kStart, kMaxCycles) != 0) return -1.0;
+
+        double start = bench_nanoseconds();
+
+        if (bDirty) restoreState(initial);
+        else loadState(initial);
+
+        total += bench_nanoseconds() - start;
+    }
+
+    return total / resets;
+}
+
+/**
+ * Benchmark one program.
+ *
+ * @return int 0 on success; otherwise, 1
+ */
+static int benchmark(const char* source, unsigned int resets, double overhead,
+                     MACHINE_STATE* initial, MACHINE_STATE* after)
+{
+    const char* name = bench_name(source);
+
+    if (bench_load(source, kStart, initial) != 0) return 1;
+
+    if (runFor(kStart, kMaxCycles) != 0)
+    {
+        fprintf(stderr, "Error: %s did not reach BRK\n", source);
+        return 1;
+    }
+
+    unsigned int pages = dirtyPages();
+
+    // A dirty page reset must leave exactly what a full one does
+    restoreState(initial);
+    saveState(after);
+    loadState(initial);
+
+    bool bSame = memcmp(initial, after, sizeof *initial) == 0;
+
+    double full = measure(initial, resets, false) - overhead;
+    double dirty = measure(initial, resets, true) - overhead;
+
+    if (full < 0.0 || dirty < 0.0)
+    {
+        fprintf(stderr, "Error: %s did not reach BRK\n", source);
+        return 1;
+    }
+
+    if (full < 1.0) full = 1.0;
+    if (dirty < 1.0) dirty = 1.0;
+
+    printf("%-14s %6u %12.1f %12.1f %9.1fx %s\n", name, pages, full, dirty,
+        full / dirty, bSame ? "ok" : "FAIL");
+
+    return bSame ? 0 : 1;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int resets = 1000;
+    int chOption;
+
+    while ((chOption = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (chOption)
+        {
+        case 'n':
+            resets = (unsigned int)atoi(optarg);
+            break;
+        case 'h':
+        default:
+            fprintf(stderr, "Usage: %s [-n resets] <source> [<source> ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc || resets == 0)
+    {
+        fprintf(stderr, "Usage: %s [-n resets] <source> [<source> ...]\n", argv[0]);
+        return 1;
+    }
+
+    initialize(0);
+
+    MACHINE_STATE* initial = (MACHINE_STATE*)calloc(1, sizeof(MACHINE_STATE));
+    MACHINE_STATE* after = (MACHINE_STATE*)calloc(1, sizeof(MACHINE_STATE));
+
+    if (!initial || !after)
+    {
+        fprintf(stderr, "Error: out of memory\n");
+        return 1;
+    }
+
+    double overhead = clockOverhead(resets);
+    int nStatus = 0;
+
+    printf("%u resets per program, clock overhead %.1f ns subtracted\n", resets, overhead);
+    printf("%-14s %6s %12s %12s %10s\n", "program", "pages", "full ns", "dirty ns", "speedup");
+
+    for (int i=optind; i < argc; i++)
+    {
+        nStatus |= benchmark(argv[i], resets, overhead, initial, after);
+    }
+
+    free(initial);
+    free(after);
+    cleanup();
+
+    return nStatus;
+}
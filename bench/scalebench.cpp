@@ -0,0 +1,212 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Scaling benchmark for independent machines. Runs 1, 2, 4, ... up to
+ *   the host's hardware concurrency machines at once, one per thread,
+ *   each with its own copy of a workload, and reports aggregate emulated
+ *   MIPS and parallel efficiency relative to a single machine. Unlike
+ *   mcpubench the machines share nothing, so any loss of efficiency comes
+ *   from state the emulator shares between threads or from the host
+ *   itself; a row below the efficiency threshold is flagged. -m runs
+ *   more machines than the host has threads, which are marked as
+ *   oversubscribed rather than flagged.
+ *
+ *   Each workload starts at $4000 and is restarted whenever it reaches
+ *   BRK until the instruction budget is spent.
+ *
+ *   Usage: scalebench [-n instructions] [-m machines] [-t percent] <source> ...
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "l6502.h"
+#include "bench.h"
+
+/**
+ * State shared by the machines of one run.
+ */
+typedef struct
+{
+    const char* source;
+    uint64_t instructions;          // Budget per machine
+    std::atomic<unsigned int> ready;
+    std::atomic<bool> go;
+    std::vector<int> status;
+    std::vector<double> elapsed;
+} RUN;
+
+/**
+ * Thread body for one machine. Assembles the workload, waits for every
+ * machine to be ready and then steps through the budget.
+ */
+static void runMachine(RUN* run, unsigned int machine)
+{
+    run->status[machine] = assemble(run->source);
+    reset(0x4000);
+
+    run->ready++;
+    while (!run->go) std::this_thread::yield();
+
+    if (run->status[machine] != 0) return;
+
+    double start = bench_seconds();
+
+    for (uint64_t i=0; i < run->instructions; i++)
+    {
+        step();
+        if (brk() == 1) reset(0x4000);
+    }
+
+    run->elapsed[machine] = bench_seconds() - start;
+}
+
+/**
+ * Run the workload on the given number of machines, returning aggregate
+ * emulated MIPS or a negative value on failure.
+ */
+static double measure(const char* source, unsigned int count, uint64_t instructions)
+{
+    RUN run;
+
+    run.source = source;
+    run.instructions = instructions;
+    run.ready = 0;
+    run.go = false;
+    run.status.assign(count, 0);
+    run.elapsed.assign(count, 0.0);
+
+    std::vector<std::thread> threads;
+
+    for (unsigned int machine=0; machine < count; machine++)
+    {
+        threads.push_back(std::thread(runMachine, &run, machine));
+    }
+
+    while (run.ready < count) std::this_thread::yield();
+
+    double start = bench_seconds();
+    run.go = true;
+
+    for (unsigned int machine=0; machine < count; machine++) threads[machine].join();
+
+    double elapsed = bench_seconds() - start;
+
+    for (unsigned int machine=0; machine < count; machine++)
+    {
+        if (run.status[machine] != 0) return -1.0;
+    }
+
+    return count * instructions / elapsed / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t instructions = 20000000;
+    unsigned int hardware = std::thread::hardware_concurrency();
+    unsigned int maximum = hardware;
+    double threshold = 80.0;
+    int chOption;
+
+    while ((chOption = getopt(argc, argv, "n:m:t:h")) != -1)
+    {
+        switch (chOption)
+        {
+        case 'n':
+            instructions = strtoull(optarg, 0, 10);
+            break;
+        case 'm':
+            maximum = (unsigned int)atoi(optarg);
+            break;
+        case 't':
+            threshold = atof(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n instructions] [-m machines] [-t percent] <source> ...\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind >= argc || instructions == 0)
+    {
+        fprintf(stderr, "Usage: %s [-n instructions] [-m machines] [-t percent] <source> ...\n", argv[0]);
+        return 1;
+    }
+
+    if (hardware == 0) hardware = 1;
+    if (maximum == 0) maximum = hardware;
+
+    initialize(0);
+
+    int nStatus = 0;
+
+    for (int arg=optind; arg < argc; arg++)
+    {
+        const char* source = argv[arg];
+
+        printf("%s\n", source);
+        printf("%9s %12s %10s %10s\n", "machines", "MIPS", "speedup", "efficiency");
+
+        double base = 0.0;
+
+        for (unsigned int count=1; ; count *= 2)
+        {
+            if (count > maximum) count = maximum;
+
+            double mips = measure(source, count, instructions);
+
+            if (mips < 0.0)
+            {
+                fprintf(stderr, "Error: cannot assemble %s\n", source);
+                nStatus = 1;
+                break;
+            }
+
+            if (count == 1) base = mips;
+
+            double efficiency = 100.0 * mips / base / count;
+
+            const char* flag = "";
+
+            if (count > hardware) flag = "  oversubscribed";
+            else if (efficiency < threshold) flag = "  contention";
+
+            printf("%9u %12.2f %10.2f %9.0f%%%s\n", count, mips, mips / base, efficiency, flag);
+
+            if (count == maximum) break;
+        }
+
+        printf("\n");
+    }
+
+    cleanup();
+
+    return nStatus;
+}
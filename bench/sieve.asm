@@ -0,0 +1,62 @@
+;; Sieve of Eratosthenes over 0-8191 with one flag byte per number at
+;; $5000-$6FFF. Leaves the number of primes found at $FE-$FF.
+;; checksum $0404
+$4000   LDAI #$00
+        STAZ $10
+        LDAI #$50
+        STAZ $11
+        LDYI #$00
+        LDXI #$20
+CLEAR   LDAI #$00
+CLEARPG STAIY $10
+        INY
+        BNE CLEARPG
+        INCZ $11
+        DEX
+        BNE CLEAR
+        LDAI #$01
+        STAA $5000
+        STAA $5001
+        LDAI #$02
+        STAZ $12
+OUTER   LDXZ $12
+        LDAX $5000
+        BNE NEXTI
+        TXA
+        ASL
+        STAZ $10
+        LDAI #$50
+        STAZ $11
+MARK    LDAI #$01
+        STAIY $10
+        CLC
+        LDAZ $10
+        ADCZ $12
+        STAZ $10
+        LDAZ $11
+        ADCI #$00
+        STAZ $11
+        CMPI #$70
+        BCC MARK
+NEXTI   INCZ $12
+        LDAZ $12
+        CMPI #91
+        BCC OUTER
+        LDAI #$00
+        STAZ $FE
+        STAZ $FF
+        STAZ $10
+        LDAI #$50
+        STAZ $11
+        LDXI #$20
+COUNT   LDAIY $10
+        BNE COMPOSITE
+        INCZ $FE
+        BNE COMPOSITE
+        INCZ $FF
+COMPOSITE INY
+        BNE COUNT
+        INCZ $11
+        DEX
+        BNE COUNT
+        BRK
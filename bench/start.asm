@@ -0,0 +1,2 @@
+;; Startup latency workload: the first instruction ends the run.
+$4000   BRK
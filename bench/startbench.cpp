@@ -0,0 +1,156 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Startup latency benchmark. Spawns the emulator on a program whose
+ *   first instruction is BRK, so the time from exec to exit is the
+ *   exec-to-first-instruction latency plus process exit. /bin/true is
+ *   timed the same way as the floor set by the host. The in-process cost
+ *   of initialize() is reported separately.
+ *
+ *   Usage: startbench [-n runs] <emulator> <source>
+ *
+ */
+
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "l6502.h"
+#include "bench.h"
+
+extern char** environ;
+
+/**
+ * Spawn argv with output discarded and wait for it to exit.
+ *
+ * @return double microseconds from spawn to exit, negative on failure
+ */
+static double spawn(char* const* argv)
+{
+    posix_spawn_file_actions_t actions;
+    pid_t pid;
+    int status;
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, "/dev/null", O_WRONLY, 0);
+
+    double start = bench_microseconds();
+    int nError = posix_spawn(&pid, argv[0], &actions, 0, argv, environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+
+    if (nError != 0) return -1.0;
+    if (waitpid(pid, &status, 0) != pid) return -1.0;
+
+    double elapsed = bench_microseconds() - start;
+
+    return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? elapsed : -1.0;
+}
+
+/**
+ * Spawn argv the given number of times and print the spread.
+ *
+ * @return int 0 on success; otherwise, 1
+ */
+static int measure(const char* name, char* const* argv, unsigned int runs)
+{
+    std::vector<double> samples;
+
+    for (unsigned int i=0; i < runs; i++)
+    {
+        double elapsed = spawn(argv);
+
+        if (elapsed < 0.0)
+        {
+            fprintf(stderr, "Error: %s failed\n", argv[0]);
+            return 1;
+        }
+
+        samples.push_back(elapsed);
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    double sum = 0.0;
+    for (unsigned int i=0; i < samples.size(); i++) sum += samples[i];
+
+    printf("%-16s %10.1f %10.1f %10.1f %10.1f\n", name, samples[0],
+        samples[samples.size() / 2], sum / samples.size(),
+        samples[samples.size() * 9 / 10]);
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int runs = 200;
+    int chOption;
+
+    while ((chOption = getopt(argc, argv, "n:h")) != -1)
+    {
+        switch (chOption)
+        {
+        case 'n':
+            runs = (unsigned int)atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-n runs] <emulator> <source>\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (argc - optind != 2 || runs == 0)
+    {
+        fprintf(stderr, "Usage: %s [-n runs] <emulator> <source>\n", argv[0]);
+        return 1;
+    }
+
+    char* emulator[] = { argv[optind], (char*)"-c", argv[optind+1], (char*)"-r", (char*)"4000", 0 };
+    char* floor[] = { (char*)"/bin/true", 0 };
+
+    printf("%-16s %10s %10s %10s %10s\n", "microseconds", "min", "median", "mean", "p90");
+
+    if (measure("/bin/true", floor, runs) != 0) return 1;
+    if (measure("exec to BRK", emulator, runs) != 0) return 1;
+
+    const unsigned int kCalls = 100000;
+    double start = bench_microseconds();
+
+    for (unsigned int i=0; i < kCalls; i++)
+    {
+        initialize(0);
+        cleanup();
+    }
+
+    printf("%-16s %10.3f\n", "initialize()", (bench_microseconds() - start) / kCalls);
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Ticker accuracy benchmark. Runs a calibrated NOP/DEX/BNE loop, as in
+ *   test/timing.asm, for a fixed span of emulated time at each clock rate
+ *   and compares wall-clock time with the time the cycle count implies.
+ *   Reports the overall error and the jitter of each emulated millisecond
+ *   (how far the wall time between consecutive millisecond boundaries
+ *   strays from the cycles between them).
+ *
+ *   Usage: tickbench [-d milliseconds] [-t percent] [<rate Hz> ...]
+ *
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#include "l6502.h"
+#include "bench.h"
+
+/**
+ * Calibrated loop: 7 cycles per taken iteration, repeated forever.
+ */
+static const char* kLoop =
+    "$4000   LDXI #$00\n"
+    "loop    NOP\n"
+    "        DEX\n"
+    "        BNE loop\n"
+    "        JMP $4000\n";
+
+/**
+ * Run the loop at one rate and print a result row.
+ *
+ * @return double absolute error in percent, negative on failure
+ */
+static double measure(unsigned int rate, unsigned int milliseconds)
+{
+    if (initialize(rate) != 0 || assembleBuffer(kLoop) != 0) return -1.0;
+
+    reset(0x4000);
+
+    uint64_t perMs = rate / 1000 ? rate / 1000 : 1;
+    uint64_t target = perMs * milliseconds;
+    uint64_t next = perMs;
+    uint64_t lastCycles = 0;
+    double lastWall = 0.0;
+    std::vector<double> jitter;
+
+    double start = bench_seconds();
+
+    while (cycles() < target)
+    {
+        step();
+
+        if (cycles() >= next)
+        {
+            double wall = bench_seconds() - start;
+            double expected = (double)(cycles() - lastCycles) / rate;
+
+            jitter.push_back(fabs((wall - lastWall) - expected) * 1e6);
+
+            lastWall = wall;
+            lastCycles = cycles();
+            next += perMs;
+        }
+    }
+
+    double measured = bench_seconds() - start;
+    double expected = (double)cycles() / rate;
+    double error = 100.0 * (measured - expected) / expected;
+
+    cleanup();
+
+    std::sort(jitter.begin(), jitter.end());
+
+    double sum = 0.0;
+    for (unsigned int i=0; i < jitter.size(); i++) sum += jitter[i];
+
+    printf("%10.3f %10.4f %10.4f %+9.2f%% %10.1f %10.1f %10.1f\n", rate / 1e6,
+        expected, measured, error, sum / jitter.size(),
+        jitter[jitter.size() * 99 / 100], jitter.back());
+
+    return fabs(error);
+}
+
+int main(int argc, char** argv)
+{
+    unsigned int milliseconds = 200;
+    double threshold = 0.0;
+    int chOption;
+
+    while ((chOption = getopt(argc, argv, "d:t:h")) != -1)
+    {
+        switch (chOption)
+        {
+        case 'd':
+            milliseconds = (unsigned int)atoi(optarg);
+            break;
+        case 't':
+            threshold = atof(optarg);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-d milliseconds] [-t percent] [<rate Hz> ...]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (milliseconds == 0)
+    {
+        fprintf(stderr, "Usage: %s [-d milliseconds] [-t percent] [<rate Hz> ...]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<unsigned int> rates;
+
+    for (int arg=optind; arg < argc; arg++) rates.push_back((unsigned int)strtoul(argv[arg], 0, 10));
+
+    if (rates.empty())
+    {
+        rates.push_back(1000000);
+        rates.push_back(2000000);
+        rates.push_back(14000000);
+    }
+
+    printf("%10s %10s %10s %10s %10s %10s %10s\n", "MHz", "expected", "measured",
+        "error", "jitter us", "p99 us", "max us");
+
+    int nStatus = 0;
+
+    for (unsigned int i=0; i < rates.size(); i++)
+    {
+        if (rates[i] == 0) continue;
+
+        double error = measure(rates[i], milliseconds);
+
+        if (error < 0.0)
+        {
+            fprintf(stderr, "Error: run at %u Hz failed\n", rates[i]);
+            nStatus = 1;
+        }
+        else if (threshold > 0.0 && error > threshold)
+        {
+            fprintf(stderr, "Error at %u Hz exceeds %.1f%%\n", rates[i], threshold);
+            nStatus = 1;
+        }
+    }
+
+    return nStatus;
+}
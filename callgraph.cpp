@@ -0,0 +1,282 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the guest call-graph profiler.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "l6502.h"
+#include "callgraph.h"
+
+/**
+ * One call path: a routine reached through its parent's path
+ */
+typedef struct
+{
+    uint16_t address;                      // Routine entry address
+    uint32_t parent;                       // Index of the calling path
+    uint64_t self;                         // Cycles spent in this routine on this path
+    uint64_t calls;                        // Times this path was entered
+    std::map<uint16_t, uint32_t> children; // Callee address to path index
+} CALL_NODE;
+
+/**
+ * One shadow stack entry
+ */
+typedef struct
+{
+    uint32_t node;  // Path index
+    uint8_t sp;     // Stack pointer after the call
+} CALL_FRAME;
+
+/**
+ * Totals for one routine over all its paths
+ */
+typedef struct
+{
+    uint16_t address;
+    uint64_t inclusive;
+    uint64_t exclusive;
+    uint64_t calls;
+} ROUTINE;
+
+bool g_bCallGraph = false;
+
+static thread_local std::vector<CALL_NODE> s_nodes;  // Index 0 is the root
+static thread_local std::vector<CALL_FRAME> s_stack;
+static thread_local uint64_t s_charged;              // Cycles already charged
+
+/**
+ * Charge the cycles since the last event to the routine on top of the
+ * shadow stack.
+ */
+static void charge(uint64_t cycles)
+{
+    if (s_stack.empty()) return;
+
+    s_nodes[s_stack.back().node].self += cycles - s_charged;
+    s_charged = cycles;
+}
+
+/**
+ * Return the display name of a routine.
+ */
+static std::string name(uint16_t address)
+{
+    const char* label = labelAt(address);
+
+    if (label) return label;
+
+    char hex[8];
+    snprintf(hex, sizeof hex, "$%04x", address);
+
+    return hex;
+}
+
+/**
+ * Discard the call tree and start a new one.
+ */
+void callgraph_reset(uint16_t address)
+{
+    CALL_NODE root;
+    root.address = address;
+    root.parent = 0;
+    root.self = 0;
+    root.calls = 1;
+
+    s_nodes.clear();
+    s_nodes.push_back(root);
+
+    CALL_FRAME frame = {0, 0xff};
+
+    s_stack.clear();
+    s_stack.push_back(frame);
+
+    s_charged = 0;
+}
+
+/**
+ * Record a subroutine call.
+ */
+void callgraph_call(uint16_t target, uint8_t sp, uint64_t cycles)
+{
+    if (s_stack.empty()) callgraph_reset(target);
+
+    charge(cycles);
+
+    uint32_t parent = s_stack.back().node;
+    std::map<uint16_t, uint32_t>::iterator it = s_nodes[parent].children.find(target);
+    uint32_t node;
+
+    if (it != s_nodes[parent].children.end())
+    {
+        node = it->second;
+    }
+    else
+    {
+        CALL_NODE child;
+        child.address = target;
+        child.parent = parent;
+        child.self = 0;
+        child.calls = 0;
+
+        node = (uint32_t)s_nodes.size();
+        s_nodes.push_back(child);
+        s_nodes[parent].children[target] = node;
+    }
+
+    s_nodes[node].calls++;
+
+    CALL_FRAME frame = {node, sp};
+    s_stack.push_back(frame);
+}
+
+/**
+ * Record a return.
+ */
+void callgraph_return(uint8_t sp, uint64_t cycles)
+{
+    charge(cycles);
+
+    // The root frame is never popped; a return past it is not a call we saw
+    while (s_stack.size() > 1 && s_stack.back().sp < sp) s_stack.pop_back();
+}
+
+/**
+ * Charge outstanding cycles and compute the total cycles under each
+ * path. Children always follow their parent in s_nodes.
+ */
+static std::vector<uint64_t> totals()
+{
+    charge(cycles());
+
+    std::vector<uint64_t> total(s_nodes.size());
+
+    for (size_t ii=0; ii < s_nodes.size(); ii++) total[ii] = s_nodes[ii].self;
+
+    for (size_t ii=s_nodes.size(); ii-- > 1; ) total[s_nodes[ii].parent] += total[ii];
+
+    return total;
+}
+
+static bool byInclusive(const ROUTINE& a, const ROUTINE& b)
+{
+    if (a.inclusive != b.inclusive) return a.inclusive > b.inclusive;
+    if (a.exclusive != b.exclusive) return a.exclusive > b.exclusive;
+    return a.address < b.address;
+}
+
+/**
+ * Print routines sorted by inclusive cycles.
+ */
+void callgraph_report(FILE* out)
+{
+    if (s_nodes.empty()) return;
+
+    std::vector<uint64_t> total = totals();
+    std::map<uint16_t, ROUTINE> routines;
+
+    for (size_t ii=0; ii < s_nodes.size(); ii++)
+    {
+        const CALL_NODE& node = s_nodes[ii];
+        ROUTINE& routine = routines[node.address];
+
+        routine.address = node.address;
+        routine.exclusive += node.self;
+        routine.calls += node.calls;
+
+        // Count a recursive routine's cycles once, at its outermost path
+        bool bOutermost = true;
+
+        for (uint32_t up=node.parent; ii && bOutermost; up=s_nodes[up].parent)
+        {
+            if (s_nodes[up].address == node.address) bOutermost = false;
+            if (up == 0) break;
+        }
+
+        if (bOutermost) routine.inclusive += total[ii];
+    }
+
+    std::vector<ROUTINE> sorted;
+
+    for (std::map<uint16_t, ROUTINE>::iterator it = routines.begin(); it != routines.end(); ++it)
+    {
+        sorted.push_back(it->second);
+    }
+
+    std::sort(sorted.begin(), sorted.end(), byInclusive);
+
+    double scale = total[0] ? 100.0 / total[0] : 0.0;
+
+    fprintf(out, "%14s %7s %14s %7s %10s  %s\n",
+        "inclusive", "incl%", "exclusive", "excl%", "calls", "routine");
+
+    for (size_t ii=0; ii < sorted.size(); ii++)
+    {
+        fprintf(out, "%14llu %6.2f%% %14llu %6.2f%% %10llu  %s\n",
+            (unsigned long long)sorted[ii].inclusive, sorted[ii].inclusive * scale,
+            (unsigned long long)sorted[ii].exclusive, sorted[ii].exclusive * scale,
+            (unsigned long long)sorted[ii].calls, name(sorted[ii].address).c_str());
+    }
+}
+
+/**
+ * Write the call tree in folded-stack format.
+ */
+int callgraph_folded(const char* filename)
+{
+    FILE* fp = fopen(filename, "w");
+
+    if (!fp) return errno;
+
+    charge(cycles());
+
+    for (size_t ii=0; ii < s_nodes.size(); ii++)
+    {
+        if (s_nodes[ii].self == 0) continue;
+
+        std::string path = name(s_nodes[ii].address);
+
+        for (uint32_t up=(uint32_t)ii; up != 0; )
+        {
+            up = s_nodes[up].parent;
+            path = name(s_nodes[up].address) + ";" + path;
+        }
+
+        fprintf(fp, "%s %llu\n", path.c_str(), (unsigned long long)s_nodes[ii].self);
+    }
+
+    if (fclose(fp) != 0) return errno;
+
+    return 0;
+}
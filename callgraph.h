@@ -0,0 +1,95 @@
+#ifndef _CALLGRAPH_H_
+#define _CALLGRAPH_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Guest call-graph profiler. While g_bCallGraph is set step() reports
+ *   every JSR, RTS and RTI, and the profiler keeps a shadow call stack
+ *   mirroring the guest's. Cycles are charged to the routine on top of
+ *   the shadow stack, building a tree of call paths from which inclusive
+ *   and exclusive cycles per routine are derived.
+ *
+ *   Each shadow frame remembers the stack pointer after its JSR. A return
+ *   pops every frame whose return address it consumed, so routines that
+ *   discard their return address (PLA PLA) or return from an interrupt
+ *   with RTI keep the shadow stack in step with the guest.
+ *
+ *   Routines are named by their assembler label, or $xxxx otherwise.
+ *   State is per thread, like the machine it profiles.
+ *
+ */
+
+#include <stdio.h>
+
+#include "platform.h"
+
+//
+// True while calls and returns are being tracked
+//
+extern bool g_bCallGraph;
+
+/**
+ * Discard the call tree and start a new one rooted at the given address.
+ * Called by reset().
+ *
+ * @param address address execution begins at
+ */
+void callgraph_reset(uint16_t address);
+
+/**
+ * Record a subroutine call.
+ *
+ * @param target address of the called routine
+ * @param sp stack pointer after the call
+ * @param cycles cycles elapsed since reset, including the call
+ */
+void callgraph_call(uint16_t target, uint8_t sp, uint64_t cycles);
+
+/**
+ * Record a return (RTS or RTI).
+ *
+ * @param sp stack pointer after the return
+ * @param cycles cycles elapsed since reset, including the return
+ */
+void callgraph_return(uint8_t sp, uint64_t cycles);
+
+/**
+ * Print routines sorted by inclusive cycles, with exclusive cycles and
+ * call counts.
+ *
+ * @param out stream the report is written to
+ */
+void callgraph_report(FILE* out);
+
+/**
+ * Write the call tree in folded-stack format (one "root;caller;callee
+ * cycles" line per path), as read by flamegraph.pl.
+ *
+ * @param filename file to create
+ * @return int 0 on success; otherwise, error number
+ */
+int callgraph_folded(const char* filename);
+
+#endif
@@ -0,0 +1,236 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the Chrome Trace Event export.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "l6502.h"
+#include "chrometrace.h"
+#include "json.h"
+
+/**
+ * Size of the stdio buffer the trace is written through
+ */
+static const size_t kBufferSize = 1 << 20;
+
+/**
+ * One open slice
+ */
+typedef struct
+{
+    uint16_t address;  // Routine entry address
+    uint8_t sp;        // Stack pointer after the call
+} SLICE;
+
+bool g_bChromeTrace = false;
+
+static FILE* s_fp = 0;
+static char* s_buffer = 0;
+static std::vector<SLICE> s_open;
+static std::vector<std::string> s_names;  // Quoted routine names, by address
+static uint64_t s_base = 0;               // Timestamp of the last reset
+static uint64_t s_last = 0;               // Latest timestamp written
+static std::thread::id s_owner;           // Thread whose machine is traced
+
+/**
+ * Return the quoted name of a routine, looking up its label once.
+ */
+static const char* name(uint16_t address)
+{
+    std::string& quoted = s_names[address];
+
+    if (quoted.empty())
+    {
+        const char* label = labelAt(address);
+        char hex[8];
+
+        if (!label)
+        {
+            snprintf(hex, sizeof hex, "$%04x", address);
+            label = hex;
+        }
+
+        json_quote(quoted, label);
+    }
+
+    return quoted.c_str();
+}
+
+static void begin(uint16_t address, uint64_t ts)
+{
+    fprintf(s_fp, ",\n{\"name\":%s,\"ph\":\"B\",\"ts\":%llu,\"pid\":1,\"tid\":1}",
+        name(address), (unsigned long long)ts);
+}
+
+static void end(uint16_t address, uint64_t ts)
+{
+    fprintf(s_fp, ",\n{\"name\":%s,\"ph\":\"E\",\"ts\":%llu,\"pid\":1,\"tid\":1}",
+        name(address), (unsigned long long)ts);
+}
+
+static void instant(const char* event, uint64_t ts)
+{
+    fprintf(s_fp, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%llu,\"pid\":1,\"tid\":1}",
+        event, (unsigned long long)ts);
+}
+
+static void depth(uint8_t sp, uint64_t ts)
+{
+    fprintf(s_fp, ",\n{\"name\":\"stack\",\"ph\":\"C\",\"ts\":%llu,\"pid\":1,\"args\":{\"bytes\":%u}}",
+        (unsigned long long)ts, 0xffu - sp);
+}
+
+/**
+ * Close open slices down to the given count.
+ */
+static void unwind(size_t count, uint64_t ts)
+{
+    while (s_open.size() > count)
+    {
+        end(s_open.back().address, ts);
+        s_open.pop_back();
+    }
+}
+
+/**
+ * Create the trace file and write its header.
+ */
+int chrometrace_start(const char* filename)
+{
+    if (s_fp) return EBUSY;
+
+    s_fp = fopen(filename, "w");
+    if (!s_fp) return errno;
+
+    s_buffer = new char[kBufferSize];
+    setvbuf(s_fp, s_buffer, _IOFBF, kBufferSize);
+
+    s_names.assign(65536, std::string());
+    s_open.clear();
+    s_base = 0;
+    s_last = 0;
+    s_owner = std::this_thread::get_id();
+
+    fprintf(s_fp, "[{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"6502\"}},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"cpu\"}}");
+
+    g_bChromeTrace = true;
+
+    return 0;
+}
+
+/**
+ * Close every open slice and start a new root slice.
+ */
+void chrometrace_reset(uint16_t address)
+{
+    if (!s_fp || std::this_thread::get_id() != s_owner) return;
+
+    unwind(0, s_last);
+
+    // Cycles restart at zero; keep the timeline moving forward
+    s_base = s_last;
+
+    SLICE root = {address, 0xff};
+    s_open.push_back(root);
+    begin(address, s_base);
+    depth(0xff, s_base);
+}
+
+/**
+ * Record a subroutine call.
+ */
+void chrometrace_call(uint16_t target, uint8_t sp, uint64_t cycles)
+{
+    if (std::this_thread::get_id() != s_owner) return;
+
+    s_last = s_base + cycles;
+
+    SLICE slice = {target, sp};
+    s_open.push_back(slice);
+    begin(target, s_last);
+    depth(sp, s_last);
+}
+
+/**
+ * Record a return.
+ */
+void chrometrace_return(bool bInterrupt, uint8_t sp, uint64_t cycles)
+{
+    if (std::this_thread::get_id() != s_owner) return;
+
+    s_last = s_base + cycles;
+
+    if (bInterrupt) instant("RTI", s_last);
+
+    // The root slice is closed only by reset or stop
+    size_t count = s_open.size();
+    while (count > 1 && s_open[count-1].sp < sp) count--;
+
+    unwind(count, s_last);
+    depth(sp, s_last);
+}
+
+/**
+ * Record a BRK.
+ */
+void chrometrace_break(uint64_t cycles)
+{
+    if (std::this_thread::get_id() != s_owner) return;
+
+    s_last = s_base + cycles;
+
+    instant("BRK", s_last);
+}
+
+/**
+ * Close every open slice, finish and close the trace file.
+ */
+int chrometrace_stop()
+{
+    if (!s_fp) return 0;
+
+    g_bChromeTrace = false;
+
+    unwind(0, s_base + cycles() > s_last ? s_base + cycles() : s_last);
+
+    fprintf(s_fp, "\n]\n");
+
+    int nStatus = (fclose(s_fp) == 0) ? 0 : errno;
+
+    s_fp = 0;
+    delete [] s_buffer;
+    s_buffer = 0;
+    s_names.clear();
+
+    return nStatus;
+}
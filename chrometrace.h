@@ -0,0 +1,101 @@
+#ifndef _CHROMETRACE_H_
+#define _CHROMETRACE_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Chrome Trace Event export, viewable in chrome://tracing or
+ *   ui.perfetto.dev. Subroutines become duration slices, BRK and RTI
+ *   become instant events, and a counter track follows the stack depth.
+ *   Timestamps are emulated cycles, shown as microseconds (real time at
+ *   the default 1 MHz clock).
+ *
+ *   Events are written as they happen through a large stdio buffer, so
+ *   the trace never has to fit in memory. Calls are matched to returns
+ *   with a shadow stack of stack pointers as in callgraph.h, keeping
+ *   slices balanced when the guest discards return addresses.
+ *
+ */
+
+#include <stdio.h>
+
+#include "platform.h"
+
+//
+// True while guest execution is exported. Only the machine of the thread
+// that started the export is recorded; events from other threads are
+// ignored.
+//
+extern bool g_bChromeTrace;
+
+/**
+ * Create the trace file and write its header.
+ *
+ * @param filename file to create
+ * @return int 0 on success; otherwise, error number
+ */
+int chrometrace_start(const char* filename);
+
+/**
+ * Close every open slice and start a new root slice at the given
+ * address. Called by reset().
+ *
+ * @param address address execution begins at
+ */
+void chrometrace_reset(uint16_t address);
+
+/**
+ * Record a subroutine call, opening a slice.
+ *
+ * @param target address of the called routine
+ * @param sp stack pointer after the call
+ * @param cycles cycles elapsed since reset, including the call
+ */
+void chrometrace_call(uint16_t target, uint8_t sp, uint64_t cycles);
+
+/**
+ * Record a return (RTS, or RTI with bInterrupt set), closing the slices
+ * whose return addresses it consumed.
+ *
+ * @param bInterrupt true for RTI
+ * @param sp stack pointer after the return
+ * @param cycles cycles elapsed since reset, including the return
+ */
+void chrometrace_return(bool bInterrupt, uint8_t sp, uint64_t cycles);
+
+/**
+ * Record a BRK.
+ *
+ * @param cycles cycles elapsed since reset, including the break
+ */
+void chrometrace_break(uint64_t cycles);
+
+/**
+ * Close every open slice, finish and close the trace file.
+ *
+ * @return int 0 on success; otherwise, error number
+ */
+int chrometrace_stop();
+
+#endif
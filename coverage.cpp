@@ -0,0 +1,156 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of guest code coverage.
+ *
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+
+#include "l6502.h"
+#include "coverage.h"
+#include "profile.h"
+
+/**
+ * Coverage of one source line
+ */
+typedef struct
+{
+    bool bExecuted;                // Any instruction on the line ran
+    bool bBranch;                  // The line holds a branch
+    bool bBranchExecuted;          // ...which ran
+    bool bTaken;                   // ...and was taken
+    bool bNotTaken;                // ...and fell through
+} LINE_COVERAGE;
+
+bool g_bCoverage = false;
+uint8_t g_coverageExecuted[8192];
+uint8_t g_coverageTaken[8192];
+uint8_t g_coverageNotTaken[8192];
+bool g_coverageBranch[256];
+
+static inline bool test(const uint8_t* bitmap, uint16_t address)
+{
+    return (bitmap[address >> 3] >> (address & 7)) & 1;
+}
+
+/**
+ * Clear the bitmaps and start marking.
+ */
+void coverage_start()
+{
+    memset(g_coverageExecuted, 0, sizeof g_coverageExecuted);
+    memset(g_coverageTaken, 0, sizeof g_coverageTaken);
+    memset(g_coverageNotTaken, 0, sizeof g_coverageNotTaken);
+
+    for (unsigned int op=0; op < 256; op++)
+    {
+        g_coverageBranch[op] = (profile_addressing((uint8_t)op) == kModeRelative);
+    }
+
+    g_bCoverage = true;
+}
+
+/**
+ * Write an lcov tracefile.
+ */
+int coverage_lcov(const char* filename)
+{
+    if (*sourceFile() == '\0') return ENOENT;
+
+    std::map<unsigned int, LINE_COVERAGE> lines;
+
+    for (uint32_t address=0; address < 65536; address++)
+    {
+        unsigned int line = lineAt((uint16_t)address);
+
+        if (line == 0) continue;
+
+        LINE_COVERAGE& cover = lines[line];
+        bool bExecuted = test(g_coverageExecuted, (uint16_t)address);
+
+        cover.bExecuted |= bExecuted;
+
+        if (g_coverageBranch[inspect((uint16_t)address)])
+        {
+            cover.bBranch = true;
+            cover.bBranchExecuted |= bExecuted;
+            cover.bTaken |= test(g_coverageTaken, (uint16_t)address);
+            cover.bNotTaken |= test(g_coverageNotTaken, (uint16_t)address);
+        }
+    }
+
+    FILE* fp = fopen(filename, "w");
+
+    if (!fp) return errno;
+
+    char path[PATH_MAX];
+    const char* source = realpath(sourceFile(), path) ? path : sourceFile();
+    unsigned int linesHit = 0;
+    unsigned int branches = 0;
+    unsigned int branchesHit = 0;
+
+    fprintf(fp, "TN:\nSF:%s\n", source);
+
+    for (std::map<unsigned int, LINE_COVERAGE>::iterator it = lines.begin(); it != lines.end(); ++it)
+    {
+        const LINE_COVERAGE& cover = it->second;
+
+        if (!cover.bBranch) continue;
+
+        // Branch 0 is taken, branch 1 falls through; "-" if never reached
+        if (cover.bBranchExecuted)
+        {
+            fprintf(fp, "BRDA:%u,0,0,%d\nBRDA:%u,0,1,%d\n",
+                it->first, cover.bTaken ? 1 : 0, it->first, cover.bNotTaken ? 1 : 0);
+        }
+        else
+        {
+            fprintf(fp, "BRDA:%u,0,0,-\nBRDA:%u,0,1,-\n", it->first, it->first);
+        }
+
+        branches += 2;
+        branchesHit += cover.bTaken + cover.bNotTaken;
+    }
+
+    fprintf(fp, "BRF:%u\nBRH:%u\n", branches, branchesHit);
+
+    for (std::map<unsigned int, LINE_COVERAGE>::iterator it = lines.begin(); it != lines.end(); ++it)
+    {
+        fprintf(fp, "DA:%u,%d\n", it->first, it->second.bExecuted ? 1 : 0);
+        linesHit += it->second.bExecuted;
+    }
+
+    fprintf(fp, "LF:%u\nLH:%u\nend_of_record\n", (unsigned int)lines.size(), linesHit);
+
+    if (fclose(fp) != 0) return errno;
+
+    return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef _COVERAGE_H_
+#define _COVERAGE_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Guest code coverage. While g_bCoverage is set step() marks the
+ *   address of each executed instruction in a bitmap, and for branches
+ *   whether the branch was taken or fell through in two more bitmaps.
+ *   Marking is an inline OR into a bit, so coverage can stay on for long
+ *   regression runs.
+ *
+ *   The bitmaps are mapped back to source lines through the assembler's
+ *   line table (see lineAt) and written in lcov tracefile format, which
+ *   genhtml renders as annotated source.
+ *
+ */
+
+#include "platform.h"
+
+//
+// True while executed instructions are being marked
+//
+extern bool g_bCoverage;
+
+//
+// One bit per address: executed, branch taken, branch not taken
+//
+extern uint8_t g_coverageExecuted[8192];
+extern uint8_t g_coverageTaken[8192];
+extern uint8_t g_coverageNotTaken[8192];
+
+//
+// True for the relative branch opcodes
+//
+extern bool g_coverageBranch[256];
+
+/**
+ * Mark an executed instruction.
+ *
+ * @param opcode opcode that was executed
+ * @param pc address of the instruction
+ * @param next program counter after the instruction
+ */
+inline void coverage_mark(uint8_t opcode, uint16_t pc, uint16_t next)
+{
+    uint8_t bit = (uint8_t)(1 << (pc & 7));
+
+    g_coverageExecuted[pc >> 3] |= bit;
+
+    if (g_coverageBranch[opcode])
+    {
+        if (next == (uint16_t)(pc + 2)) g_coverageNotTaken[pc >> 3] |= bit;
+        else g_coverageTaken[pc >> 3] |= bit;
+    }
+}
+
+/**
+ * Clear the bitmaps and start marking.
+ */
+void coverage_start();
+
+/**
+ * Write an lcov tracefile for the last assembled source file.
+ *
+ * @param filename tracefile to create
+ * @return int 0 on success; otherwise, error number (ENOENT if there is
+ * no line table because nothing was assembled from a file)
+ */
+int coverage_lcov(const char* filename);
+
+#endif
@@ -0,0 +1,307 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of lockstep engine cross-checking.
+ *
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "crosscheck.h"
+#include "ftrace.h"
+
+/**
+ * Maximum number of differing memory bytes printed in a diff
+ */
+static const int kMaxDiffBytes = 16;
+
+/**
+ * One engine and the machine state it published after its last block.
+ */
+typedef struct LANE
+{
+    STEP_FUNCTION engine;
+    MACHINE_STATE* state;
+    std::atomic<uint64_t> done;     // Last block published
+} LANE;
+
+/**
+ * Handoff shared between the comparing thread and the engine threads.
+ */
+typedef struct
+{
+    LANE* lanes;
+    unsigned int block;
+    std::atomic<uint64_t> go;       // Highest block engines may run
+    std::atomic<bool> stop;
+} HANDOFF;
+
+/**
+ * Run up to count instructions on the calling thread's machine, stopping
+ * early on BRK.
+ */
+static void runBlock(STEP_FUNCTION engine, unsigned int count)
+{
+    for (unsigned int i=0; i < count && brk() != 1; i++) engine();
+}
+
+/**
+ * Run one block on the calling thread by swapping the lane's state in.
+ */
+static void runLane(LANE* lane, unsigned int count)
+{
+    loadState(lane->state);
+    runBlock(lane->engine, count);
+    saveState(lane->state);
+}
+
+/**
+ * Engine thread body: wait for permission to run each block, run it and
+ * publish the resulting state.
+ */
+static void laneThread(HANDOFF* handoff, unsigned int index)
+{
+    LANE* lane = &handoff->lanes[index];
+
+    loadState(lane->state);
+
+    for (uint64_t n=1; ; n++)
+    {
+        while (handoff->go.load(std::memory_order_acquire) < n)
+        {
+            if (handoff->stop.load(std::memory_order_acquire)) return;
+            std::this_thread::yield();
+        }
+
+        runBlock(lane->engine, handoff->block);
+        saveState(lane->state);
+        lane->done.store(n, std::memory_order_release);
+    }
+}
+
+/**
+ * Pin a thread to a CPU where the platform supports it.
+ */
+static void pin(std::thread& thread, unsigned int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof set, &set) != 0)
+    {
+        fprintf(stderr, "Warning: cannot pin engine thread to CPU %u\n", cpu);
+    }
+#else
+    (void)thread;
+    (void)cpu;
+#endif
+}
+
+/**
+ * Print the differences between two machine states to stdout.
+ */
+static void printDiff(const MACHINE_STATE* a, const MACHINE_STATE* b)
+{
+    static const char* names[] = {"C", "Z", "I", "D", "B", "V", "S"};
+
+    printf("          first  second\n");
+    if (a->cycles != b->cycles) printf("  cycles  %-6llu %llu\n", (unsigned long long)a->cycles, (unsigned long long)b->cycles);
+    if (a->pc != b->pc) printf("  PC      %04x   %04x\n", a->pc, b->pc);
+    if (a->a != b->a) printf("  A       %02x     %02x\n", a->a, b->a);
+    if (a->x != b->x) printf("  X       %02x     %02x\n", a->x, b->x);
+    if (a->y != b->y) printf("  Y       %02x     %02x\n", a->y, b->y);
+    if (a->sp != b->sp) printf("  SP      %02x     %02x\n", a->sp, b->sp);
+    if (a->p != b->p) printf("  P       %02x     %02x\n", a->p, b->p);
+
+    for (int i=0; i < 7; i++)
+    {
+        if (a->flags[i] != b->flags[i]) printf("  %s       %d      %d\n", names[i], a->flags[i], b->flags[i]);
+    }
+
+    int printed = 0;
+    for (int i=0; i < k64K && printed < kMaxDiffBytes; i++)
+    {
+        if (a->memory[i] != b->memory[i])
+        {
+            printf("  $%04x   %02x     %02x\n", i, a->memory[i], b->memory[i]);
+            printed++;
+        }
+    }
+}
+
+/**
+ * Run two engines in lockstep and compare them after every block.
+ */
+int crosscheck_run(uint16_t address, STEP_FUNCTION first, STEP_FUNCTION second,
+                   unsigned int block, bool bThreads, bool bPin, uint64_t maxCycles)
+{
+    assert(first && second);
+
+    if (block == 0 || maxCycles == 0) return -1;
+
+    reset(address);
+
+    LANE lanes[2];
+    MACHINE_STATE* agreed = new MACHINE_STATE;
+
+    saveState(agreed);
+
+    lanes[0].engine = first;
+    lanes[1].engine = second;
+
+    for (int i=0; i < 2; i++)
+    {
+        lanes[i].state = new MACHINE_STATE;
+        lanes[i].done = 0;
+        memcpy(lanes[i].state, agreed, sizeof(MACHINE_STATE));
+    }
+
+    HANDOFF handoff;
+    handoff.lanes = lanes;
+    handoff.block = block;
+    handoff.go = 0;
+    handoff.stop = false;
+
+    std::vector<std::thread> threads;
+
+    if (bThreads)
+    {
+        unsigned int cpus = std::thread::hardware_concurrency();
+
+        for (unsigned int i=0; i < 2; i++)
+        {
+            threads.push_back(std::thread(laneThread, &handoff, i));
+            if (bPin) pin(threads[i], cpus ? i % cpus : 0);
+        }
+    }
+
+    uint64_t blocks = 0;
+    bool bDiverged = false;
+    bool bLimit = false;
+
+    for (;;)
+    {
+        blocks++;
+
+        if (bThreads)
+        {
+            handoff.go.store(blocks, std::memory_order_release);
+
+            while (lanes[0].done.load(std::memory_order_acquire) < blocks ||
+                   lanes[1].done.load(std::memory_order_acquire) < blocks)
+            {
+                std::this_thread::yield();
+            }
+        }
+        else
+        {
+            runLane(&lanes[0], block);
+            runLane(&lanes[1], block);
+        }
+
+        if (memcmp(lanes[0].state, lanes[1].state, sizeof(MACHINE_STATE)) != 0)
+        {
+            bDiverged = true;
+            break;
+        }
+
+        memcpy(agreed, lanes[0].state, sizeof(MACHINE_STATE));
+
+        if (agreed->flags[4] == 1) break;
+
+        if (agreed->cycles >= maxCycles)
+        {
+            bLimit = true;
+            break;
+        }
+    }
+
+    handoff.stop = true;
+
+    for (size_t i=0; i < threads.size(); i++)
+    {
+        threads[i].join();
+    }
+
+    if (bDiverged)
+    {
+        //
+        // Narrow the divergent block down to a single instruction.
+        //
+        memcpy(lanes[0].state, agreed, sizeof(MACHINE_STATE));
+        memcpy(lanes[1].state, agreed, sizeof(MACHINE_STATE));
+
+        for (unsigned int i=0; i < block; i++)
+        {
+            memcpy(agreed, lanes[0].state, sizeof(MACHINE_STATE));
+
+            runLane(&lanes[0], 1);
+            runLane(&lanes[1], 1);
+
+            if (memcmp(lanes[0].state, lanes[1].state, sizeof(MACHINE_STATE)) != 0) break;
+        }
+
+        printf("Crosscheck diverged at cycle %llu executing $%04x (opcode %02x):\n",
+            (unsigned long long)agreed->cycles, agreed->pc, agreed->memory[agreed->pc]);
+        printDiff(lanes[0].state, lanes[1].state);
+
+        loadState(lanes[0].state);
+    }
+    else if (bLimit)
+    {
+        fprintf(stderr, "Error: crosscheck did not reach BRK within %llu cycles (engines agreed until cycle %llu)\n",
+            (unsigned long long)maxCycles, (unsigned long long)agreed->cycles);
+
+        loadState(agreed);
+    }
+    else
+    {
+        printf("Crosscheck agreed for %llu cycles in %llu blocks\n",
+            (unsigned long long)agreed->cycles, (unsigned long long)blocks);
+
+        loadState(agreed);
+    }
+
+    FTRACE("Crosscheck ran %llu blocks of %u instructions", __FILE__, __LINE__,
+        (unsigned long long)blocks, block);
+
+    delete lanes[0].state;
+    delete lanes[1].state;
+    delete agreed;
+
+    if (bLimit) return -1;
+
+    return bDiverged ? 1 : 0;
+}
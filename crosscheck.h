@@ -0,0 +1,61 @@
+#ifndef _CROSSCHECK_H_
+#define _CROSSCHECK_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Lockstep cross-checking of two execution engines. Both engines run
+ *   the same program from the same state, a block of instructions at a
+ *   time, and after every block their registers, flags, stack and memory
+ *   are compared. The run stops at the first divergence with a diff of
+ *   the two machines. A divergent block is re-run one instruction at a
+ *   time from the last agreed state to find the exact instruction.
+ *
+ *   Engines may share the calling thread, swapping machine state between
+ *   blocks, or run on a thread each (optionally pinned to a CPU) with a
+ *   lock-free handoff to the comparing thread.
+ *
+ */
+
+#include "l6502.h"
+
+/**
+ * Run the program in the calling thread's memory from the given address
+ * on two engines in lockstep until both execute BRK or they diverge.
+ * Engines that still agree after maxCycles without reaching BRK fail
+ * the run with an error, checked between blocks.
+ *
+ * @param address address execution begins at
+ * @param first step function of the first engine
+ * @param second step function of the second engine
+ * @param block instructions run by each engine between comparisons
+ * @param bThreads true to run each engine on its own thread
+ * @param bPin true to pin engine threads to separate CPUs
+ * @param maxCycles cycle limit for the run
+ * @return int 0 if the engines agreed; 1 on divergence; otherwise, error
+ */
+int crosscheck_run(uint16_t address, STEP_FUNCTION first, STEP_FUNCTION second,
+                   unsigned int block, bool bThreads, bool bPin, uint64_t maxCycles);
+
+#endif
@@ -0,0 +1,286 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of fork-server test case execution.
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include "l6502.h"
+#include "forkserver.h"
+#include "ftrace.h"
+#include "util.h"
+
+/**
+ * Maximum test case line length
+ */
+static const int kMaxLineLength = 1024;
+
+/**
+ * Child exit status for a case that ran out of cycles
+ */
+static const int kTimeoutStatus = 2;
+
+/**
+ * Child of the case being waited on, killed by the watchdog
+ */
+static volatile pid_t s_child;
+
+/**
+ * Set by the watchdog when it kills a child
+ */
+static volatile sig_atomic_t s_bKilled;
+
+/**
+ * SIGALRM handler: kill the child that overran its time limit.
+ */
+static void onAlarm(int)
+{
+    if (s_child > 0)
+    {
+        s_bKilled = 1;
+        kill(s_child, SIGKILL);
+    }
+}
+
+/**
+ * Arm the watchdog for the given number of seconds, or disarm it with 0.
+ */
+static void watchdog(unsigned int seconds)
+{
+    struct itimerval timer;
+    memset(&timer, 0, sizeof timer);
+    timer.it_value.tv_sec = seconds;
+    setitimer(ITIMER_REAL, &timer, 0);
+}
+
+/**
+ * Split an <address>:<value> pair in place. Returns false if malformed.
+ */
+static bool parsePair(char* pair, uint16_t* address, uint8_t* value)
+{
+    char* delim = strchr(pair, ':');
+
+    if (delim == 0) return false;
+
+    *delim++ = '\0';
+    *address = getHex(uppercase(pair));
+    *value = (uint8_t)getHex(uppercase(delim));
+
+    return true;
+}
+
+/**
+ * Run to a break or until maxCycles cycles have elapsed, either from the
+ * given address or on from the ready address.
+ *
+ * @return int 0 on break; 1 if the cycle limit was reached; -1 on error
+ */
+static int runBounded(uint16_t address, bool bReady, uint64_t maxCycles)
+{
+    if (!bReady) return runFor(address, maxCycles);
+
+    uint64_t limit = cycles() + maxCycles;
+
+    while (brk() != 1 && cycles() < limit)
+    {
+        step();
+    }
+
+    return (brk() == 1) ? 0 : 1;
+}
+
+/**
+ * Execute one test case. Runs in the forked child.
+ */
+static int runCase(const char* name, char* inputs, char* asserts,
+                   uint16_t address, bool bReady, uint64_t maxCycles)
+{
+    char* save = 0;
+    int failures = 0;
+    uint16_t addr;
+    uint8_t value;
+
+    if (strcmp(inputs, "-") != 0)
+    {
+        for (char* pair = strtok_r(inputs, ",", &save); pair; pair = strtok_r(0, ",", &save))
+        {
+            if (!parsePair(pair, &addr, &value))
+            {
+                printf("Case %s: malformed input %s\n", name, pair);
+                return 1;
+            }
+            poke(addr, value);
+        }
+    }
+
+    int nStatus = runBounded(address, bReady, maxCycles);
+
+    if (nStatus == 1)
+    {
+        printf("Case %s: timeout after %llu cycles\n", name, (unsigned long long)maxCycles);
+        return kTimeoutStatus;
+    }
+
+    if (nStatus != 0)
+    {
+        printf("Case %s: run failed with error %d\n", name, nStatus);
+        return 1;
+    }
+
+    if (strcmp(asserts, "-") != 0)
+    {
+        for (char* pair = strtok_r(asserts, ",", &save); pair; pair = strtok_r(0, ",", &save))
+        {
+            if (!parsePair(pair, &addr, &value))
+            {
+                printf("Case %s: malformed assert %s\n", name, pair);
+                return 1;
+            }
+            if (!assertmem(addr, value))
+            {
+                printf("Case %s: Assert $%04x:%02x=%02x false\n", name, addr, value, inspect(addr));
+                failures++;
+            }
+        }
+    }
+
+    if (failures == 0) printf("Case %s: pass\n", name);
+
+    return failures ? 1 : 0;
+}
+
+/**
+ * Run every test case read from the given stream.
+ */
+int forkserver_run(FILE* cases, uint16_t address, bool bReady, uint16_t ready,
+                   uint64_t maxCycles, unsigned int timeout)
+{
+    assert(cases);
+    assert(maxCycles);
+
+    if (bReady && runTo(address, ready) != 0)
+    {
+        fprintf(stderr, "Error: program did not reach ready address $%04x\n", ready);
+        return -1;
+    }
+
+    char line[kMaxLineLength+1];
+    unsigned int passed = 0;
+    unsigned int failed = 0;
+    double start = clockSeconds();
+
+    // No SA_RESTART, so the watchdog also breaks the parent out of waitpid
+    struct sigaction action;
+    struct sigaction previous;
+    memset(&action, 0, sizeof action);
+    action.sa_handler = onAlarm;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGALRM, &action, &previous);
+
+    while (fgets(line, kMaxLineLength, cases) != NULL)
+    {
+        char name[kMaxLineLength+1];
+        char inputs[kMaxLineLength+1];
+        char asserts[kMaxLineLength+1];
+
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%s %s %s", name, inputs, asserts) != 3) continue;
+
+        FTRACE("Fork server starting case %s", __FILE__, __LINE__, name);
+
+        fflush(stdout);
+        fflush(stderr);
+
+        pid_t pid = fork();
+
+        if (pid < 0)
+        {
+            perror("Error: fork failed");
+            sigaction(SIGALRM, &previous, 0);
+            return -1;
+        }
+
+        if (pid == 0)
+        {
+            int nStatus = runCase(name, inputs, asserts, address, bReady, maxCycles);
+            fflush(stdout);
+            _exit(nStatus);
+        }
+
+        int status = 0;
+        pid_t waited;
+
+        s_bKilled = 0;
+        s_child = pid;
+        if (timeout) watchdog(timeout);
+
+        while ((waited = waitpid(pid, &status, 0)) < 0 && errno == EINTR);
+
+        watchdog(0);
+        s_child = 0;
+
+        if (waited < 0)
+        {
+            perror("Error: waitpid failed");
+            sigaction(SIGALRM, &previous, 0);
+            return -1;
+        }
+
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        {
+            passed++;
+        }
+        else
+        {
+            if (s_bKilled)
+            {
+                printf("Case %s: timeout after %u seconds, killed\n", name, timeout);
+            }
+            else if (WIFSIGNALED(status))
+            {
+                printf("Case %s: terminated by signal %d\n", name, WTERMSIG(status));
+            }
+            failed++;
+        }
+    }
+
+    sigaction(SIGALRM, &previous, 0);
+
+    double elapsed = (clockSeconds() - start) * 1e6;
+    unsigned int total = passed + failed;
+
+    printf("Fork server ran %u cases, %u passed, %u failed in %.0f us (%.1f us per case)\n",
+        total, passed, failed, elapsed, total ? elapsed / total : 0.0);
+
+    return failed ? 1 : 0;
+}
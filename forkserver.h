@@ -0,0 +1,73 @@
+#ifndef _FORKSERVER_H_
+#define _FORKSERVER_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Fork-server execution of test cases. The program is assembled or
+ *   loaded once and optionally run up to a ready address. A child is
+ *   then forked for each test case; it shares the parent's memory image
+ *   copy-on-write, patches in the case inputs, runs to a break and checks
+ *   the case assertions. A child that runs out of cycles reports a
+ *   timeout; one still running when the time limit expires is killed.
+ *
+ *   Each case costs one fork() and waitpid(), which dominates the run:
+ *   on a single CPU Linux host a case takes about 200 us, against about
+ *   120 us to fork and reap a minimal C program, so a few tens of us
+ *   per case is out of reach while every case gets a fresh process. A
+ *   pool of pre-forked children would only hide that cost on hosts with
+ *   CPUs to spare. Batches of cases that do not need process isolation
+ *   run faster through --jsonl, which resets only dirty pages.
+ *
+ *   Test cases are read one per line as three whitespace separated
+ *   fields: a name, a comma separated list of <address>:<value> inputs
+ *   and a comma separated list of <address>:<value> assertions. Either
+ *   list may be given as "-" when empty. Lines starting with # are
+ *   ignored.
+ *
+ *     # name   inputs             asserts
+ *     small    0010:02,0011:03    8000:05
+ *
+ */
+
+#include <stdio.h>
+
+#include "platform.h"
+
+/**
+ * Run every test case read from the given stream. The program must
+ * already be assembled or loaded.
+ *
+ * @param cases stream of test case lines
+ * @param address address execution begins at
+ * @param bReady true to run to the ready address once before forking
+ * @param ready address at which the parent stops and begins forking
+ * @param maxCycles cycle limit for each case
+ * @param timeout seconds after which a case is killed, or 0 for no limit
+ * @return int 0 if every case passed; otherwise, nonzero
+ */
+int forkserver_run(FILE* cases, uint16_t address, bool bReady, uint16_t ready,
+                   uint64_t maxCycles, unsigned int timeout);
+
+#endif
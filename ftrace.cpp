@@ -40,15 +40,102 @@
 #include "platform.h"
 #include "ftrace.h"
 
-#ifndef FNOTRACE
+#ifndef NOFTRACE
 
 bool g_bTrace = false;
 
+unsigned char g_traceLevels[kTraceCategories] = 
+{
+    kTraceVerbose, kTraceVerbose, kTraceVerbose, kTraceVerbose, kTraceVerbose, kTraceVerbose
+};
+
 static FILE* s_pTraceFile = 0;
 
+static const char* const s_categoryNames[kTraceCategories] = 
+{
+    "exec", "assembler", "debugger", "bus", "devices", "general"
+};
+
+static const char* const s_levelNames[] = 
+{
+    "off", "error", "warn", "info", "debug", "verbose"
+};
+
+//
+// Parse a level name or number, returning -1 if it is neither.
+//
+static int parseLevel(const char* pchLevel)
+{
+    for (int i=kTraceOff; i <= kTraceVerbose; i++)
+    {
+        if (strcmp(pchLevel, s_levelNames[i]) == 0) return i;
+    }
+
+    char* pchEnd = 0;
+    long level = strtol(pchLevel, &pchEnd, 10);
+
+    return (*pchLevel && *pchEnd == '\0' && level >= kTraceOff && level <= kTraceVerbose) ? (int)level : -1;
+}
+
+//
+// Apply an FTRACE specification: a nonzero number, or a comma separated
+// list of <category>[:<level>] entries.
+//
+static void parseSpec(const char* pchSpec)
+{
+    char* pchEnd = 0;
+    long value = strtol(pchSpec, &pchEnd, 10);
+
+    if (*pchSpec && *pchEnd == '\0')
+    {
+        g_bTrace = (value != 0);
+        return;
+    }
+
+    char spec[256];
+    strncpy(spec, pchSpec, sizeof spec - 1);
+    spec[sizeof spec - 1] = '\0';
+
+    memset(g_traceLevels, kTraceOff, sizeof g_traceLevels);
+
+    for (char* pchEntry = strtok(spec, ","); pchEntry; pchEntry = strtok(0, ","))
+    {
+        char* pchLevel = strchr(pchEntry, ':');
+        int level = kTraceVerbose;
+
+        if (pchLevel)
+        {
+            *pchLevel++ = '\0';
+            level = parseLevel(pchLevel);
+        }
+
+        bool bFound = false;
+
+        for (int i=0; i < kTraceCategories; i++)
+        {
+            if (strcmp(pchEntry, "all") == 0 || strcmp(pchEntry, s_categoryNames[i]) == 0)
+            {
+                if (level >= 0) g_traceLevels[i] = (unsigned char)level;
+                bFound = true;
+            }
+        }
+
+        if (!bFound || level < 0)
+        {
+            fprintf(stderr, "Warning: ignoring FTRACE entry %s\n", pchEntry);
+        }
+    }
+
+    g_bTrace = true;
+}
+
 void ftrace_init(const char* const pchFilename)
 {
     s_pTraceFile = (pchFilename!=0)?fopen(pchFilename,"a"):stderr;		
+
+    const char* pchSpec = getenv("FTRACE");
+
+    if (pchSpec) parseSpec(pchSpec);
 }
 
 void ftrace(const char* const pchFormat, ...)
@@ -73,9 +160,14 @@ void ftrace(const char* const pchFormat, ...)
     }
 }
 
+FILE* ftrace_stream()
+{
+    return s_pTraceFile;
+}
+
 void ftrace_cleanup()
 {
     if (g_bTrace && s_pTraceFile != stderr) fclose(s_pTraceFile);
 }
 
-#endif
+#endif // NOFTRACE
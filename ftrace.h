@@ -27,22 +27,31 @@
  *
  * Purpose: 
  *
- *   Interface to a rudimentary program tracing facility. Enable 
- *   tracing by setting the environment variable FTRACE to nonzero.
- *   When tracing is enabled, trace output is written to the
- *   file <process name>.<process id>.
+ *   Interface to a rudimentary program tracing facility. Trace output
+ *   is written to stderr.
  *
- *   Tracing can be safely left in release code; however, if desired,
- *   tracing may be completely disabled by defining NOFTRACE
- *   during compilation.
+ *   Every trace statement belongs to a category and has a level. Enable
+ *   tracing by setting the environment variable FTRACE to a comma
+ *   separated list of <category>[:<level>] entries, for example
  *
- * Notes:
+ *     FTRACE=assembler:debug,debugger
+ *     FTRACE=all:info
+ *     FTRACE=1
+ *
+ *   Categories are exec, assembler, debugger, bus, devices and general
+ *   (or all). Levels are error, warn, info, debug and verbose (or 1-5);
+ *   a category without a level traces at every level. A bare nonzero
+ *   number enables every category. FTRACE_ON() (the -t option) turns on
+ *   every category unless FTRACE selected some.
  *
- *   It would be useful at some point to provide module-specific
- *   trace enabling through the use of additional parameters to
- *   the FTRACE macro and FTRACE enviromental variable.
+ *   Tracing can be safely left in release code. Statements above the
+ *   compile-time level FTRACE_LEVEL_MAX are removed from the binary
+ *   entirely; release builds set it to exclude the verbose, per
+ *   instruction exec trace. Defining NOFTRACE removes all tracing.
+ *
+ * Notes:
  *
- *   The FTRACE macro uses vfprintf for output formatting.
+ *   The FTRACE macros use vfprintf for output formatting.
  *   Insufficient and/or improper argument types may cause run-time
  *   errors (core dumps/crashes) when tracing is enabled. Therefore, 
  *   tracing statements should be tested before being placed in 
@@ -52,25 +61,75 @@
  *
  */
 
+#include <stdio.h>
+
+//
+// Trace categories
+//
+typedef enum
+{
+    kTraceExec,          // Instruction execution
+    kTraceAssembler,     // Assembler and label resolution
+    kTraceDebugger,      // Interactive debugger
+    kTraceBus,           // Memory shared between cores
+    kTraceDevices,       // Memory mapped devices
+    kTraceGeneral,       // Everything else
+    kTraceCategories
+} TRACE_CATEGORY;
+
+//
+// Trace levels, from least to most verbose
+//
+typedef enum
+{
+    kTraceOff,
+    kTraceError,
+    kTraceWarn,
+    kTraceInfo,
+    kTraceDebug,
+    kTraceVerbose
+} TRACE_LEVEL;
+
+//
+// Most verbose level compiled in. Statements above it vanish.
+//
+#ifndef FTRACE_LEVEL_MAX
+#define FTRACE_LEVEL_MAX 5
+#endif
+
 #ifdef NOFTRACE
-#define FTRACE(args)
-#define ftrace_init(args)
-#define ftrace_deinit(args)
+#define FTRACE(...) do {} while (0)
+#define FTRACE_AT(...) do {} while (0)
+#define FTRACE_ON()
+#define FTRACE_OFF()
+#define FTRACE_TOGGLE()
+inline void ftrace_init(const char* const pchFilename=0) {}
+inline FILE* ftrace_stream() { return stderr; }
+inline void ftrace_cleanup() {}
 #else
 //
-// Use this macro to create a trace output statement that is
-// conditionally executed. The macros __FILE__ and __LINE__ 
-// should be part of the statement as follows:
+// Use this macro to create a trace output statement in a category at a
+// level. The macros __FILE__ and __LINE__ should be part of the
+// statement as follows:
+//
+//   FTRACE_AT(kTraceAssembler, kTraceDebug, "<printf format specification>",__FILE__,__LINE__,...);
+//
+#define FTRACE_AT(category,level,str,...) \
+    do { if ((level) <= FTRACE_LEVEL_MAX && g_bTrace && g_traceLevels[category] >= (level)) ftrace(str,__VA_ARGS__); } while (0)
+
+//
+// General category trace statement at info level:
 //
 //   FTRACE("<printf format specification>",__FILE__,__LINE__,...);
 //
-#define FTRACE(str,...) if (g_bTrace) ftrace(str,__VA_ARGS__)
+#define FTRACE(str,...) FTRACE_AT(kTraceGeneral,kTraceInfo,str,__VA_ARGS__)
 
 //
 // Convenience macros to selectively turning tracing on/off
 //
 #define FTRACE_ON() g_bTrace = true
 #define FTRACE_OFF() g_bTrace = false
+#define FTRACE_TOGGLE() g_bTrace = !g_bTrace
 
 //
 // Controls enabling of trace facility
@@ -78,18 +137,28 @@
 extern bool g_bTrace;
 
 //
-// Initializes trace facility by setting global
-// and opening trace file.
+// Most verbose level enabled for each category
+//
+extern unsigned char g_traceLevels[kTraceCategories];
+
+//
+// Initializes trace facility by reading the FTRACE environment
+// variable and opening the trace file.
 //
 void ftrace_init(const char* const pchFilename=0);
 
 //
 // This function performs the trace output. It should not
-// be called directly. Always use the FTRACE macro for
+// be called directly. Always use the FTRACE macros for
 // conditional output.
 //
 void ftrace(const char* const pchFormat, ...);
 
+//
+// Returns the stream trace output is written to.
+//
+FILE* ftrace_stream();
+
 //
 // Cleans up trace facility by closing any open file.
 //
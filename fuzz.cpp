@@ -0,0 +1,371 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the coverage-guided fuzzer.
+ *
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "l6502.h"
+#include "ftrace.h"
+#include "fuzz.h"
+#include "util.h"
+
+/**
+ * Coverage bitmap size (edges hash into this many slots)
+ */
+static const uint32_t kMapSize = 0x10000;
+
+/**
+ * Opcode of TXS, the one instruction allowed to move SP arbitrarily
+ */
+static const uint8_t kTXS = 0x9A;
+
+/**
+ * Largest stack pointer change a single instruction can make
+ */
+static const int kMaxStackDelta = 3;
+
+/**
+ * Outcome of a single run
+ */
+typedef enum
+{
+    kRunBreak,
+    kRunTimeout,
+    kRunIllegal,
+    kRunStackWrap,
+    kRunAssert
+} RUN_RESULT;
+
+static const char* kResultNames[] = {"break", "timeout", "illegal opcode", "stack wrap", "assert"};
+
+/**
+ * Campaign state shared by all fuzzing threads
+ */
+static const FUZZ_CONFIG* s_config;
+static std::vector<uint8_t> s_snapshot;
+static uint32_t s_inputSize;
+static bool s_legal[256];
+static bool s_control[256];
+static std::atomic<uint8_t> s_virgin[kMapSize];
+static std::atomic<uint64_t> s_execs;
+static std::atomic<uint64_t> s_timeouts;
+static std::atomic<uint32_t> s_edges;
+static std::mutex s_mutex;
+static std::vector<std::vector<uint8_t> > s_corpus;
+static std::set<std::pair<int, uint16_t> > s_crashes;
+
+/**
+ * Per-thread xorshift random number generator.
+ */
+static thread_local uint64_t s_rng;
+
+static uint32_t random32()
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 7;
+    s_rng ^= s_rng << 17;
+    return (uint32_t)(s_rng >> 16);
+}
+
+/**
+ * Map a hit count to its AFL-style bucket bit.
+ */
+static uint8_t bucket(uint8_t count)
+{
+    if (count <= 3) return (uint8_t)(1 << (count - 1));
+    if (count <= 7) return 0x08;
+    if (count <= 15) return 0x10;
+    if (count <= 31) return 0x20;
+    if (count <= 127) return 0x40;
+    return 0x80;
+}
+
+/**
+ * Write an input to <outDir>/<kind>-<index>.bin.
+ */
+static void saveInput(const char* kind, size_t index, const std::vector<uint8_t>& input)
+{
+    if (s_config->outDir == 0) return;
+
+    char filename[1024];
+    snprintf(filename, sizeof filename, "%s/%s-%06zu.bin", s_config->outDir, kind, index);
+
+    FILE* fp = fopen(filename, "wb");
+    if (fp == NULL) return;
+    fwrite(&input[0], 1, input.size(), fp);
+    fclose(fp);
+}
+
+/**
+ * Restore the snapshot, place the input in its regions and run it,
+ * counting edge hits into trace and listing the slots touched.
+ */
+static RUN_RESULT execute(const std::vector<uint8_t>& input, uint8_t* trace,
+                          std::vector<uint16_t>& touched)
+{
+    restoreDirty(&s_snapshot[0]);
+
+    uint32_t offset = 0;
+    for (unsigned int r=0; r < s_config->regions; r++)
+    {
+        uint32_t length = (uint32_t)s_config->last[r] - s_config->first[r] + 1;
+        writeBlock(s_config->first[r], &input[offset], length);
+        offset += length;
+    }
+
+    reset(s_config->address);
+
+    for (;;)
+    {
+        if (brk() == 1) return kRunBreak;
+        if (cycles() >= s_config->maxCycles) return kRunTimeout;
+
+        uint16_t from = pc();
+
+        if (s_config->bAssert && from == s_config->assertAddress) return kRunAssert;
+
+        uint8_t opcode = inspect(from);
+
+        if (!s_legal[opcode]) return kRunIllegal;
+
+        uint8_t before = sp();
+
+        step();
+
+        if (s_control[opcode])
+        {
+            uint16_t edge = (uint16_t)((from * 0x9E37u) ^ pc());
+            if (trace[edge]++ == 0) touched.push_back(edge);
+            if (trace[edge] == 0) trace[edge] = 0xff;
+        }
+
+        int delta = (int)sp() - (int)before;
+
+        if (opcode != kTXS && (delta > kMaxStackDelta || delta < -kMaxStackDelta))
+        {
+            return kRunStackWrap;
+        }
+    }
+}
+
+/**
+ * Mutate an input in place using a stack of random byte-level
+ * operations, occasionally splicing with another corpus entry.
+ */
+static void mutate(std::vector<uint8_t>& input, const std::vector<uint8_t>& other)
+{
+    static const uint8_t interesting[] = {0x00, 0x01, 0x02, 0x10, 0x20, 0x40, 0x7f, 0x80, 0x81, 0xfe, 0xff};
+    unsigned int count = 1 + random32() % 8;
+
+    for (unsigned int i=0; i < count; i++)
+    {
+        uint32_t pos = random32() % input.size();
+
+        switch (random32() % 6)
+        {
+        case 0:
+            input[pos] ^= (uint8_t)(1 << (random32() % 8));
+            break;
+        case 1:
+            input[pos] = (uint8_t)random32();
+            break;
+        case 2:
+            input[pos] += (uint8_t)(1 + random32() % 35);
+            break;
+        case 3:
+            input[pos] -= (uint8_t)(1 + random32() % 35);
+            break;
+        case 4:
+            input[pos] = interesting[random32() % sizeof interesting];
+            break;
+        case 5:
+            {
+                uint32_t split = random32() % input.size();
+                memcpy(&input[split], &other[split], input.size() - split);
+            }
+            break;
+        }
+    }
+}
+
+/**
+ * Fuzzing thread body.
+ */
+static void fuzzThread(unsigned int index)
+{
+    std::vector<uint8_t> trace(kMapSize, 0);
+    std::vector<uint16_t> touched;
+    std::vector<uint8_t> input;
+    std::vector<uint8_t> other;
+
+    s_rng = 0x9E3779B97F4A7C15ull * (index + 1);
+
+    // Later runs restore only the pages the previous run wrote
+    writeBlock(0, &s_snapshot[0], k64K);
+    markClean();
+
+    while (s_execs.fetch_add(1) < s_config->iterations)
+    {
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            input = s_corpus[random32() % s_corpus.size()];
+            other = s_corpus[random32() % s_corpus.size()];
+        }
+
+        if (s_inputSize) mutate(input, other);
+
+        touched.clear();
+        RUN_RESULT result = execute(input, &trace[0], touched);
+
+        bool bNew = false;
+
+        for (size_t i=0; i < touched.size(); i++)
+        {
+            uint16_t edge = touched[i];
+            uint8_t bit = bucket(trace[edge]);
+            uint8_t seen = s_virgin[edge].fetch_or(bit);
+
+            if ((seen & bit) == 0) bNew = true;
+            if (seen == 0) s_edges.fetch_add(1);
+
+            trace[edge] = 0;
+        }
+
+        if (result == kRunTimeout) s_timeouts.fetch_add(1);
+
+        if (result >= kRunIllegal)
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+
+            if (s_crashes.insert(std::make_pair((int)result, pc())).second)
+            {
+                printf("Crash: %s at $%04x, input ", kResultNames[result], pc());
+                for (size_t i=0; i < input.size(); i++) printf("%02x", input[i]);
+                printf("\n");
+                fflush(stdout);
+                saveInput("crash", s_crashes.size(), input);
+            }
+        }
+        else if (bNew)
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            s_corpus.push_back(input);
+            saveInput("corpus", s_corpus.size(), input);
+            FTRACE("Fuzzer corpus grew to %zu entries", __FILE__, __LINE__, s_corpus.size());
+        }
+    }
+}
+
+/**
+ * Fuzz the program in the calling thread's memory.
+ */
+int fuzz_run(const FUZZ_CONFIG* config)
+{
+    assert(config);
+
+    if (config->regions == 0 || config->regions > kMaxFuzzRegions) return -1;
+
+    s_config = config;
+    s_inputSize = 0;
+
+    for (unsigned int r=0; r < config->regions; r++)
+    {
+        if (config->last[r] < config->first[r]) return -1;
+        s_inputSize += (uint32_t)config->last[r] - config->first[r] + 1;
+    }
+
+    for (unsigned int op=0; op < 256; op++)
+    {
+        const char* symbol = "";
+        s_legal[op] = opcodeInfo((uint8_t)op, &symbol, 0, 0, 0);
+        s_control[op] = s_legal[op] &&
+            ((symbol[0] == 'B' && strcmp(symbol, "BIT") != 0 && strcmp(symbol, "BITZ") != 0 &&
+              strcmp(symbol, "BRK") != 0) ||
+             symbol[0] == 'J' || strcmp(symbol, "RTS") == 0 || strcmp(symbol, "RTI") == 0);
+    }
+
+    //
+    // The program as loaded is the snapshot, and its region contents
+    // are the seed input.
+    //
+    s_snapshot.assign(k64K, 0);
+    readBlock(0, &s_snapshot[0], k64K);
+
+    std::vector<uint8_t> seed;
+    for (unsigned int r=0; r < config->regions; r++)
+    {
+        for (uint32_t addr=config->first[r]; addr <= config->last[r]; addr++)
+        {
+            seed.push_back(s_snapshot[addr]);
+        }
+    }
+
+    s_corpus.clear();
+    s_corpus.push_back(seed);
+    s_crashes.clear();
+    s_execs = 0;
+    s_timeouts = 0;
+    s_edges = 0;
+    for (uint32_t i=0; i < kMapSize; i++) s_virgin[i] = 0;
+
+    unsigned int jobs = config->jobs ? config->jobs : std::thread::hardware_concurrency();
+    if (jobs == 0) jobs = 1;
+
+    double start = clockSeconds();
+
+    std::vector<std::thread> threads;
+    for (unsigned int i=0; i < jobs; i++)
+    {
+        threads.push_back(std::thread(fuzzThread, i));
+    }
+    for (unsigned int i=0; i < jobs; i++)
+    {
+        threads[i].join();
+    }
+
+    double elapsed = clockSeconds() - start;
+    uint64_t execs = config->iterations;
+
+    printf("Fuzzer ran %llu inputs on %u threads in %.2f s (%.0f execs/s): "
+           "%u edges, %zu corpus entries, %zu unique crashes, %llu timeouts\n",
+        (unsigned long long)execs, jobs, elapsed, elapsed > 0 ? execs / elapsed : 0.0,
+        s_edges.load(), s_corpus.size(), s_crashes.size(),
+        (unsigned long long)s_timeouts.load());
+
+    writeBlock(0, &s_snapshot[0], k64K);
+
+    return s_crashes.empty() ? 0 : 1;
+}
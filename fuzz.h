@@ -0,0 +1,75 @@
+#ifndef _FUZZ_H_
+#define _FUZZ_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Coverage-guided in-process fuzzing of guest programs. Designated
+ *   input regions of guest memory are mutated and the program is run
+ *   from a memory snapshot on every iteration, without reloading it.
+ *
+ *   Edge coverage is collected from branch, jump, subroutine call and
+ *   return transitions into a 64K bitmap with AFL-style hit count
+ *   buckets. Inputs that reach new coverage join a corpus shared by all
+ *   fuzzing threads.
+ *
+ *   A crash is an unimplemented opcode, a stack pointer wrap or reaching
+ *   the assert address. Runs that exceed the cycle limit are counted as
+ *   timeouts but are not crashes.
+ *
+ */
+
+#include "platform.h"
+
+/**
+ * Maximum number of input regions
+ */
+static const unsigned int kMaxFuzzRegions = 16;
+
+/**
+ * Fuzzing campaign configuration
+ */
+typedef struct
+{
+    uint16_t address;                    // Address execution begins at
+    uint16_t first[kMaxFuzzRegions];     // First address of each input region
+    uint16_t last[kMaxFuzzRegions];      // Last address of each input region
+    unsigned int regions;                // Number of input regions
+    bool bAssert;                        // True if assertAddress is set
+    uint16_t assertAddress;              // Reaching this address is a crash
+    uint64_t iterations;                 // Total runs across all threads
+    uint64_t maxCycles;                  // Cycle limit per run
+    unsigned int jobs;                   // Fuzzing threads, 0 for one per CPU
+    const char* outDir;                  // Directory for corpus and crashes or 0
+} FUZZ_CONFIG;
+
+/**
+ * Fuzz the program in the calling thread's memory.
+ *
+ * @param config campaign configuration
+ * @return int 0 if no crash was found; 1 if crashes were found; otherwise, error
+ */
+int fuzz_run(const FUZZ_CONFIG* config);
+
+#endif
@@ -0,0 +1,286 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the memory access heatmap.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "l6502.h"
+#include "heatmap.h"
+#include "profile.h"
+
+/**
+ * Number of addresses
+ */
+static const uint32_t kAddresses = 65536;
+
+/**
+ * Base of the stack page
+ */
+static const uint16_t kStackPage = 0x0100;
+
+/**
+ * What an instruction does with its effective address
+ */
+typedef enum
+{
+    kAccessNone,    // No data access (implied, immediate, branches, jumps)
+    kAccessRead,
+    kAccessWrite,
+    kAccessModify   // Read then write
+} ACCESS;
+
+/**
+ * Per-opcode decode, built by heatmap_start
+ */
+typedef struct
+{
+    uint8_t mode;    // ADDRESSING_MODE
+    uint8_t access;  // ACCESS
+    uint8_t bytes;   // Instruction length
+    int8_t stack;    // Bytes pushed (positive) or pulled (negative)
+} HEAT_DECODE;
+
+#ifdef HEATMAP
+bool g_bHeatmap = false;
+#endif
+
+static uint32_t s_reads[kAddresses];
+static uint32_t s_writes[kAddresses];
+static uint32_t s_fetches[kAddresses];
+static HEAT_DECODE s_decode[256];
+
+/**
+ * Saturating increment
+ */
+static inline void count(uint32_t* counts, uint16_t address)
+{
+    if (counts[address] != 0xffffffff) counts[address]++;
+}
+
+#ifdef HEATMAP
+/**
+ * Classify an instruction by mnemonic.
+ */
+static HEAT_DECODE decode(uint8_t opcode)
+{
+    static const char* kReads[] = {"ADC", "AND", "BIT", "CMP", "CPX", "CPY", "EOR",
+                                   "LDA", "LDX", "LDY", "ORA", "SBC", 0};
+    static const char* kWrites[] = {"STA", "STX", "STY", 0};
+    static const char* kModifies[] = {"ASL", "LSR", "ROL", "ROR", "INC", "DEC", 0};
+
+    HEAT_DECODE result = {kModeImplied, kAccessNone, 0, 0};
+    const char* symbol;
+
+    if (!opcodeInfo(opcode, &symbol, 0, &result.bytes, 0)) return result;
+
+    result.mode = profile_addressing(opcode);
+
+    std::string mnemonic(symbol, 3);
+
+    for (int ii=0; kReads[ii]; ii++) if (mnemonic == kReads[ii]) result.access = kAccessRead;
+    for (int ii=0; kWrites[ii]; ii++) if (mnemonic == kWrites[ii]) result.access = kAccessWrite;
+    for (int ii=0; kModifies[ii]; ii++) if (mnemonic == kModifies[ii]) result.access = kAccessModify;
+
+    if (result.mode == kModeImplied || result.mode == kModeAccumulator ||
+        result.mode == kModeImmediate)
+    {
+        result.access = kAccessNone;
+    }
+
+    if (mnemonic == "PHA" || mnemonic == "PHP") result.stack = 1;
+    if (mnemonic == "JSR") result.stack = 2;
+    if (mnemonic == "PLA" || mnemonic == "PLP") result.stack = -1;
+    if (mnemonic == "RTS") result.stack = -2;
+    if (mnemonic == "RTI") result.stack = -3;
+
+    return result;
+}
+#endif
+
+/**
+ * Clear the counters and start counting.
+ */
+int heatmap_start()
+{
+#ifdef HEATMAP
+    memset(s_reads, 0, sizeof s_reads);
+    memset(s_writes, 0, sizeof s_writes);
+    memset(s_fetches, 0, sizeof s_fetches);
+
+    for (unsigned int op=0; op < 256; op++) s_decode[op] = decode((uint8_t)op);
+
+    g_bHeatmap = true;
+
+    return 0;
+#else
+    return ENOTSUP;
+#endif
+}
+
+/**
+ * Count the accesses made by the instruction about to execute.
+ */
+void heatmap_step(uint8_t opcode, uint16_t pc, uint8_t x, uint8_t y, uint8_t sp,
+                  const uint8_t* memory)
+{
+    const HEAT_DECODE& inst = s_decode[opcode];
+
+    for (uint8_t ii=0; ii < inst.bytes; ii++) count(s_fetches, (uint16_t)(pc + ii));
+
+    for (int8_t ii=0; ii < inst.stack; ii++) count(s_writes, kStackPage + (uint8_t)(sp - ii));
+    for (int8_t ii=0; ii < -inst.stack; ii++) count(s_reads, kStackPage + (uint8_t)(sp + 1 + ii));
+
+    uint8_t lo = memory[(uint16_t)(pc + 1)];
+    uint16_t operand = (uint16_t)(lo | (memory[(uint16_t)(pc + 2)] << 8));
+    uint16_t pointer;
+    uint16_t address;
+
+    switch (inst.mode)
+    {
+    case kModeZeroPage:     address = lo; break;
+    case kModeZeroPageX:    address = (uint8_t)(lo + x); break;
+    case kModeZeroPageY:    address = (uint8_t)(lo + y); break;
+    case kModeAbsolute:     address = operand; break;
+    case kModeAbsoluteX:    address = (uint16_t)(operand + x); break;
+    case kModeAbsoluteY:    address = (uint16_t)(operand + y); break;
+    case kModeIndirect:
+        // JMP (operand): only the pointer is read
+        count(s_reads, operand);
+        count(s_reads, (uint16_t)(operand + 1));
+        return;
+    case kModeIndexedIndirect:
+        pointer = (uint8_t)(lo + x);
+        count(s_reads, pointer);
+        count(s_reads, (uint8_t)(pointer + 1));
+        address = (uint16_t)(memory[pointer] | (memory[(uint8_t)(pointer + 1)] << 8));
+        break;
+    case kModeIndirectIndexed:
+        count(s_reads, lo);
+        count(s_reads, (uint8_t)(lo + 1));
+        address = (uint16_t)((memory[lo] | (memory[(uint8_t)(lo + 1)] << 8)) + y);
+        break;
+    default:
+        return;
+    }
+
+    if (inst.access == kAccessRead || inst.access == kAccessModify) count(s_reads, address);
+    if (inst.access == kAccessWrite || inst.access == kAccessModify) count(s_writes, address);
+}
+
+/**
+ * Write one row per accessed address.
+ */
+int heatmap_csv(const char* filename)
+{
+    FILE* fp = fopen(filename, "w");
+
+    if (!fp) return errno;
+
+    fprintf(fp, "address,reads,writes,fetches\n");
+
+    for (uint32_t address=0; address < kAddresses; address++)
+    {
+        if (s_reads[address] || s_writes[address] || s_fetches[address])
+        {
+            fprintf(fp, "%04x,%u,%u,%u\n", address,
+                s_reads[address], s_writes[address], s_fetches[address]);
+        }
+    }
+
+    if (fclose(fp) != 0) return errno;
+
+    return 0;
+}
+
+/**
+ * Piecewise-linear log2(1+value), close enough for shading.
+ */
+static double shade(uint32_t value)
+{
+    uint64_t v = (uint64_t)value + 1;
+    int msb = 63 - __builtin_clzll(v);
+
+    return msb + (double)(v - (1ull << msb)) / (1ull << msb);
+}
+
+/**
+ * Write one counter array as a 256x256 binary PPM, black through red and
+ * yellow to white on a log scale.
+ */
+static int writePpm(const char* filename, const uint32_t* counts)
+{
+    uint32_t highest = 0;
+
+    for (uint32_t address=0; address < kAddresses; address++)
+    {
+        if (counts[address] > highest) highest = counts[address];
+    }
+
+    FILE* fp = fopen(filename, "wb");
+
+    if (!fp) return errno;
+
+    fprintf(fp, "P6\n256 256\n255\n");
+
+    double scale = highest ? 1.0 / shade(highest) : 0.0;
+
+    for (uint32_t address=0; address < kAddresses; address++)
+    {
+        double heat = 3.0 * shade(counts[address]) * scale;
+        uint8_t rgb[3];
+
+        for (int channel=0; channel < 3; channel++)
+        {
+            double level = heat - channel;
+            rgb[channel] = (uint8_t)(255.0 * (level < 0.0 ? 0.0 : level > 1.0 ? 1.0 : level));
+        }
+
+        fwrite(rgb, 1, sizeof rgb, fp);
+    }
+
+    if (fclose(fp) != 0) return errno;
+
+    return 0;
+}
+
+/**
+ * Write the read, write and fetch images.
+ */
+int heatmap_ppm(const char* prefix)
+{
+    std::string base(prefix);
+    int nStatus;
+
+    if ((nStatus = writePpm((base + "-read.ppm").c_str(), s_reads)) != 0) return nStatus;
+    if ((nStatus = writePpm((base + "-write.ppm").c_str(), s_writes)) != 0) return nStatus;
+
+    return writePpm((base + "-exec.ppm").c_str(), s_fetches);
+}
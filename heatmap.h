@@ -0,0 +1,99 @@
+#ifndef _HEATMAP_H_
+#define _HEATMAP_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Memory access heatmap. Counts reads, writes and instruction fetches
+ *   for each of the 65536 addresses in three flat arrays, and exports
+ *   them as CSV and as 256x256 PPM images (one row per page).
+ *
+ *   Accesses are derived in step() from the opcode's addressing mode and
+ *   the registers before it executes, so the instruction handlers are
+ *   untouched. Stack pushes and pulls are counted at $0100+SP, where a
+ *   6502 keeps its stack.
+ *
+ *   The step() hook only exists when built with HEATMAP defined (debug
+ *   and profile builds); in release builds it compiles to nothing and
+ *   heatmap_start fails with ENOTSUP.
+ *
+ */
+
+#include "platform.h"
+
+#ifdef HEATMAP
+
+//
+// True while memory accesses are being counted
+//
+extern bool g_bHeatmap;
+
+#define HEATMAP_STEP(opcode,pc,x,y,sp,memory) \
+    if (g_bHeatmap) heatmap_step(opcode,pc,x,y,sp,memory)
+
+#else
+
+#define HEATMAP_STEP(opcode,pc,x,y,sp,memory)
+
+#endif
+
+/**
+ * Clear the counters and start counting.
+ *
+ * @return int 0 on success; otherwise, error number (ENOTSUP when the
+ * hook is compiled out)
+ */
+int heatmap_start();
+
+/**
+ * Count the accesses made by the instruction about to execute.
+ *
+ * @param opcode opcode at the program counter
+ * @param pc program counter
+ * @param x index register X
+ * @param y index register Y
+ * @param sp stack pointer
+ * @param memory the 64K address space
+ */
+void heatmap_step(uint8_t opcode, uint16_t pc, uint8_t x, uint8_t y, uint8_t sp,
+                  const uint8_t* memory);
+
+/**
+ * Write one "address,reads,writes,fetches" row per accessed address.
+ *
+ * @param filename file to create
+ * @return int 0 on success; otherwise, error number
+ */
+int heatmap_csv(const char* filename);
+
+/**
+ * Write <prefix>-read.ppm, <prefix>-write.ppm and <prefix>-exec.ppm,
+ * shading each address by the log of its count.
+ *
+ * @param prefix file name prefix
+ * @return int 0 on success; otherwise, error number
+ */
+int heatmap_ppm(const char* prefix);
+
+#endif
@@ -26,9 +26,9 @@ endif
 
 ifeq ($(PLATFORM),linux)
 CC=gcc
-DEBUGFLAGS = -g3 -DDEBUG
-NODEBUGFLAGS = -O3 -DNDEBUG -DOFI_NOTRACE 
-PROFILEFLAGS = $(NODEBUGFLAGS) -pg
+DEBUGFLAGS = -g3 -DDEBUG -DHEATMAP
+NODEBUGFLAGS = -O3 -DNDEBUG -DFTRACE_LEVEL_MAX=4 
+PROFILEFLAGS = $(NODEBUGFLAGS) -pg -DHEATMAP
 CCFLAGS += -Wall -D_REENTRANT
 # Auto-detect CPU architecture for Linux
 UNAME_M := $(shell uname -m)
@@ -46,8 +46,8 @@ endif
 else
 ifeq ($(PLATFORM),macos)
 CC=gcc
-DEBUGFLAGS = -g3 -DDEBUG
-NODEBUGFLAGS = -O3 -DNDEBUG
+DEBUGFLAGS = -g3 -DDEBUG -DHEATMAP
+NODEBUGFLAGS = -O3 -DNDEBUG -DFTRACE_LEVEL_MAX=4
 CCFLAGS += -Wall -D_REENTRANT
 # Auto-detect CPU architecture for macOS
 UNAME_M := $(shell uname -m)
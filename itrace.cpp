@@ -0,0 +1,346 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the pipelined instruction trace.
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "l6502.h"
+#include "itrace.h"
+#include "tracefile.h"
+
+/**
+ * Ring capacity in records (a power of two)
+ */
+static const uint32_t kRingSize = 1 << 16;
+
+/**
+ * Formatted output is written in chunks of this many bytes
+ */
+static const size_t kOutputSize = 1 << 16;
+
+/**
+ * Longest formatted record
+ */
+static const size_t kMaxRecordLength = 128;
+
+/**
+ * A side waiting on the ring yields this many times before it starts
+ * sleeping, doubling the sleep from kMinSleep up to kMaxSleep
+ */
+static const unsigned int kSpinRounds = 64;
+static const unsigned int kMinSleepMicroseconds = 10;
+static const unsigned int kMaxSleepMicroseconds = 1000;
+
+std::atomic<bool> g_bITrace(false);
+
+static ITRACE_RECORD s_ring[kRingSize];
+
+//
+// Producer and consumer indexes on separate cache lines. Each side keeps
+// a private copy of the other's index and only reloads it when the ring
+// looks full (producer) or empty (consumer).
+//
+alignas(64) static std::atomic<uint64_t> s_head;
+alignas(64) static std::atomic<uint64_t> s_tail;
+alignas(64) static uint64_t s_cachedTail;
+static std::atomic<bool> s_bStop;
+static std::atomic<std::thread::id> s_producer;
+static std::atomic<uint64_t> s_session;
+static bool s_bDrop;
+static uint64_t s_dropped;
+static uint64_t s_stalls;
+static FILE* s_out;
+static TRACE_WRITER* s_writer;
+static int s_writeStatus;
+static std::thread s_consumer;
+
+/**
+ * Append two lowercase hex digits.
+ */
+static char* hex2(char* out, uint8_t value)
+{
+    static const char digits[] = "0123456789abcdef";
+    out[0] = digits[value >> 4];
+    out[1] = digits[value & 0xf];
+    return out + 2;
+}
+
+/**
+ * Append a label and value, e.g. " A=3f".
+ */
+static char* field(char* out, const char* label, uint8_t value)
+{
+    while (*label) *out++ = *label++;
+    return hex2(out, value);
+}
+
+/**
+ * Format one record as a trace line.
+ */
+char* itrace_format(char* out, const ITRACE_RECORD& record)
+{
+    const char* symbol = "";
+
+    if (!opcodeInfo(record.opcode, &symbol, 0, 0, 0)) symbol = "???";
+
+    out = field(out, "PC=", (uint8_t)(record.pc >> 8));
+    out = hex2(out, (uint8_t)record.pc);
+    out = field(out, " OPCODE=", record.opcode);
+    *out++ = ' ';
+    *out++ = '(';
+    while (*symbol) *out++ = *symbol++;
+    *out++ = ')';
+    out = field(out, " SP=", record.sp);
+    out = field(out, " A=", record.a);
+    out = field(out, " X=", record.x);
+    out = field(out, " Y=", record.y);
+    out = field(out, " P=", record.p);
+    out += sprintf(out, " CYCLES=%llu\n", (unsigned long long)record.cycles);
+    return out;
+}
+
+/**
+ * Wait for the other side of the ring. Yields at first so a busy ring
+ * keeps its latency, then backs off to sleeping so an idle one (a
+ * throttled run, the debugger prompt) doesn't hold a CPU.
+ */
+static void backoff(unsigned int& rounds)
+{
+    if (rounds < kSpinRounds)
+    {
+        std::this_thread::yield();
+    }
+    else
+    {
+        unsigned int shift = rounds - kSpinRounds;
+        unsigned int sleep = (shift < 7) ? kMinSleepMicroseconds << shift : kMaxSleepMicroseconds;
+
+        if (sleep > kMaxSleepMicroseconds) sleep = kMaxSleepMicroseconds;
+
+        std::this_thread::sleep_for(std::chrono::microseconds(sleep));
+    }
+
+    rounds++;
+}
+
+/**
+ * Consumer thread body: format or encode records in batches until
+ * stopped and the ring is empty.
+ */
+static void consume()
+{
+    static char buffer[kOutputSize + kMaxRecordLength];
+    uint64_t tail = s_tail.load(std::memory_order_relaxed);
+    unsigned int rounds = 0;
+
+    for (;;)
+    {
+        uint64_t head = s_head.load(std::memory_order_acquire);
+
+        if (head == tail)
+        {
+            if (s_bStop.load(std::memory_order_acquire) &&
+                head == s_head.load(std::memory_order_acquire)) break;
+
+            backoff(rounds);
+            continue;
+        }
+
+        rounds = 0;
+
+        if (s_writer)
+        {
+            for ( ; tail != head; tail++)
+            {
+                int nStatus = tracefile_write(s_writer, s_ring[tail & (kRingSize - 1)]);
+                if (nStatus && s_writeStatus == 0) s_writeStatus = nStatus;
+            }
+
+            s_tail.store(tail, std::memory_order_release);
+            continue;
+        }
+
+        char* out = buffer;
+
+        while (tail != head)
+        {
+            out = itrace_format(out, s_ring[tail & (kRingSize - 1)]);
+            tail++;
+
+            if ((size_t)(out - buffer) >= kOutputSize)
+            {
+                fwrite(buffer, 1, out - buffer, s_out);
+                out = buffer;
+            }
+        }
+
+        s_tail.store(tail, std::memory_order_release);
+
+        fwrite(buffer, 1, out - buffer, s_out);
+    }
+
+    if (s_out) fflush(s_out);
+}
+
+/**
+ * Reset the ring and start the consumer thread.
+ */
+static void start(bool bDrop)
+{
+    s_bDrop = bDrop;
+    s_head = 0;
+    s_tail = 0;
+    s_cachedTail = 0;
+    s_dropped = 0;
+    s_stalls = 0;
+    s_writeStatus = 0;
+    s_bStop = false;
+    s_producer = std::thread::id();
+    s_session++;
+    s_consumer = std::thread(consume);
+
+    g_bITrace = true;
+}
+
+/**
+ * Start the consumer thread writing text.
+ */
+int itrace_start(FILE* out, bool bDrop)
+{
+    assert(out);
+
+    if (g_bITrace) return EBUSY;
+
+    s_out = out;
+    s_writer = 0;
+    start(bDrop);
+
+    return 0;
+}
+
+/**
+ * Start the consumer thread writing a binary trace file.
+ */
+int itrace_start_file(const char* filename, bool bCompress, bool bDrop)
+{
+    assert(filename);
+
+    if (g_bITrace) return EBUSY;
+
+    int nStatus = 0;
+
+    s_writer = tracefile_create(filename, bCompress, &nStatus);
+    if (s_writer == 0) return nStatus;
+
+    s_out = 0;
+    start(bDrop);
+
+    return 0;
+}
+
+/**
+ * Queue a record for the consumer thread.
+ */
+bool itrace_push(const ITRACE_RECORD& record)
+{
+    // The producer is claimed once per trace session, so a thread that
+    // produced for an earlier session claims the ring again
+    static thread_local uint64_t session = 0;
+    uint64_t current = s_session.load(std::memory_order_relaxed);
+
+    if (session != current)
+    {
+        std::thread::id none;
+        if (!s_producer.compare_exchange_strong(none, std::this_thread::get_id()) &&
+            none != std::this_thread::get_id()) return false;
+        session = current;
+    }
+
+    uint64_t head = s_head.load(std::memory_order_relaxed);
+
+    if (head - s_cachedTail >= kRingSize)
+    {
+        s_cachedTail = s_tail.load(std::memory_order_acquire);
+
+        if (head - s_cachedTail >= kRingSize)
+        {
+            if (s_bDrop)
+            {
+                s_dropped++;
+                return true;
+            }
+
+            s_stalls++;
+
+            unsigned int rounds = 0;
+
+            while (head - s_cachedTail >= kRingSize)
+            {
+                backoff(rounds);
+                s_cachedTail = s_tail.load(std::memory_order_acquire);
+            }
+        }
+    }
+
+    s_ring[head & (kRingSize - 1)] = record;
+    s_head.store(head + 1, std::memory_order_release);
+
+    return true;
+}
+
+/**
+ * Drain the ring and stop the consumer thread.
+ */
+void itrace_stop()
+{
+    if (!g_bITrace) return;
+
+    g_bITrace = false;
+    s_bStop = true;
+    s_consumer.join();
+    s_producer = std::thread::id();
+
+    if (s_writer)
+    {
+        int nStatus = tracefile_finish(s_writer);
+        if (nStatus && s_writeStatus == 0) s_writeStatus = nStatus;
+        s_writer = 0;
+
+        if (s_writeStatus) fprintf(stderr, "Error: trace file write failed: %s\n", strerror(s_writeStatus));
+    }
+
+    fprintf(stderr, "Trace: %llu records, %llu dropped, %llu producer stalls\n",
+        (unsigned long long)s_head.load(), (unsigned long long)s_dropped,
+        (unsigned long long)s_stalls);
+}
@@ -0,0 +1,106 @@
+#ifndef _ITRACE_H_
+#define _ITRACE_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Pipelined instruction trace. The emulation thread pushes a compact
+ *   binary record per instruction into a lock-free single-producer,
+ *   single-consumer ring; a separate thread formats the records and
+ *   writes them to the trace file, or encodes them into a binary trace
+ *   file. When the ring fills the producer either waits for the consumer
+ *   (backpressure) or drops the record, and both events are counted.
+ *
+ *   Only the first thread to push a record feeds the ring. Other threads
+ *   get false back from itrace_push and should trace by other means.
+ *
+ */
+
+#include <stdio.h>
+#include <atomic>
+
+#include "platform.h"
+
+/**
+ * One executed instruction, captured before it runs
+ */
+typedef struct
+{
+    uint64_t cycles;     // Cycles elapsed since reset
+    uint16_t pc;         // Program counter
+    uint8_t opcode;      // Opcode at the program counter
+    uint8_t a;           // Accumulator
+    uint8_t x;           // Index register X
+    uint8_t y;           // Index register Y
+    uint8_t sp;          // Stack pointer
+    uint8_t p;           // Status register
+} ITRACE_RECORD;
+
+//
+// True while the pipelined instruction trace is running. Set by
+// itrace_start/itrace_stop and read by step() on every machine's thread.
+//
+extern std::atomic<bool> g_bITrace;
+
+/**
+ * Start the consumer thread writing formatted records to out.
+ *
+ * @param out stream the trace is written to
+ * @param bDrop true to drop records when the ring is full instead of waiting
+ * @return int 0 on success; otherwise, error number
+ */
+int itrace_start(FILE* out, bool bDrop);
+
+/**
+ * Start the consumer thread writing records to a binary trace file
+ * (see tracefile.h).
+ *
+ * @param filename trace file to create
+ * @param bCompress true to compress trace blocks
+ * @param bDrop true to drop records when the ring is full instead of waiting
+ * @return int 0 on success; otherwise, error number
+ */
+int itrace_start_file(const char* filename, bool bCompress, bool bDrop);
+
+/**
+ * Queue a record for the consumer thread.
+ *
+ * @return bool true if the record was queued or dropped; false if the
+ *         calling thread is not the ring's producer
+ */
+bool itrace_push(const ITRACE_RECORD& record);
+
+/**
+ * Format a record as a text trace line, returning the end of the output.
+ * The output buffer must hold at least 128 characters.
+ */
+char* itrace_format(char* out, const ITRACE_RECORD& record);
+
+/**
+ * Drain the ring, stop the consumer thread and report the record, drop
+ * and stall counts to stderr.
+ */
+void itrace_stop();
+
+#endif
@@ -0,0 +1,437 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of JSON job execution.
+ *
+ */
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "l6502.h"
+#include "job.h"
+#include "json.h"
+#include "util.h"
+
+/**
+ * Memory image right after the last program load on this thread's
+ * machine, restored for jobs that do not load a program.
+ */
+static thread_local uint8_t baseline[k64K];
+static thread_local bool bBaseline = false;
+
+/**
+ * Return true if a JSON number is a whole number in [0, limit), so it
+ * converts to an unsigned integer without loss or overflow.
+ */
+static bool isWhole(double number, double limit)
+{
+    // The range test comes first; the cast is only defined within it
+    return number >= 0 && number < limit && (double)(uint64_t)number == number;
+}
+
+/**
+ * Convert a JSON string (hexadecimal) or number (decimal) to an integer.
+ * Returns false if the value is neither, or is out of range.
+ */
+static bool getNumber(const JsonValue* value, uint32_t* number)
+{
+    if (value == 0) return false;
+
+    if (value->type == kJsonNumber)
+    {
+        if (!isWhole(value->number, 4294967296.0)) return false;
+        *number = (uint32_t)value->number;
+        return true;
+    }
+
+    if (value->type == kJsonString && !value->string.empty())
+    {
+        for (size_t i=0; i < value->string.size(); i++)
+        {
+            if (!isxdigit((unsigned char)value->string[i])) return false;
+        }
+        std::string hex(value->string);
+        *number = getHex(uppercase(&hex[0]));
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Split an "<a>:<b>" string into two hexadecimal values.
+ */
+static bool getPair(const JsonValue& value, uint32_t* first, uint32_t* second)
+{
+    if (value.type != kJsonString) return false;
+
+    std::string pair(value.string);
+    size_t delim = pair.find(':');
+
+    if (delim == std::string::npos || delim == 0 || delim+1 == pair.size()) return false;
+
+    pair[delim] = '\0';
+    *first = getHex(uppercase(&pair[0]));
+    *second = getHex(uppercase(&pair[delim+1]));
+
+    return true;
+}
+
+/**
+ * Value of a single hexadecimal digit or -1.
+ */
+static int hexDigit(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Load a hex encoded image into cleared memory at the origin.
+ */
+static bool loadImage(const std::string& image, uint32_t origin)
+{
+    if (image.size() % 2 || origin + image.size() / 2 > (uint32_t)k64K) return false;
+
+    prepare();
+
+    for (size_t i=0; i < image.size(); i += 2)
+    {
+        int hi = hexDigit(image[i]);
+        int lo = hexDigit(image[i+1]);
+
+        if (hi < 0 || lo < 0) return false;
+
+        poke((uint16_t)(origin + i/2), (uint8_t)(hi*16 + lo));
+    }
+
+    return true;
+}
+
+/**
+ * Apply an array of "<address>:<value>" pokes. Returns false if malformed.
+ */
+static bool applyPokes(const JsonValue* pokes)
+{
+    if (pokes->type != kJsonArray) return false;
+
+    for (size_t i=0; i < pokes->items.size(); i++)
+    {
+        uint32_t addr, value;
+
+        if (!getPair(pokes->items[i], &addr, &value) || addr >= (uint32_t)k64K) return false;
+
+        poke((uint16_t)addr, (uint8_t)value);
+    }
+
+    return true;
+}
+
+/**
+ * Append the named register as a JSON member. Returns false if unknown.
+ */
+static bool appendRegister(std::string& reply, const std::string& name, bool first)
+{
+    char buffer[32];
+    const char* sep = first ? "" : ",";
+
+    if (name == "PC") snprintf(buffer, sizeof buffer, "%s\"PC\":\"%04x\"", sep, pc());
+    else if (name == "SP") snprintf(buffer, sizeof buffer, "%s\"SP\":\"%02x\"", sep, sp());
+    else if (name == "A") snprintf(buffer, sizeof buffer, "%s\"A\":\"%02x\"", sep, a());
+    else if (name == "X") snprintf(buffer, sizeof buffer, "%s\"X\":\"%02x\"", sep, x());
+    else if (name == "Y") snprintf(buffer, sizeof buffer, "%s\"Y\":\"%02x\"", sep, y());
+    else if (name == "P") snprintf(buffer, sizeof buffer, "%s\"P\":\"%02x\"", sep, p());
+    else return false;
+
+    reply += buffer;
+
+    return true;
+}
+
+/**
+ * Format an error reply.
+ */
+static int fail(std::string& reply, const std::string& id, const char* error)
+{
+    reply = "{";
+    if (!id.empty()) reply += "\"id\":" + id + ",";
+    reply += "\"status\":\"error\",\"error\":";
+    json_quote(reply, error);
+    reply += "}";
+    return 1;
+}
+
+/**
+ * Execute one JSON job request and format the JSON reply.
+ */
+int job_execute(const char* request, std::string& reply)
+{
+    assert(request);
+
+    JsonValue job;
+    std::string id;
+    char buffer[128];
+
+    if (!json_parse(request, job) || job.type != kJsonObject)
+    {
+        return fail(reply, id, "malformed request");
+    }
+
+    const JsonValue* value = job.find("id");
+
+    if (value)
+    {
+        if (value->type == kJsonString) json_quote(id, value->string.c_str());
+        else if (value->type == kJsonNumber)
+        {
+            snprintf(buffer, sizeof buffer, "%.17g", value->number);
+            id = buffer;
+        }
+        else return fail(reply, id, "id must be a string or number");
+    }
+
+    uint32_t address = 0x4000;
+    uint32_t origin = 0;
+    uint64_t maxCycles = kDefaultMaxCycles;
+
+    if ((value = job.find("address")) && !getNumber(value, &address)) return fail(reply, id, "bad address");
+    if ((value = job.find("origin")) && !getNumber(value, &origin)) return fail(reply, id, "bad origin");
+    if ((value = job.find("max_cycles")))
+    {
+        if (value->type != kJsonNumber || !isWhole(value->number, 18446744073709551616.0))
+        {
+            return fail(reply, id, "bad max_cycles");
+        }
+        maxCycles = (uint64_t)value->number;
+    }
+
+    if (address >= (uint32_t)k64K || origin >= (uint32_t)k64K) return fail(reply, id, "address out of range");
+
+    const JsonValue* path = job.find("source");
+    const JsonValue* source = job.find("asm");
+    const JsonValue* image = job.find("image");
+
+    if ((path != 0) + (source != 0) + (image != 0) > 1)
+    {
+        return fail(reply, id, "source, asm and image are exclusive");
+    }
+
+    if (path)
+    {
+        if (path->type != kJsonString) return fail(reply, id, "source must be a string");
+        if (assemble(path->string.c_str()) != 0) return fail(reply, id, "assembly failed");
+    }
+    else if (source)
+    {
+        if (source->type != kJsonString) return fail(reply, id, "asm must be a string");
+        if (assembleBuffer(source->string.c_str()) != 0) return fail(reply, id, "assembly failed");
+    }
+    else if (image)
+    {
+        if (image->type != kJsonString || !loadImage(image->string, origin)) return fail(reply, id, "bad image");
+    }
+
+    if (path || source || image)
+    {
+        readBlock(0, baseline, k64K);
+        markClean();
+        bBaseline = true;
+    }
+    else if (bBaseline)
+    {
+        restoreDirty(baseline);
+    }
+
+    if ((value = job.find("pokes")) && !applyPokes(value)) return fail(reply, id, "bad pokes");
+
+    int nStatus = runFor((uint16_t)address, maxCycles);
+
+    if (nStatus < 0) return fail(reply, id, "run failed");
+
+    reply = "{";
+    if (!id.empty()) reply += "\"id\":" + id + ",";
+    reply += (nStatus == 0) ? "\"status\":\"break\"" : "\"status\":\"limit\"";
+
+    snprintf(buffer, sizeof buffer, ",\"cycles\":%llu", (unsigned long long)cycles());
+    reply += buffer;
+
+    reply += ",\"registers\":{";
+    if ((value = job.find("registers")))
+    {
+        if (value->type != kJsonArray) return fail(reply, id, "registers must be an array");
+
+        for (size_t i=0; i < value->items.size(); i++)
+        {
+            if (value->items[i].type != kJsonString ||
+                !appendRegister(reply, value->items[i].string, i == 0))
+            {
+                return fail(reply, id, "unknown register");
+            }
+        }
+    }
+    else
+    {
+        const char* names[] = {"PC", "SP", "A", "X", "Y", "P"};
+        for (size_t i=0; i < sizeof names/sizeof names[0]; i++) appendRegister(reply, names[i], i == 0);
+    }
+    reply += "}";
+
+    bool pass = true;
+
+    if ((value = job.find("asserts")) && value->type == kJsonArray)
+    {
+        reply += ",\"asserts\":[";
+        for (size_t i=0; i < value->items.size(); i++)
+        {
+            uint32_t addr, expected;
+
+            if (!getPair(value->items[i], &addr, &expected) || addr >= (uint32_t)k64K)
+            {
+                return fail(reply, id, "bad assert");
+            }
+
+            bool result = assertmem((uint16_t)addr, (uint8_t)expected);
+            pass = pass && result;
+
+            snprintf(buffer, sizeof buffer,
+                "%s{\"address\":\"%04x\",\"expected\":\"%02x\",\"actual\":\"%02x\",\"pass\":%s}",
+                i ? "," : "", addr, expected & 0xff, inspect((uint16_t)addr), result ? "true" : "false");
+            reply += buffer;
+        }
+        reply += "]";
+    }
+
+    snprintf(buffer, sizeof buffer, ",\"pass\":%s", pass ? "true" : "false");
+    reply += buffer;
+
+    if ((value = job.find("ranges")) && value->type == kJsonArray)
+    {
+        reply += ",\"ranges\":[";
+        for (size_t i=0; i < value->items.size(); i++)
+        {
+            uint32_t first, last;
+
+            if (!getPair(value->items[i], &first, &last) || first > last || last >= (uint32_t)k64K)
+            {
+                return fail(reply, id, "bad range");
+            }
+
+            snprintf(buffer, sizeof buffer, "%s{\"address\":\"%04x\",\"data\":\"", i ? "," : "", first);
+            reply += buffer;
+            for (uint32_t addr=first; addr <= last; addr++)
+            {
+                snprintf(buffer, sizeof buffer, "%02x", inspect((uint16_t)addr));
+                reply += buffer;
+            }
+            reply += "\"}";
+        }
+        reply += "]";
+    }
+
+    reply += "}";
+
+    return pass ? 0 : 1;
+}
+
+/**
+ * Write the whole buffer to the descriptor.
+ */
+static int writeAll(int fd, const std::string& data)
+{
+    size_t written = 0;
+
+    while (written < data.size())
+    {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return errno ? errno : EIO;
+
+        written += n;
+    }
+
+    return 0;
+}
+
+/**
+ * Stream requests from one descriptor and replies to another.
+ */
+int job_stream(int in, int out)
+{
+    std::string pending;
+    std::string replies;
+    std::string reply;
+    char buffer[65536];
+
+    for (;;)
+    {
+        size_t eol;
+
+        while ((eol = pending.find('\n')) != std::string::npos)
+        {
+            pending[eol] = '\0';
+
+            if (pending.find_first_not_of(" \t\r") < eol)
+            {
+                job_execute(pending.c_str(), reply);
+                replies += reply;
+                replies += '\n';
+            }
+
+            pending.erase(0, eol+1);
+        }
+
+        if (!replies.empty())
+        {
+            int err = writeAll(out, replies);
+            if (err) return err;
+            replies.clear();
+        }
+
+        ssize_t n = read(in, buffer, sizeof buffer);
+
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) return errno;
+        if (n == 0) break;
+
+        pending.append(buffer, n);
+    }
+
+    if (pending.find_first_not_of(" \t\r") != std::string::npos)
+    {
+        job_execute(pending.c_str(), reply);
+        reply += '\n';
+        return writeAll(out, reply);
+    }
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef _JOB_H_
+#define _JOB_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Execution of batch jobs described as single line JSON objects. A job
+ *   runs on the calling thread's machine, so concurrent jobs need one
+ *   thread per machine.
+ *
+ *   Request members (all optional):
+ *
+ *     "id"          echoed unchanged in the reply
+ *     "source"      assembly source file to assemble
+ *     "asm"         assembly source text to assemble
+ *     "image"       hex encoded object image, loaded at "origin"
+ *     "origin"      load address of the image (default "0000")
+ *     "address"     address execution begins at (default "4000")
+ *     "max_cycles"  cycle limit (default 100000000)
+ *     "pokes"       array of "<address>:<value>" inputs written before running
+ *     "asserts"     array of "<address>:<value>" memory assertions
+ *     "registers"   array of register names to return (default all)
+ *     "ranges"      array of "<first>:<last>" memory ranges to return
+ *
+ *   A job without source, asm or image reuses the program most recently
+ *   loaded on the same machine: memory is restored to its state right
+ *   after that load, so earlier pokes and stores do not leak between
+ *   jobs and nothing is reassembled.
+ *
+ *   Addresses and values are hexadecimal strings as on the command line,
+ *   or decimal numbers. The reply holds the id, a status of "break",
+ *   "limit" or "error", the cycle count, the final registers, the
+ *   outcome of each assertion and the requested memory as hex strings.
+ *
+ */
+
+#include <string>
+
+#include "platform.h"
+
+/**
+ * Default per-job cycle limit
+ */
+static const uint64_t kDefaultMaxCycles = 100000000;
+
+/**
+ * Execute one JSON job request and format the JSON reply, without a
+ * trailing newline.
+ *
+ * @param request null terminated JSON request line
+ * @param reply receives the JSON reply
+ * @return int 0 if the job ran and all assertions passed; otherwise, nonzero
+ */
+int job_execute(const char* request, std::string& reply);
+
+/**
+ * Read newline terminated requests from one descriptor and write one
+ * newline terminated reply per request to another, in request order,
+ * until end of input. Replies are flushed whenever no further complete
+ * request is waiting, so both pipelined and lock-step clients work.
+ *
+ * @param in descriptor requests are read from
+ * @param out descriptor replies are written to
+ * @return int 0 at end of input; otherwise, error number
+ */
+int job_stream(int in, int out);
+
+#endif
@@ -0,0 +1,278 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the minimal JSON reader.
+ *
+ */
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "json.h"
+
+/**
+ * Maximum nesting depth accepted by the parser
+ */
+static const int kMaxDepth = 32;
+
+static bool parseValue(const char*& p, JsonValue& value, int depth);
+
+/**
+ * Skip whitespace.
+ */
+static void skip(const char*& p)
+{
+    while (*p && isspace((unsigned char)*p)) p++;
+}
+
+/**
+ * Parse a quoted string, leaving p after the closing quote.
+ */
+static bool parseString(const char*& p, std::string& str)
+{
+    if (*p != '"') return false;
+    p++;
+
+    while (*p && *p != '"')
+    {
+        if (*p == '\\')
+        {
+            p++;
+            switch (*p)
+            {
+            case '"':  str += '"';  break;
+            case '\\': str += '\\'; break;
+            case '/':  str += '/';  break;
+            case 'b':  str += '\b'; break;
+            case 'f':  str += '\f'; break;
+            case 'n':  str += '\n'; break;
+            case 'r':  str += '\r'; break;
+            case 't':  str += '\t'; break;
+            case 'u':
+                {
+                    char hex[5];
+                    if (strlen(p+1) < 4) return false;
+                    memcpy(hex, p+1, 4);
+                    hex[4] = '\0';
+                    long code = strtol(hex, 0, 16);
+                    if (code > 0x7f) return false;
+                    str += (char)code;
+                    p += 4;
+                }
+                break;
+            default:
+                return false;
+            }
+            p++;
+        }
+        else
+        {
+            str += *p++;
+        }
+    }
+
+    if (*p != '"') return false;
+    p++;
+
+    return true;
+}
+
+/**
+ * Parse an array, leaving p after the closing bracket.
+ */
+static bool parseArray(const char*& p, JsonValue& value, int depth)
+{
+    value.type = kJsonArray;
+    p++;
+    skip(p);
+
+    if (*p == ']')
+    {
+        p++;
+        return true;
+    }
+
+    for (;;)
+    {
+        value.items.push_back(JsonValue());
+        if (!parseValue(p, value.items.back(), depth+1)) return false;
+        skip(p);
+        if (*p == ',') { p++; continue; }
+        if (*p == ']') { p++; return true; }
+        return false;
+    }
+}
+
+/**
+ * Parse an object, leaving p after the closing brace.
+ */
+static bool parseObject(const char*& p, JsonValue& value, int depth)
+{
+    value.type = kJsonObject;
+    p++;
+    skip(p);
+
+    if (*p == '}')
+    {
+        p++;
+        return true;
+    }
+
+    for (;;)
+    {
+        value.keys.push_back(std::string());
+        if (!parseString(p, value.keys.back())) return false;
+        skip(p);
+        if (*p != ':') return false;
+        p++;
+        value.items.push_back(JsonValue());
+        if (!parseValue(p, value.items.back(), depth+1)) return false;
+        skip(p);
+        if (*p == ',') { p++; skip(p); continue; }
+        if (*p == '}') { p++; return true; }
+        return false;
+    }
+}
+
+/**
+ * Parse any value, leaving p after it.
+ */
+static bool parseValue(const char*& p, JsonValue& value, int depth)
+{
+    if (depth > kMaxDepth) return false;
+
+    skip(p);
+
+    switch (*p)
+    {
+    case '{':
+        return parseObject(p, value, depth);
+    case '[':
+        return parseArray(p, value, depth);
+    case '"':
+        value.type = kJsonString;
+        return parseString(p, value.string);
+    case 't':
+        if (strncmp(p, "true", 4) != 0) return false;
+        value.type = kJsonBool;
+        value.boolean = true;
+        p += 4;
+        return true;
+    case 'f':
+        if (strncmp(p, "false", 5) != 0) return false;
+        value.type = kJsonBool;
+        value.boolean = false;
+        p += 5;
+        return true;
+    case 'n':
+        if (strncmp(p, "null", 4) != 0) return false;
+        value.type = kJsonNull;
+        p += 4;
+        return true;
+    default:
+        {
+            char* end = 0;
+            value.number = strtod(p, &end);
+            if (end == p) return false;
+            value.type = kJsonNumber;
+            p = end;
+            return true;
+        }
+    }
+}
+
+/**
+ * Return the object member with the given name or 0 if absent.
+ */
+const JsonValue* JsonValue::find(const char* key) const
+{
+    assert(key);
+
+    if (type != kJsonObject) return 0;
+
+    for (size_t i=0; i < keys.size(); i++)
+    {
+        if (keys[i] == key) return &items[i];
+    }
+
+    return 0;
+}
+
+/**
+ * Parse a complete JSON document.
+ */
+bool json_parse(const char* text, JsonValue& value)
+{
+    assert(text);
+
+    const char* p = text;
+
+    value = JsonValue();
+
+    if (!parseValue(p, value, 0)) return false;
+
+    skip(p);
+
+    return *p == '\0';
+}
+
+/**
+ * Append str to out as a quoted, escaped JSON string.
+ */
+void json_quote(std::string& out, const char* str)
+{
+    assert(str);
+
+    out += '"';
+
+    for (; *str; str++)
+    {
+        switch (*str)
+        {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n";  break;
+        case '\r': out += "\\r";  break;
+        case '\t': out += "\\t";  break;
+        default:
+            if ((unsigned char)*str < 0x20)
+            {
+                char esc[8];
+                snprintf(esc, sizeof esc, "\\u%04x", (unsigned char)*str);
+                out += esc;
+            }
+            else
+            {
+                out += *str;
+            }
+            break;
+        }
+    }
+
+    out += '"';
+}
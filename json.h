@@ -0,0 +1,87 @@
+#ifndef _JSON_H_
+#define _JSON_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Minimal JSON reader and string escaping used by the job protocol.
+ *   Supports objects, arrays, strings (ASCII \u escapes only), numbers,
+ *   true, false and null.
+ *
+ */
+
+#include <string>
+#include <vector>
+
+#include "platform.h"
+
+/**
+ * JSON value types
+ */
+typedef enum
+{
+    kJsonNull,
+    kJsonBool,
+    kJsonNumber,
+    kJsonString,
+    kJsonArray,
+    kJsonObject
+} JSON_TYPE;
+
+/**
+ * Parsed JSON value. Object members are kept as parallel key and value
+ * vectors in document order.
+ */
+struct JsonValue
+{
+    JSON_TYPE type;
+    bool boolean;
+    double number;
+    std::string string;
+    std::vector<JsonValue> items;    // Array elements or object member values
+    std::vector<std::string> keys;   // Object member names
+
+    JsonValue() : type(kJsonNull), boolean(false), number(0.0) {}
+
+    /**
+     * Return the object member with the given name or 0 if absent.
+     */
+    const JsonValue* find(const char* key) const;
+};
+
+/**
+ * Parse a complete JSON document.
+ *
+ * @param text null terminated JSON text
+ * @param value receives the parsed value
+ * @return bool true on success; false if the text is malformed
+ */
+bool json_parse(const char* text, JsonValue& value);
+
+/**
+ * Append str to out as a quoted, escaped JSON string.
+ */
+void json_quote(std::string& out, const char* str);
+
+#endif
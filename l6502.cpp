@@ -25,15 +25,23 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>  
 #include <ctype.h>
 #include <string>
 #include <map>
+#include <atomic>
 
 #include "l6502.h"
 #include "ftrace.h"
+#include "itrace.h"
+#include "profile.h"
+#include "callgraph.h"
+#include "chrometrace.h"
+#include "heatmap.h"
+#include "coverage.h"
 #include "ticker.h"
 #include "util.h"
 
@@ -43,10 +51,12 @@
 const char* kVersion = "6502 Emulator v0.3.1";
 
 /**
- * Consts for program stack size, label and branch tables, 
+ * Consts for program stack page, label and branch tables, 
  * and instruction set mapping table.
  */
-static const int kStackSize         = 256;
+static const int kStackPage         = 0x100;
+static const int kPageSize          = 0x100;
+static const int kPageCount         = k64K / kPageSize;
 static const int kInstrSetTableSize = 256;
 
 /**
@@ -81,26 +91,23 @@ static const uint8_t kSIGNBIT      = 7;
  * Macro to define an instruction's symbolic value, string, and 
  * function prototype
  */
-#define INSTRUCTION(inst,opcode,size,cycles,desc) const char* s##inst = #inst; \
-    const uint8_t inst = opcode; \
-    const uint8_t inst##SZ = size; \
-    const uint8_t inst##CYC = cycles; \
-    const char* inst##DSC = desc; \
+#define INSTRUCTION(inst,opcode,size,cycles,desc) constexpr const char* s##inst = #inst; \
+    constexpr uint8_t inst = opcode; \
+    constexpr uint8_t inst##SZ = size; \
+    constexpr uint8_t inst##CYC = cycles; \
+    constexpr const char* inst##DSC = desc; \
     void i##inst(void)
 
 /*
- * Convenience macro that initializes the instruction table to
- * predictable values.
+ * Convenience macro that initializes the instruction table under
+ * construction to predictable values.
  */
 #define MAP_INITIALIZE \
 {\
     for (unsigned int ii=0; ii < kInstrSetTableSize; ii++) \
     { \
-        i6502[ii].symbol="\0"; \
-        i6502[ii].desc="\0"; \
-        i6502[ii].bytes=0; \
-        i6502[ii].cycles=0; \
-        i6502[ii].pFunc=0; \
+        table.exec[ii] = INST_EXEC{0, 0, 0}; \
+        table.info[ii] = INST_INFO{"\0", "\0"}; \
     } \
 }
 
@@ -108,11 +115,16 @@ static const uint8_t kSIGNBIT      = 7;
  * Macro to fix up the instruction entry in the instruction table
  */
 #define MAP_INSTRUCTION(inst) \
-    i6502[inst].pFunc=&i##inst; \
-    i6502[inst].bytes=inst##SZ; \
-    i6502[inst].cycles=inst##CYC; \
-    i6502[inst].symbol=s##inst; \
-    i6502[inst].desc=inst##DSC;
+    table.exec[inst] = INST_EXEC{&i##inst, inst##SZ, inst##CYC}; \
+    table.info[inst] = INST_INFO{s##inst, inst##DSC};
+
+/**
+ * Exec category trace statement for instruction handlers. While the
+ * pipelined instruction trace is running it already records every
+ * instruction, so handler detail is only printed when it is not.
+ */
+#define ETRACE(str,...) \
+    do { if (!g_bITrace.load(std::memory_order_relaxed)) FTRACE_AT(kTraceExec,kTraceVerbose,str,__VA_ARGS__); } while (0)
 
 /**
  * Macros to set the various 6502 status bits
@@ -126,16 +138,34 @@ static const uint8_t kSIGNBIT      = 7;
 #define SET_INTERRUPT(val) (INTERRUPTBIT = val, P = (P&~(1<<kINTERRUPTBIT)) | (INTERRUPTBIT<<kINTERRUPTBIT))
 
 /**
- * Instruction descriptor
+ * Instruction fields read by every step
  */
 typedef struct
 {
-    const char* symbol;  // Symbolic string for the instruction
-    uint8_t bytes; // Instruction length - reserved for future use
+    void (*pFunc)(void); // Function pointer for the instructions implementation
+    uint8_t bytes; // Instruction length
     uint8_t cycles; // Number of CPU cycles for this instruction
+} INST_EXEC;
+
+/**
+ * Instruction fields used by the assembler, disassembler and tools
+ */
+typedef struct
+{
+    const char* symbol;  // Symbolic string for the instruction
     const char* desc; // Instruction description
-    void (*pFunc)(void); // Function pointer for the instructions implementation
-} INST_DESCRIPTOR;
+} INST_INFO;
+
+/**
+ * Instruction set table (indexed by opcode), built at compile time. The
+ * execution fields are kept apart from the strings so the array step()
+ * reads stays dense.
+ */
+typedef struct
+{
+    INST_EXEC exec[kInstrSetTableSize];
+    INST_INFO info[kInstrSetTableSize];
+} INST_TABLE;
 
 /**
  * Association for symbols to addresses used by assembler.
@@ -152,60 +182,126 @@ typedef std::map<uint16_t, std::string> AddressSymbolMap;
  */
 typedef std::map<uint16_t, bool> BreakpointMap;
 
+/**
+ * Association for instruction addresses to source lines used by assembler.
+ */
+typedef std::map<uint16_t, unsigned int> AddressLineMap;
+
 /**
  * Initialization status
  */
 static bool bInitialized = false;
 
+//
+// Machine, assembler and debugger state below is kept per host thread so
+// that independent machines can run concurrently (see multicpu.h). The
+// instruction table is a shared compile time constant.
+//
+
+/**
+ * Registers, status "bits", cycle counter and memory, kept in a single
+ * block laid out as MACHINE_STATE so a snapshot is one copy
+ */
+static thread_local MACHINE_STATE MACHINE;
+
 /**
- * 6502 status "bits"
+ * Size of the registers, flags and cycle counter at the start of the block
  */
-static uint8_t CARRYBIT;
-static uint8_t ZEROBIT;
-static uint8_t INTERRUPTBIT;
-static uint8_t DECIMALBIT;
-static uint8_t BREAKBIT;
-static uint8_t OVERFLOWBIT;
-static uint8_t SIGNBIT;
+static const size_t kRegistersSize = offsetof(MACHINE_STATE, memory);
 
-static uint8_t* BP; /// Base address, not part of 6502
+#define CARRYBIT     MACHINE.flags[0]
+#define ZEROBIT      MACHINE.flags[1]
+#define INTERRUPTBIT MACHINE.flags[2]
+#define DECIMALBIT   MACHINE.flags[3]
+#define BREAKBIT     MACHINE.flags[4]
+#define OVERFLOWBIT  MACHINE.flags[5]
+#define SIGNBIT      MACHINE.flags[6]
 
-static uint8_t  A;  /// Accumulator
-static uint8_t  X;  /// Index register X
-static uint8_t  Y;  /// Index register Y
-static uint16_t PC; /// Program counter
-static uint8_t  SP; /// Stack pointer
-static uint8_t  P;  /// Status register
+#define A            MACHINE.a       /// Accumulator
+#define X            MACHINE.x       /// Index register X
+#define Y            MACHINE.y       /// Index register Y
+#define PC           MACHINE.pc      /// Program counter
+#define SP           MACHINE.sp      /// Stack pointer
+#define P            MACHINE.p       /// Status register
 
 /**
- * Program stack
+ * Elapsed CPU cycles since the last reset, not part of 6502
  */
-static uint8_t STACK[kStackSize]; 
+#define CYCLES       MACHINE.cycles
+
+//
+// 64k RAM for execution environment
+//
+#define memory       MACHINE.memory
+
+/**
+ * Program stack, page $01 of memory. The offset wraps within the page.
+ */
+#define STACK(offset) memory[kStackPage + (uint8_t)(offset)]
+
+/**
+ * Pages written since memory last matched a saved or restored state, one
+ * bit per 256 byte page, not part of 6502
+ */
+static thread_local uint64_t DIRTY[kPageCount / 64];
+
+#define MARK_DIRTY(address) (DIRTY[(uint16_t)(address) >> 14] |= 1ULL << (((uint16_t)(address) >> 8) & 63))
+#define MARK_ALL_DIRTY()    memset(DIRTY, 0xFF, sizeof DIRTY)
+#define IS_DIRTY(page)      ((DIRTY[(page) >> 6] >> ((page) & 63)) & 1)
+
+static thread_local uint8_t* BP; /// Base address, not part of 6502
+
+/**
+ * Executions of each opcode since the last reset, not part of 6502
+ */
+static thread_local uint64_t OPCOUNTS[kInstrSetTableSize];
+
+/**
+ * Work done by the thread's machine before the last reset or state load,
+ * and the cycle counter as it was left there, not part of 6502. Folded
+ * into the process totals when the thread exits.
+ */
+typedef struct RETIRED_COUNTS
+{
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t base;
+
+    ~RETIRED_COUNTS();
+} RETIRED_COUNTS;
+
+static thread_local RETIRED_COUNTS RETIRED;
+
+/**
+ * Work done by machines whose threads have exited
+ */
+static std::atomic<uint64_t> s_exitedCycles(0);
+static std::atomic<uint64_t> s_exitedInstructions(0);
 
 /**
  * Program labels used by the assembler
  */
-static SymbolAddressMap labels;
+static thread_local SymbolAddressMap labels;
 
 /**
  * Branches to labels used by the assembler
  */
-static AddressSymbolMap branches;
+static thread_local AddressSymbolMap branches;
 
-//
-// 6502 instruction set table (indexed by opcode)
-//
-static INST_DESCRIPTOR i6502[kInstrSetTableSize];
+/**
+ * Source line of each assembled instruction
+ */
+static thread_local AddressLineMap lines;
 
-//
-// 64k RAM for execution environment
-//
-static uint8_t memory[k64K];
+/**
+ * Name of the last assembled source file, empty for a buffer
+ */
+static thread_local std::string sourceName;
 
 /**
  * Breakpoints for debugging
  */
-static BreakpointMap breakpoints;
+static thread_local BreakpointMap breakpoints;
 
 /**
  * Debugger actions.
@@ -321,7 +417,7 @@ unsigned char getImmediateValue()
 INSTRUCTION(ADCI, 0x69, 2, 2, "Add with carry immediate")
 {
     uint8_t value = getImmediateValue();
-    FTRACE("%s %02x", __FILE__, __LINE__, sADCI, (uint8_t)value);
+    ETRACE("%s %02x", __FILE__, __LINE__, sADCI, (uint8_t)value);
     uint8_t old_a = A;
     uint16_t a = (uint16_t)A + value + CARRYBIT;                 
     SET_CARRY((a > 0xff));
@@ -339,7 +435,7 @@ INSTRUCTION(ADCI, 0x69, 2, 2, "Add with carry immediate")
 INSTRUCTION(ADCZ, 0x65, 2, 3, "Add with carry from zero page address")
 {
     uint8_t value = getImmediateValue();
-    FTRACE("%s %02x", __FILE__, __LINE__, sADCZ, (uint8_t)value);
+    ETRACE("%s %02x", __FILE__, __LINE__, sADCZ, (uint8_t)value);
     uint8_t old_a = A;
     uint8_t mem_value = *(BP+value);
     uint16_t a = (uint16_t)A + mem_value + CARRYBIT;                 
@@ -357,7 +453,7 @@ INSTRUCTION(ADCZ, 0x65, 2, 3, "Add with carry from zero page address")
 INSTRUCTION(ADCA, 0x6D, 3, 4, "Add with carry from absolute address")
 {
     uint16_t pc = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sADCA, (uint16_t)pc);
+    ETRACE("%s %04x", __FILE__, __LINE__, sADCA, (uint16_t)pc);
     uint8_t old_a = A;
     uint8_t mem_value = *(BP + pc);
     uint16_t a = (uint16_t)A + mem_value + CARRYBIT;                 
@@ -375,7 +471,7 @@ INSTRUCTION(ADCA, 0x6D, 3, 4, "Add with carry from absolute address")
 INSTRUCTION(ADCZX, 0x61, 2, 6, "Add with carry from zero page indexed")
 {
     uint8_t value = getImmediateValue();
-    FTRACE("%s %02x", __FILE__, __LINE__, sADCZX, (uint16_t)value);
+    ETRACE("%s %02x", __FILE__, __LINE__, sADCZX, (uint16_t)value);
     uint8_t zx = value + X;
     uint8_t old_a = A;
     uint8_t mem_value = *(BP + zx);
@@ -394,7 +490,7 @@ INSTRUCTION(ADCZX, 0x61, 2, 6, "Add with carry from zero page indexed")
 INSTRUCTION(ADCIX, 0x75, 2, 4, "Add with carry from indirect, X")
 {
     uint8_t value = getImmediateValue();
-    FTRACE("%s %02x", __FILE__, __LINE__, sADCIX, (uint8_t)value);
+    ETRACE("%s %02x", __FILE__, __LINE__, sADCIX, (uint8_t)value);
     uint8_t zx = value + X;
     uint8_t old_a = A;
     uint8_t mem_value = *(BP + (*(BP + zx + 1)<<8) + *(BP + zx));
@@ -413,7 +509,7 @@ INSTRUCTION(ADCIX, 0x75, 2, 4, "Add with carry from indirect, X")
 INSTRUCTION(ADCIY, 0x71, 2, 5, "Add with carry from indirect, Y")
 {
     uint8_t zi = *(BP+PC+1);
-    FTRACE("%s %02x", __FILE__, __LINE__, sADCIY, (uint8_t)zi);
+    ETRACE("%s %02x", __FILE__, __LINE__, sADCIY, (uint8_t)zi);
     uint8_t old_a = A;
     uint8_t mem_value = *(BP + (*(BP+zi+1)<<8) + *(BP+zi) + Y);
     uint16_t a = (uint16_t)A + mem_value + CARRYBIT;                 
@@ -431,7 +527,7 @@ INSTRUCTION(ADCIY, 0x71, 2, 5, "Add with carry from indirect, Y")
 INSTRUCTION(ADCX, 0x7D, 3, 4, "Add with carry from absolute, X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sADCX, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sADCX, (uint16_t)addr16);
     uint8_t old_a = A;
     uint8_t mem_value = *(BP + addr16 + X);
     uint16_t a = (uint16_t)A + mem_value + CARRYBIT;
@@ -449,7 +545,7 @@ INSTRUCTION(ADCX, 0x7D, 3, 4, "Add with carry from absolute, X")
 INSTRUCTION(ADCY, 0x79, 3, 4, "Add with carry from absolute, Y")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sADCY, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sADCY, (uint16_t)addr16);
     uint8_t old_a = A;
     uint8_t mem_value = *(BP + addr16 + Y);
     uint16_t a = (uint16_t)A + mem_value + CARRYBIT;
@@ -467,7 +563,7 @@ INSTRUCTION(ADCY, 0x79, 3, 4, "Add with carry from absolute, Y")
 INSTRUCTION(ANDI, 0x29, 2, 2, "AND with immediate value")
 {
     uint8_t value = getImmediateValue();
-    FTRACE("%s %02x", __FILE__, __LINE__, sANDI, (uint8_t)value);
+    ETRACE("%s %02x", __FILE__, __LINE__, sANDI, (uint8_t)value);
     A &= value;
     SET_ZERO(A);
     SET_SIGN(A);
@@ -479,7 +575,7 @@ INSTRUCTION(ANDI, 0x29, 2, 2, "AND with immediate value")
  */
 INSTRUCTION(ANDZ, 0x25, 2, 3, "AND from zero page memory address")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sANDZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sANDZ, (uint8_t)*(BP+PC+1));
     A &= *(BP+*(BP+PC+1));
     SET_ZERO(A);
     SET_SIGN(A);
@@ -492,7 +588,7 @@ INSTRUCTION(ANDZ, 0x25, 2, 3, "AND from zero page memory address")
 INSTRUCTION(ANDA, 0x2D, 3, 4, "AND from absolute memory address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sANDA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sANDA, (uint16_t)addr16);
     A &= *(BP + addr16);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -505,7 +601,7 @@ INSTRUCTION(ANDA, 0x2D, 3, 4, "AND from absolute memory address")
  */
 INSTRUCTION(ANDZX, 0x21, 2, 6, "AND from zero page, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sANDZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sANDZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X;
     A &= *(BP + zx);
     SET_ZERO(A);
@@ -520,7 +616,7 @@ INSTRUCTION(ANDZX, 0x21, 2, 6, "AND from zero page, X")
 INSTRUCTION(ANDX, 0x3D, 3, 4, "AND from absolute address, X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sANDX, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sANDX, (uint16_t)addr16);
     A &= *(BP + addr16 + X);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -534,7 +630,7 @@ INSTRUCTION(ANDX, 0x3D, 3, 4, "AND from absolute address, X")
 INSTRUCTION(ANDY, 0x39, 3, 4, "AND from absolute address, Y")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sANDY, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sANDY, (uint16_t)addr16);
     A &= *(BP + addr16 + Y);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -547,7 +643,7 @@ INSTRUCTION(ANDY, 0x39, 3, 4, "AND from absolute address, Y")
  */
 INSTRUCTION(ANDIX, 0x35, 2, 4, "AND from indirect address, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sANDIX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sANDIX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X; // zero page wrap around
     A &= *(BP + (*(BP + zx + 1)<<8) + *(BP + zx));
     SET_ZERO(A);
@@ -562,7 +658,7 @@ INSTRUCTION(ANDIX, 0x35, 2, 4, "AND from indirect address, X")
 INSTRUCTION(ANDIY, 0x31, 2, 5, "AND from indirect address, Y")
 {
     uint8_t zi = *(BP+PC+1);
-    FTRACE("%s %02x", __FILE__, __LINE__, sANDIY, (uint8_t)zi);
+    ETRACE("%s %02x", __FILE__, __LINE__, sANDIY, (uint8_t)zi);
     A &= *(BP + (*(BP+zi+1)<<8) + *(BP+zi) + Y);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -574,7 +670,7 @@ INSTRUCTION(ANDIY, 0x31, 2, 5, "AND from indirect address, Y")
  */
 INSTRUCTION(ASL, 0x0A, 1, 2, "Arithmetic shift left")
 {
-    FTRACE("%s", __FILE__, __LINE__, sASL);
+    ETRACE("%s", __FILE__, __LINE__, sASL);
     SET_CARRY(((A&0x80)==0x80));
     A = A<<1;
     SET_ZERO(A);
@@ -587,8 +683,9 @@ INSTRUCTION(ASL, 0x0A, 1, 2, "Arithmetic shift left")
  */
 INSTRUCTION(ASLZ, 0x06, 2, 5, "Arithmetic shift left zero page address")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sASLZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sASLZ, (uint8_t)*(BP+PC+1));
     uint8_t* addr = BP + *(BP+PC+1);
+    MARK_DIRTY(addr - BP);
     SET_CARRY(((*addr&0x80)==0x80));
     *addr = *addr<<1;
     SET_ZERO(*addr);
@@ -602,8 +699,9 @@ INSTRUCTION(ASLZ, 0x06, 2, 5, "Arithmetic shift left zero page address")
 INSTRUCTION(ASLA, 0x0E, 3, 6, "Arithmetic shift left absolute address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sASLA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sASLA, (uint16_t)addr16);
     uint8_t* addr = BP + addr16;
+    MARK_DIRTY(addr - BP);
     SET_CARRY(((*addr&0x80)==0x80));
     *addr = *addr<<1;
     SET_ZERO(*addr);
@@ -617,9 +715,10 @@ INSTRUCTION(ASLA, 0x0E, 3, 6, "Arithmetic shift left absolute address")
  */
 INSTRUCTION(ASLZX, 0x16, 2, 6, "Arithmetic shift left zero page address, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sASLZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sASLZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X;
     uint8_t* addr = BP + zx;
+    MARK_DIRTY(addr - BP);
     SET_CARRY(((*addr&0x80)==0x80));
     *addr = *addr<<1;
     SET_ZERO(*addr);
@@ -634,8 +733,10 @@ INSTRUCTION(ASLZX, 0x16, 2, 6, "Arithmetic shift left zero page address, X")
 INSTRUCTION(ASLX, 0x1E, 3, 7, "Arithmetic shift left absolute address, X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sASLX, (uint16_t)addr16);
-    uint8_t* addr = BP + addr16 + X;
+    ETRACE("%s %04x", __FILE__, __LINE__, sASLX, (uint16_t)addr16);
+    uint16_t ax = addr16 + X; // 64K wrap
+    uint8_t* addr = BP + ax;
+    MARK_DIRTY(ax);
     SET_CARRY(((*addr&0x80)==0x80));
     *addr = *addr<<1;
     SET_ZERO(*addr);
@@ -649,7 +750,7 @@ INSTRUCTION(ASLX, 0x1E, 3, 7, "Arithmetic shift left absolute address, X")
 INSTRUCTION(BITZ, 0x24, 2, 3, "Test accumulator with zero page address")
 {
     uint8_t zi = *(BP+PC+1);
-    FTRACE("%s %02x", __FILE__, __LINE__, sBITZ, (uint8_t)zi);
+    ETRACE("%s %02x", __FILE__, __LINE__, sBITZ, (uint8_t)zi);
     SET_ZERO((A&*(BP+zi)));                 
     SET_SIGN((A&*(BP+zi)));
     SET_OVERFLOW(*(BP+zi));
@@ -662,7 +763,7 @@ INSTRUCTION(BITZ, 0x24, 2, 3, "Test accumulator with zero page address")
 INSTRUCTION(BIT, 0x2C, 3, 4, "Test accumulator with absolute address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sBIT, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sBIT, (uint16_t)addr16);
     SET_ZERO((A&*(BP + addr16)));
     SET_SIGN((A&*(BP + addr16)));
     SET_OVERFLOW(*(BP + addr16));
@@ -674,7 +775,7 @@ INSTRUCTION(BIT, 0x2C, 3, 4, "Test accumulator with absolute address")
  */
 INSTRUCTION(BCC, 0x90, 2, 2, "Branch to relative address on carry clear")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sBCC, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sBCC, (uint8_t)*(BP+PC+1));
     if (CARRYBIT == 0)
     {
         PC = getRelativeAddress();
@@ -690,7 +791,7 @@ INSTRUCTION(BCC, 0x90, 2, 2, "Branch to relative address on carry clear")
  */
 INSTRUCTION(BCS, 0xB0, 2, 2, "Branch to relative address on carry set")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sBCS, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sBCS, (uint8_t)*(BP+PC+1));
     if (CARRYBIT == 1)
     {
         PC = getRelativeAddress();
@@ -706,7 +807,7 @@ INSTRUCTION(BCS, 0xB0, 2, 2, "Branch to relative address on carry set")
 //
 INSTRUCTION(BVC, 0x50, 2, 2, "Branch to relative address on overflow clear")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sBVC, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sBVC, (uint8_t)*(BP+PC+1));
     if (OVERFLOWBIT == 0)
     {
         PC = getRelativeAddress();
@@ -722,7 +823,7 @@ INSTRUCTION(BVC, 0x50, 2, 2, "Branch to relative address on overflow clear")
  */
 INSTRUCTION(BVS, 0x70, 2, 2, "Branch to relative address on overflow set")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sBVS, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sBVS, (uint8_t)*(BP+PC+1));
     if (OVERFLOWBIT == 1)
     {
         PC = getRelativeAddress();
@@ -738,7 +839,7 @@ INSTRUCTION(BVS, 0x70, 2, 2, "Branch to relative address on overflow set")
  */
 INSTRUCTION(BEQ, 0xF0, 2, 2, "Branch to relative address on zero bit set")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sBEQ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sBEQ, (uint8_t)*(BP+PC+1));
     if (ZEROBIT == 1)
     {
         PC = getRelativeAddress();
@@ -754,7 +855,7 @@ INSTRUCTION(BEQ, 0xF0, 2, 2, "Branch to relative address on zero bit set")
  */
 INSTRUCTION(BNE, 0xD0, 2, 2, "Branch to relative address on zero bit clear")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sBNE, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sBNE, (uint8_t)*(BP+PC+1));
     if (ZEROBIT == 0)
     {
         PC = getRelativeAddress();
@@ -770,7 +871,7 @@ INSTRUCTION(BNE, 0xD0, 2, 2, "Branch to relative address on zero bit clear")
  */
 INSTRUCTION(BPL, 0x10, 2, 2, "Branch to relative address on sign bit clear")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sBPL, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sBPL, (uint8_t)*(BP+PC+1));
     if (SIGNBIT == 0)
     {
         PC = getRelativeAddress();
@@ -786,7 +887,7 @@ INSTRUCTION(BPL, 0x10, 2, 2, "Branch to relative address on sign bit clear")
  */
 INSTRUCTION(BMI, 0x30, 2, 2, "Branch to relative address on sign bit set")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sBMI, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sBMI, (uint8_t)*(BP+PC+1));
     if (SIGNBIT == 1)
     {
         PC = getRelativeAddress();
@@ -802,7 +903,7 @@ INSTRUCTION(BMI, 0x30, 2, 2, "Branch to relative address on sign bit set")
  */
 INSTRUCTION(BRK, 0x00, 1, 7, "Set break")
 {
-    FTRACE("%s", __FILE__, __LINE__, sBRK);
+    ETRACE("%s", __FILE__, __LINE__, sBRK);
     SET_BREAK(1);
     // @todo correct the implementation of this instruction, 
     // see http://nesdev.parodius.com/the%20'B'%20flag%20&%20BRK%20instruction.txt
@@ -813,7 +914,7 @@ INSTRUCTION(BRK, 0x00, 1, 7, "Set break")
  */
 INSTRUCTION(CLC, 0x18, 1, 2, "Clear carry bit")
 {
-    FTRACE("%s", __FILE__, __LINE__, sCLC);
+    ETRACE("%s", __FILE__, __LINE__, sCLC);
     SET_CARRY(0);
     PC++;
 }
@@ -823,7 +924,7 @@ INSTRUCTION(CLC, 0x18, 1, 2, "Clear carry bit")
  */
 INSTRUCTION(CLD, 0xD8, 1, 2, "Clear decimal bit")
 {
-    FTRACE("%s", __FILE__, __LINE__, sCLD);
+    ETRACE("%s", __FILE__, __LINE__, sCLD);
     SET_DECIMAL(0);
     PC++;
 }
@@ -833,7 +934,7 @@ INSTRUCTION(CLD, 0xD8, 1, 2, "Clear decimal bit")
  */
 INSTRUCTION(CLI, 0x58, 1, 2, "Clear interrupt bit")
 {
-    FTRACE("%s", __FILE__, __LINE__, sCLI);
+    ETRACE("%s", __FILE__, __LINE__, sCLI);
     SET_INTERRUPT(0);
     PC++;
 }
@@ -843,7 +944,7 @@ INSTRUCTION(CLI, 0x58, 1, 2, "Clear interrupt bit")
  */
 INSTRUCTION(CLV, 0xB8, 1, 2, "Clear overflow bit")
 {
-    FTRACE("%s", __FILE__, __LINE__, sCLV);
+    ETRACE("%s", __FILE__, __LINE__, sCLV);
     SET_OVERFLOW(0);
     PC++;
 }
@@ -853,7 +954,7 @@ INSTRUCTION(CLV, 0xB8, 1, 2, "Clear overflow bit")
  */
 INSTRUCTION(CMPI, 0xC9, 2, 2, "Compare immediate value")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sCMPI, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sCMPI, (uint8_t)*(BP+PC+1));
     uint8_t m = *(BP+PC+1);
     uint8_t a = A - m;
     SET_CARRY(A >= m);
@@ -867,7 +968,7 @@ INSTRUCTION(CMPI, 0xC9, 2, 2, "Compare immediate value")
  */
 INSTRUCTION(CMPZ, 0xC5, 2, 3, "Compare zero page memory")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sCMPZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sCMPZ, (uint8_t)*(BP+PC+1));
     uint8_t m = *(BP+*(BP+PC+1));
     uint8_t a = A - m;
     SET_CARRY(A >= m);
@@ -882,7 +983,7 @@ INSTRUCTION(CMPZ, 0xC5, 2, 3, "Compare zero page memory")
 INSTRUCTION(CMPA, 0xCD, 3, 4, "Compare memory using absolute address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sCMPA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sCMPA, (uint16_t)addr16);
     uint8_t m = *(BP + addr16);
     uint8_t a = A - m;
     SET_CARRY(A >= m);
@@ -896,7 +997,7 @@ INSTRUCTION(CMPA, 0xCD, 3, 4, "Compare memory using absolute address")
  */
 INSTRUCTION(CMPZX, 0xD5, 2, 6, "Compare memory using zero page, X addressing mode")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sCMPZX,*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sCMPZX,*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X;
     uint8_t m = *(BP + zx);
     uint8_t a = A - m;
@@ -912,7 +1013,7 @@ INSTRUCTION(CMPZX, 0xD5, 2, 6, "Compare memory using zero page, X addressing mod
 INSTRUCTION(CMPX, 0xDD, 3, 4, "Compare memory using absolute, X addressing mode")
 {
     uint16_t addr16 = getAbsoluteAddress();	
-    FTRACE("%s %04x", __FILE__, __LINE__, sCMPX, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sCMPX, (uint16_t)addr16);
     uint8_t m = *(BP + addr16 + X);
     uint8_t a = A - m;
     SET_CARRY(A >= m);
@@ -927,7 +1028,7 @@ INSTRUCTION(CMPX, 0xDD, 3, 4, "Compare memory using absolute, X addressing mode"
 INSTRUCTION(CMPY, 0xD9, 3, 4, "Compare memory using absolute, Y addressing mode")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sCMPY, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sCMPY, (uint16_t)addr16);
     uint8_t m = *(BP + addr16 + Y);
     uint8_t a = A - m;
     SET_CARRY(A >= m);
@@ -942,7 +1043,7 @@ INSTRUCTION(CMPY, 0xD9, 3, 4, "Compare memory using absolute, Y addressing mode"
  */
 INSTRUCTION(CMPIX, 0xC1, 2, 4, "Compare memory using indexed indirect addressing mode")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sCMPIX,*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sCMPIX,*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X;
     uint8_t m = *(BP + (*(BP + zx + 1)<<8) + *(BP + zx));
     uint8_t a = A - m;
@@ -958,7 +1059,7 @@ INSTRUCTION(CMPIX, 0xC1, 2, 4, "Compare memory using indexed indirect addressing
  */
 INSTRUCTION(CMPIY, 0xD1, 2, 5, "Compare memory using indirect indexed addressing mode")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sCMPIY, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sCMPIY, (uint8_t)*(BP+PC+1));
     uint8_t zi = *(BP+PC+1);
     uint8_t m = *(BP + (*(BP+zi+1)<<8) + *(BP+zi) + Y);
     uint8_t a = A - m;
@@ -973,7 +1074,7 @@ INSTRUCTION(CMPIY, 0xD1, 2, 5, "Compare memory using indirect indexed addressing
  */
 INSTRUCTION(CPXI, 0xE0, 2, 2, "Compare X with immediate value")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sCPXI, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sCPXI, (uint8_t)*(BP+PC+1));
     uint8_t x = X - *(BP+PC+1);
     SET_CARRY(((x&0x80)==0x80));
     SET_ZERO(x);
@@ -986,7 +1087,7 @@ INSTRUCTION(CPXI, 0xE0, 2, 2, "Compare X with immediate value")
  */
 INSTRUCTION(CPXZ, 0xE4, 2, 3, "Compare X with zero page value")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sCPXZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sCPXZ, (uint8_t)*(BP+PC+1));
     uint8_t x = X - *(BP+*(BP+PC+1));
     SET_CARRY(((x&0x80)==0x80));
     SET_ZERO(x);
@@ -1000,7 +1101,7 @@ INSTRUCTION(CPXZ, 0xE4, 2, 3, "Compare X with zero page value")
 INSTRUCTION(CPXA, 0xEC, 3, 4, "Compare X with absolute address memory")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sCPXA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sCPXA, (uint16_t)addr16);
     uint8_t x = X - *(BP + addr16);
     SET_CARRY(((x&0x80)==0x80));
     SET_ZERO(x);
@@ -1013,7 +1114,7 @@ INSTRUCTION(CPXA, 0xEC, 3, 4, "Compare X with absolute address memory")
  */
 INSTRUCTION(CPYI, 0xC0, 2, 2, "Compare Y with immediate value")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sCPYI, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sCPYI, (uint8_t)*(BP+PC+1));
     uint8_t y = Y - *(BP+PC+1);
     SET_CARRY(((y&0x80)==0x80));
     SET_ZERO(y);
@@ -1026,7 +1127,7 @@ INSTRUCTION(CPYI, 0xC0, 2, 2, "Compare Y with immediate value")
  */
 INSTRUCTION(CPYZ, 0xC4, 2, 3, "Compare Y with zero page memory")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sCPYZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sCPYZ, (uint8_t)*(BP+PC+1));
     uint8_t y = Y - *(BP+*(BP+PC+1));
     SET_CARRY(((y&0x80)==0x80));
     SET_ZERO(y);
@@ -1040,7 +1141,7 @@ INSTRUCTION(CPYZ, 0xC4, 2, 3, "Compare Y with zero page memory")
 INSTRUCTION(CPYA, 0xCC, 3, 4, "Compare Y with absolute address memory")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sCPYA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sCPYA, (uint16_t)addr16);
     uint8_t y = Y - *(BP + addr16);
     SET_CARRY(((y&0x80)==0x80));
     SET_ZERO(y);
@@ -1053,8 +1154,9 @@ INSTRUCTION(CPYA, 0xCC, 3, 4, "Compare Y with absolute address memory")
  */
 INSTRUCTION(DECZ, 0xC6, 2, 5, "Decrement zero page memory address")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sDECZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sDECZ, (uint8_t)*(BP+PC+1));
     uint8_t* addr = BP + *(BP+PC+1);
+    MARK_DIRTY(addr - BP);
     *(addr) -= 1;
     SET_ZERO(*addr);
     SET_SIGN(*addr);
@@ -1067,8 +1169,9 @@ INSTRUCTION(DECZ, 0xC6, 2, 5, "Decrement zero page memory address")
 INSTRUCTION(DECA, 0xCE, 3, 6, "Decrement memory value at absolute address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sDECA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sDECA, (uint16_t)addr16);
     uint8_t* addr = BP + addr16;
+    MARK_DIRTY(addr - BP);
     *(addr) -= 1;
     SET_ZERO(*addr);
     SET_SIGN(*addr);
@@ -1081,9 +1184,10 @@ INSTRUCTION(DECA, 0xCE, 3, 6, "Decrement memory value at absolute address")
  */
 INSTRUCTION(DECZX, 0xD6, 2, 6, "Decrement memory using zero page, X addressing")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sDECZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sDECZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X; // zero page wrap around
     uint8_t* addr = BP + zx;
+    MARK_DIRTY(addr - BP);
     *(addr) -= 1;
     SET_ZERO(*addr);
     SET_SIGN(*addr);
@@ -1097,8 +1201,10 @@ INSTRUCTION(DECZX, 0xD6, 2, 6, "Decrement memory using zero page, X addressing")
 INSTRUCTION(DECX, 0xDE, 3, 7, "Decrement memory value at absolute address, X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sDECX, (uint16_t)addr16);
-    uint8_t* addr = BP + addr16 + X;
+    ETRACE("%s %04x", __FILE__, __LINE__, sDECX, (uint16_t)addr16);
+    uint16_t ax = addr16 + X; // 64K wrap
+    uint8_t* addr = BP + ax;
+    MARK_DIRTY(ax);
     *(addr) -= 1;
     SET_ZERO(*addr);
     SET_SIGN(*addr);
@@ -1110,7 +1216,7 @@ INSTRUCTION(DECX, 0xDE, 3, 7, "Decrement memory value at absolute address, X")
  */
 INSTRUCTION(DEX, 0xCA, 1, 2, "Decrement X register")
 {
-    FTRACE("%s", __FILE__, __LINE__, sDEX);
+    ETRACE("%s", __FILE__, __LINE__, sDEX);
     X--;
     SET_ZERO(X);
     SET_SIGN(X);
@@ -1122,7 +1228,7 @@ INSTRUCTION(DEX, 0xCA, 1, 2, "Decrement X register")
  */
 INSTRUCTION(DEY, 0x88, 1, 2, "Decrement Y register")
 {
-    FTRACE("%s", __FILE__, __LINE__, sDEY);
+    ETRACE("%s", __FILE__, __LINE__, sDEY);
     Y--;
     SET_ZERO(Y);
     SET_SIGN(Y);
@@ -1134,7 +1240,7 @@ INSTRUCTION(DEY, 0x88, 1, 2, "Decrement Y register")
  */
 INSTRUCTION(EORI, 0x49, 2, 2, "Exclusive OR accumulator with immediate value")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sEORI, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sEORI, (uint8_t)*(BP+PC+1));
     A ^= *(BP+PC+1);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1146,7 +1252,7 @@ INSTRUCTION(EORI, 0x49, 2, 2, "Exclusive OR accumulator with immediate value")
  */
 INSTRUCTION(EORZ, 0x45, 2, 3, "Exclusive OR accumulator with zero page memory")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sEORZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sEORZ, (uint8_t)*(BP+PC+1));
     A ^= *(BP+*(BP+PC+1));
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1159,7 +1265,7 @@ INSTRUCTION(EORZ, 0x45, 2, 3, "Exclusive OR accumulator with zero page memory")
 INSTRUCTION(EORA, 0x4D, 3, 4, "Exclusive OR accumulator with absolute memory")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sEORA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sEORA, (uint16_t)addr16);
     A ^= *(BP + addr16);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1172,7 +1278,7 @@ INSTRUCTION(EORA, 0x4D, 3, 4, "Exclusive OR accumulator with absolute memory")
  */
 INSTRUCTION(EORZX, 0x55, 2, 4, "Exclusive OR memory location at zero page address plus X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sEORZX,*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sEORZX,*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X;
     A ^= *(BP + zx);
     SET_ZERO(A);
@@ -1186,7 +1292,7 @@ INSTRUCTION(EORZX, 0x55, 2, 4, "Exclusive OR memory location at zero page addres
 INSTRUCTION(EORX, 0x5D, 3, 4, "Exclusive OR the accumulator with the absolute address plus X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sEORX, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sEORX, (uint16_t)addr16);
     A ^= *(BP + addr16 + X);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1199,7 +1305,7 @@ INSTRUCTION(EORX, 0x5D, 3, 4, "Exclusive OR the accumulator with the absolute ad
 INSTRUCTION(EORY, 0x59, 3, 4, "Exclusive OR the accumulator with the absolute address plus Y")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sEORY, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sEORY, (uint16_t)addr16);
     A ^= *(BP + addr16 + Y);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1212,7 +1318,7 @@ INSTRUCTION(EORY, 0x59, 3, 4, "Exclusive OR the accumulator with the absolute ad
  */
 INSTRUCTION(EORIX, 0x41, 2, 6, "Exclusive OR using indexed indirect addressing mode")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sEORIX,*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sEORIX,*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X;
     A ^= *(BP + (*(BP + zx + 1)<<8) + *(BP + zx));
     SET_ZERO(A);
@@ -1226,7 +1332,7 @@ INSTRUCTION(EORIX, 0x41, 2, 6, "Exclusive OR using indexed indirect addressing m
  */
 INSTRUCTION(EORIY, 0x51, 2, 5, "Exclusive OR using indirect indexed addressing mode")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sEORIY,*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sEORIY,*(BP+PC+1));
     uint8_t zi = *(BP+PC+1);
     A ^= *(BP + (*(BP+zi+1)<<8) + *(BP+zi) + Y);
     SET_ZERO(A);
@@ -1240,8 +1346,9 @@ INSTRUCTION(EORIY, 0x51, 2, 5, "Exclusive OR using indirect indexed addressing m
 INSTRUCTION(INCA, 0xEE, 3, 6, "Increment memory value at absolute address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sINCA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sINCA, (uint16_t)addr16);
     uint8_t* addr = BP + addr16;
+    MARK_DIRTY(addr - BP);
     *(addr) += 1;
     SET_ZERO(*addr);
     SET_SIGN(*addr);
@@ -1253,7 +1360,7 @@ INSTRUCTION(INCA, 0xEE, 3, 6, "Increment memory value at absolute address")
  */
 INSTRUCTION(INX, 0xE8, 1, 2, "Increment X register")
 {
-    FTRACE("%s", __FILE__, __LINE__, sINX);
+    ETRACE("%s", __FILE__, __LINE__, sINX);
     X++;
     SET_ZERO(X);
     SET_SIGN(X);
@@ -1265,7 +1372,7 @@ INSTRUCTION(INX, 0xE8, 1, 2, "Increment X register")
  */
 INSTRUCTION(INY, 0xC8, 1, 2, "Increment Y regsiter")
 {
-    FTRACE("%s", __FILE__, __LINE__, sINY);
+    ETRACE("%s", __FILE__, __LINE__, sINY);
     Y++;
     SET_ZERO(Y);
     SET_SIGN(Y);
@@ -1277,8 +1384,9 @@ INSTRUCTION(INY, 0xC8, 1, 2, "Increment Y regsiter")
  */
 INSTRUCTION(INCZ, 0xE6, 2, 5, "Increment zero page memory address")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sINCZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sINCZ, (uint8_t)*(BP+PC+1));
     uint8_t* addr = BP + *(BP+PC+1);
+    MARK_DIRTY(addr - BP);
     *(addr) += 1;
     SET_ZERO(*addr);
     SET_SIGN(*addr);
@@ -1292,9 +1400,10 @@ INSTRUCTION(INCZ, 0xE6, 2, 5, "Increment zero page memory address")
  */
 INSTRUCTION(INCZX, 0xF6, 2, 6, "Increment memory at zero page plus X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sINCZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sINCZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X; // zero page wrap around
     uint8_t* addr = BP + zx;
+    MARK_DIRTY(addr - BP);
     *(addr) += 1;
     SET_ZERO(*addr);
     SET_SIGN(*addr);
@@ -1308,8 +1417,10 @@ INSTRUCTION(INCZX, 0xF6, 2, 6, "Increment memory at zero page plus X")
 INSTRUCTION(INCX, 0xFE, 3, 7, "Increment memory at address found by adding absolute address to X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sINCX, (uint16_t)addr16);
-    uint8_t* addr = BP + addr16 + X;
+    ETRACE("%s %04x", __FILE__, __LINE__, sINCX, (uint16_t)addr16);
+    uint16_t ax = addr16 + X; // 64K wrap
+    uint8_t* addr = BP + ax;
+    MARK_DIRTY(ax);
     *(addr) += 1;
     SET_ZERO(*addr);
     SET_SIGN(*addr);
@@ -1322,7 +1433,7 @@ INSTRUCTION(INCX, 0xFE, 3, 7, "Increment memory at address found by adding absol
 INSTRUCTION(JMP, 0x4C, 3, 3, "Jump to absolute address")
 {
     PC = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sJMP,PC); 
+    ETRACE("%s %04x", __FILE__, __LINE__, sJMP,PC); 
 }
 
 /**
@@ -1331,7 +1442,7 @@ INSTRUCTION(JMP, 0x4C, 3, 3, "Jump to absolute address")
 INSTRUCTION(JMPI, 0x6C, 3, 5, "Jump to indirect address")
 {
     PC = getIndirectAddress(); // xfer control to addr found there
-    FTRACE("%s %04x", __FILE__, __LINE__, sJMPI,PC);
+    ETRACE("%s %04x", __FILE__, __LINE__, sJMPI,PC);
 }
 
 /**
@@ -1340,9 +1451,10 @@ INSTRUCTION(JMPI, 0x6C, 3, 5, "Jump to indirect address")
 INSTRUCTION(JSR, 0x20, 3, 6, "Jump to subroutine")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sJSR, (uint16_t)addr16);
-    STACK[SP] = (PC+2)>>8; 
-    STACK[SP-1] = (PC+2)&0xFF; 
+    ETRACE("%s %04x", __FILE__, __LINE__, sJSR, (uint16_t)addr16);
+    STACK(SP) = (PC+2)>>8; 
+    STACK(SP-1) = (PC+2)&0xFF;
+    MARK_DIRTY(kStackPage);
     SP -= 2;
     PC = addr16;
 }
@@ -1352,7 +1464,7 @@ INSTRUCTION(JSR, 0x20, 3, 6, "Jump to subroutine")
  */
 INSTRUCTION(LDAI, 0xa9, 2, 2, "Load accumulator with immediate value")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDAI, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDAI, (uint8_t)*(BP+PC+1));
     A = *(BP+PC+1);                 
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1364,7 +1476,7 @@ INSTRUCTION(LDAI, 0xa9, 2, 2, "Load accumulator with immediate value")
  */
 INSTRUCTION(LDAZ, 0xa5, 2, 3, "Load accumulator from zero page memory")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDAZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDAZ, (uint8_t)*(BP+PC+1));
     A = *(BP+*(BP+PC+1));                 
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1377,7 +1489,7 @@ INSTRUCTION(LDAZ, 0xa5, 2, 3, "Load accumulator from zero page memory")
 INSTRUCTION(LDAA, 0xAD, 3, 4, "Load accumulator from absolute address memory")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sLDAA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sLDAA, (uint16_t)addr16);
     A = *(BP + addr16);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1390,7 +1502,7 @@ INSTRUCTION(LDAA, 0xAD, 3, 4, "Load accumulator from absolute address memory")
  */
 INSTRUCTION(LDAZX, 0xB5, 2, 4, "Load accumulator from zero page, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDAZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDAZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X; // zero page wrap around
     A = *(BP + zx);
     SET_ZERO(A);
@@ -1404,7 +1516,7 @@ INSTRUCTION(LDAZX, 0xB5, 2, 4, "Load accumulator from zero page, X")
  */
 INSTRUCTION(LDAIX, 0xA1, 2, 6, "Load accumulator from indirect address, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDAIX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDAIX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X; // zero page wrap around
     A = *(BP + (*(BP + zx + 1)<<8) + *(BP + zx));
     SET_ZERO(A);
@@ -1417,7 +1529,7 @@ INSTRUCTION(LDAIX, 0xA1, 2, 6, "Load accumulator from indirect address, X")
  */
 INSTRUCTION(LDAIY, 0xB1, 2, 5, "Load accumulator from indirect address, Y")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDAIY, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDAIY, (uint8_t)*(BP+PC+1));
     uint8_t zi = *(BP+PC+1);
     A = *(BP + (*(BP+zi+1)<<8) + *(BP+zi) + Y);
     SET_ZERO(A);
@@ -1432,7 +1544,7 @@ INSTRUCTION(LDAIY, 0xB1, 2, 5, "Load accumulator from indirect address, Y")
 INSTRUCTION(LDAX, 0xBD, 3, 4, "Load accumulator from absolute address, X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sLDAX, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sLDAX, (uint16_t)addr16);
     A = *(BP + addr16 + X);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1446,7 +1558,7 @@ INSTRUCTION(LDAX, 0xBD, 3, 4, "Load accumulator from absolute address, X")
 INSTRUCTION(LDAY, 0xB9, 3, 4, "Load accumulator from absolute address, Y")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sLDAY, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sLDAY, (uint16_t)addr16);
     A = *(BP + addr16 + Y);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1458,7 +1570,7 @@ INSTRUCTION(LDAY, 0xB9, 3, 4, "Load accumulator from absolute address, Y")
  */
 INSTRUCTION(LDXI, 0xA2, 2, 2, "Load X from immediate")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDXI, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDXI, (uint8_t)*(BP+PC+1));
     X = *(BP+PC+1);                 
     SET_ZERO(X);
     SET_SIGN(X);
@@ -1470,7 +1582,7 @@ INSTRUCTION(LDXI, 0xA2, 2, 2, "Load X from immediate")
  */
 INSTRUCTION(LDXZ, 0xA6, 2, 3, "Load X from zero page")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDXZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDXZ, (uint8_t)*(BP+PC+1));
     X = *(BP+*(BP+PC+1));                 
     SET_ZERO(X);
     SET_SIGN(X);
@@ -1482,7 +1594,7 @@ INSTRUCTION(LDXZ, 0xA6, 2, 3, "Load X from zero page")
  */
 INSTRUCTION(LDXZY, 0xB6, 2, 4, "Load X from zero page, Y")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDXZY, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDXZY, (uint8_t)*(BP+PC+1));
     uint8_t zy = *(BP+PC+1)+Y;
     X = *(BP + zy);
     SET_ZERO(X);
@@ -1496,7 +1608,7 @@ INSTRUCTION(LDXZY, 0xB6, 2, 4, "Load X from zero page, Y")
 INSTRUCTION(LDXA, 0xAE, 3, 4, "Load X from absolute address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sLDXA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sLDXA, (uint16_t)addr16);
     X = *(BP + addr16);
     SET_ZERO(X);
     SET_SIGN(X);
@@ -1509,7 +1621,7 @@ INSTRUCTION(LDXA, 0xAE, 3, 4, "Load X from absolute address")
 INSTRUCTION(LDXY, 0xBE, 3, 4, "Load X from absolute address, Y")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sLDXY, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sLDXY, (uint16_t)addr16);
     X = *(BP + addr16 + Y);
     SET_ZERO(X);
     SET_SIGN(X);
@@ -1521,7 +1633,7 @@ INSTRUCTION(LDXY, 0xBE, 3, 4, "Load X from absolute address, Y")
  */
 INSTRUCTION(LDYI, 0xA0, 2, 2, "Load Y from immediate")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDYI, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDYI, (uint8_t)*(BP+PC+1));
     Y = *(BP+PC+1);                 
     SET_ZERO(Y);
     SET_SIGN(Y);
@@ -1533,7 +1645,7 @@ INSTRUCTION(LDYI, 0xA0, 2, 2, "Load Y from immediate")
  */
 INSTRUCTION(LDYZ, 0xA4, 2, 3, "Load Y from zero page")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDYZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDYZ, (uint8_t)*(BP+PC+1));
     Y = *(BP+*(BP+PC+1));                 
     SET_ZERO(Y);
     SET_SIGN(Y);
@@ -1545,7 +1657,7 @@ INSTRUCTION(LDYZ, 0xA4, 2, 3, "Load Y from zero page")
  */
 INSTRUCTION(LDYZX, 0xB4, 2, 4, "Load Y from zero page, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLDYZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLDYZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X; // zero page wrap
     Y = *(BP + zx);
     SET_ZERO(Y);
@@ -1559,7 +1671,7 @@ INSTRUCTION(LDYZX, 0xB4, 2, 4, "Load Y from zero page, X")
 INSTRUCTION(LDYA, 0xAC, 3, 4, "Load Y from absolute address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sLDYA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sLDYA, (uint16_t)addr16);
     Y = *(BP + addr16);
     SET_ZERO(Y);
     SET_SIGN(Y);
@@ -1572,7 +1684,7 @@ INSTRUCTION(LDYA, 0xAC, 3, 4, "Load Y from absolute address")
 INSTRUCTION(LDYX, 0xBC, 3, 4, "Load Y from absolute address, X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sLDYX, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sLDYX, (uint16_t)addr16);
     Y = *(BP + addr16 + X);
     SET_ZERO(Y);
     SET_SIGN(Y);
@@ -1584,7 +1696,7 @@ INSTRUCTION(LDYX, 0xBC, 3, 4, "Load Y from absolute address, X")
  */
 INSTRUCTION(LSR, 0x4A, 1, 2, "Logical shift right accumulator")
 {
-    FTRACE("%s", __FILE__, __LINE__, sLSR);
+    ETRACE("%s", __FILE__, __LINE__, sLSR);
     SET_CARRY((A&0x01));
     A = A>>1;
     SET_ZERO(A);
@@ -1597,8 +1709,9 @@ INSTRUCTION(LSR, 0x4A, 1, 2, "Logical shift right accumulator")
  */
 INSTRUCTION(LSRZ, 0x46, 2, 5, "Logical shift right zero page memory")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLSRZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLSRZ, (uint8_t)*(BP+PC+1));
     uint8_t* addr = BP + *(BP+PC+1);
+    MARK_DIRTY(addr - BP);
     SET_CARRY((*addr&0x01));
     *addr = *addr>>1;
     SET_ZERO(*addr);
@@ -1612,8 +1725,9 @@ INSTRUCTION(LSRZ, 0x46, 2, 5, "Logical shift right zero page memory")
 INSTRUCTION(LSRA, 0x4E, 3, 6, "Logical shift right absolute memory address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sLSRA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sLSRA, (uint16_t)addr16);
     uint8_t* addr = BP + addr16;
+    MARK_DIRTY(addr - BP);
     SET_CARRY((*addr&0x01));
     *addr = *addr>>1;
     SET_ZERO(*addr);
@@ -1626,9 +1740,10 @@ INSTRUCTION(LSRA, 0x4E, 3, 6, "Logical shift right absolute memory address")
  */
 INSTRUCTION(LSRZX, 0x56, 2, 6, "Logical shift right zero page, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sLSRZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sLSRZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1) + X; // zero page wrap
     uint8_t* addr = BP + zx;
+    MARK_DIRTY(addr - BP);
     SET_CARRY((*addr&0x01));
     *addr = *addr>>1;
     SET_ZERO(*addr);
@@ -1642,8 +1757,10 @@ INSTRUCTION(LSRZX, 0x56, 2, 6, "Logical shift right zero page, X")
 INSTRUCTION(LSRX, 0x5E, 3, 7, "Logical shift right absolute address, X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sLSRX, (uint16_t)addr16);
-    uint8_t* addr = BP + addr16 + X;
+    ETRACE("%s %04x", __FILE__, __LINE__, sLSRX, (uint16_t)addr16);
+    uint16_t ax = addr16 + X; // 64K wrap
+    uint8_t* addr = BP + ax;
+    MARK_DIRTY(ax);
     SET_CARRY((*addr&0x01));
     *addr = *addr>>1;
     SET_ZERO(*addr);
@@ -1656,7 +1773,7 @@ INSTRUCTION(LSRX, 0x5E, 3, 7, "Logical shift right absolute address, X")
  */
 INSTRUCTION(NOP, 0xEA, 1, 2, "No operation")
 {
-    FTRACE("%s", __FILE__, __LINE__, sNOP);
+    ETRACE("%s", __FILE__, __LINE__, sNOP);
     PC++;
 }
 
@@ -1665,7 +1782,7 @@ INSTRUCTION(NOP, 0xEA, 1, 2, "No operation")
  */
 INSTRUCTION(ORAI, 0x09, 2, 2, "Logical OR accumulator with immediate value")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sORAI, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sORAI, (uint8_t)*(BP+PC+1));
     A |= *(BP+PC+1);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1677,7 +1794,7 @@ INSTRUCTION(ORAI, 0x09, 2, 2, "Logical OR accumulator with immediate value")
  */
 INSTRUCTION(ORAZ, 0x05, 2, 3, "Logical OR accumulator with zero page memory")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sORAZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sORAZ, (uint8_t)*(BP+PC+1));
     A |= *(BP+*(BP+PC+1));
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1690,7 +1807,7 @@ INSTRUCTION(ORAZ, 0x05, 2, 3, "Logical OR accumulator with zero page memory")
 INSTRUCTION(ORAA, 0x0D, 3, 4, "Logical OR accumulator with absolute memory address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sORAA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sORAA, (uint16_t)addr16);
     A |= *(BP + addr16);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1703,7 +1820,7 @@ INSTRUCTION(ORAA, 0x0D, 3, 4, "Logical OR accumulator with absolute memory addre
  */
 INSTRUCTION(ORAZX, 0x15, 2, 4, "Logical OR accumulator with zero page, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sORAZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sORAZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X;
     A |= *(BP + zx);
     SET_ZERO(A);
@@ -1717,7 +1834,7 @@ INSTRUCTION(ORAZX, 0x15, 2, 4, "Logical OR accumulator with zero page, X")
 INSTRUCTION(ORAX, 0x1D, 3, 4, "Logical OR accumulator with absolute address, X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sORAX, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sORAX, (uint16_t)addr16);
     A |= *(BP + addr16 + X);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1730,7 +1847,7 @@ INSTRUCTION(ORAX, 0x1D, 3, 4, "Logical OR accumulator with absolute address, X")
 INSTRUCTION(ORAY, 0x19, 3, 4, "Logical OR accumulator with absolute address, Y")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sORAY, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sORAY, (uint16_t)addr16);
     A |= *(BP + addr16 + Y);
     SET_ZERO(A);
     SET_SIGN(A);
@@ -1743,7 +1860,7 @@ INSTRUCTION(ORAY, 0x19, 3, 4, "Logical OR accumulator with absolute address, Y")
  */
 INSTRUCTION(ORAIX, 0x01, 2, 6, "Logical OR accumulator using indirect indexed, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sORAIX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sORAIX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X;
     A |= *(BP + (*(BP + zx + 1)<<8) + *(BP + zx));                 
     SET_ZERO(A);
@@ -1757,7 +1874,7 @@ INSTRUCTION(ORAIX, 0x01, 2, 6, "Logical OR accumulator using indirect indexed, X
  */
 INSTRUCTION(ORAIY, 0x11, 2, 5, "Logical OR accumulator using indexed indirect, Y")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sORAIY, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sORAIY, (uint8_t)*(BP+PC+1));
     uint8_t zi = *(BP+PC+1);
     A |= *(BP + (*(BP+zi+1)<<8) + *(BP+zi) + Y);
     SET_ZERO(A);
@@ -1770,8 +1887,9 @@ INSTRUCTION(ORAIY, 0x11, 2, 5, "Logical OR accumulator using indexed indirect, Y
  */
 INSTRUCTION(PHA, 0x48, 1, 3, "Push accumulator onto stack")
 {
-    FTRACE("%s", __FILE__, __LINE__, sPHA);
-    STACK[SP] = A;
+    ETRACE("%s", __FILE__, __LINE__, sPHA);
+    STACK(SP) = A;
+    MARK_DIRTY(kStackPage);
     SP--;
     PC++;
 }
@@ -1781,8 +1899,8 @@ INSTRUCTION(PHA, 0x48, 1, 3, "Push accumulator onto stack")
  */
 INSTRUCTION(PLA, 0x68, 1, 4, "Pull accumulator from stack")
 {
-    FTRACE("%s", __FILE__, __LINE__, sPLA);
-    A = STACK[SP+1];
+    ETRACE("%s", __FILE__, __LINE__, sPLA);
+    A = STACK(SP+1);
     SP++;
     PC++;
 }
@@ -1792,8 +1910,9 @@ INSTRUCTION(PLA, 0x68, 1, 4, "Pull accumulator from stack")
  */
 INSTRUCTION(PHP, 0x08, 1, 3, "Push processor status on stack")
 {
-    FTRACE("%s", __FILE__, __LINE__, sPHP);
-    STACK[SP] = P;
+    ETRACE("%s", __FILE__, __LINE__, sPHP);
+    STACK(SP) = P;
+    MARK_DIRTY(kStackPage);
     SP--;
     PC++;
 }
@@ -1803,8 +1922,8 @@ INSTRUCTION(PHP, 0x08, 1, 3, "Push processor status on stack")
  */
 INSTRUCTION(PLP, 0x28, 1, 4, "Pull process status from stack")
 {
-    FTRACE("%s", __FILE__, __LINE__, sPLP);
-    P = STACK[SP+1];
+    ETRACE("%s", __FILE__, __LINE__, sPLP);
+    P = STACK(SP+1);
     ZEROBIT = (P&(1<<kZEROBIT)) == (1<<kZEROBIT);
     SIGNBIT = (P&(1<<kSIGNBIT)) == (1<<kSIGNBIT);
     CARRYBIT = (P&(1<<kCARRYBIT)) == (1<<kCARRYBIT);
@@ -1820,7 +1939,7 @@ INSTRUCTION(PLP, 0x28, 1, 4, "Pull process status from stack")
  */
 INSTRUCTION(ROL, 0x2A, 1, 2, "Rotate accumulator one bit left")
 {
-    FTRACE("%s", __FILE__, __LINE__, sROL);
+    ETRACE("%s", __FILE__, __LINE__, sROL);
     uint8_t c = CARRYBIT;
     SET_CARRY(((A&0x80)==0x80));
     A = A<<1;
@@ -1835,8 +1954,9 @@ INSTRUCTION(ROL, 0x2A, 1, 2, "Rotate accumulator one bit left")
  */
 INSTRUCTION(ROLZ, 0x26, 2, 5, "Rotate zero page memory one bit left")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sROLZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sROLZ, (uint8_t)*(BP+PC+1));
     uint8_t* addr = BP + *(BP+PC+1);
+    MARK_DIRTY(addr - BP);
     uint8_t c = CARRYBIT;
     SET_CARRY(((*addr&0x80)==0x80));
     *addr = *addr<<1;
@@ -1852,8 +1972,9 @@ INSTRUCTION(ROLZ, 0x26, 2, 5, "Rotate zero page memory one bit left")
 INSTRUCTION(ROLA, 0x2E, 3, 6, "Rotate absolute memory value left")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sROLA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sROLA, (uint16_t)addr16);
     uint8_t* addr = BP + addr16;
+    MARK_DIRTY(addr - BP);
     uint8_t c = CARRYBIT;
     SET_CARRY(((*addr&0x80)==0x80));
     *addr = *addr<<1;
@@ -1868,9 +1989,10 @@ INSTRUCTION(ROLA, 0x2E, 3, 6, "Rotate absolute memory value left")
  */
 INSTRUCTION(ROLZX, 0x36, 2, 6, "Rotate zero page indexed memory left")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sROLZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sROLZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X; // zero page wrap
     uint8_t* addr = BP + zx;
+    MARK_DIRTY(addr - BP);
     uint8_t c = CARRYBIT;
     SET_CARRY(((*addr&0x80)==0x80));
     *addr = *addr<<1;
@@ -1886,8 +2008,10 @@ INSTRUCTION(ROLZX, 0x36, 2, 6, "Rotate zero page indexed memory left")
 INSTRUCTION(ROLX, 0x3E, 3, 7, "Rotate absolute memory value indexed by X to the left")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sROLX, (uint16_t)addr16);
-    uint8_t* addr = BP + addr16 + X;
+    ETRACE("%s %04x", __FILE__, __LINE__, sROLX, (uint16_t)addr16);
+    uint16_t ax = addr16 + X; // 64K wrap
+    uint8_t* addr = BP + ax;
+    MARK_DIRTY(ax);
     uint8_t c = CARRYBIT;
     SET_CARRY(((*addr&0x80)==0x80));
     *addr = *addr<<1;
@@ -1902,7 +2026,7 @@ INSTRUCTION(ROLX, 0x3E, 3, 7, "Rotate absolute memory value indexed by X to the
  */
 INSTRUCTION(ROR, 0x6A, 1, 2, "Rotate accumulator right")
 {
-    FTRACE("%s", __FILE__, __LINE__, sROR);
+    ETRACE("%s", __FILE__, __LINE__, sROR);
     uint8_t c = CARRYBIT;
     SET_CARRY((A&0x01));
     A = A>>1;
@@ -1917,8 +2041,9 @@ INSTRUCTION(ROR, 0x6A, 1, 2, "Rotate accumulator right")
  */
 INSTRUCTION(RORZ, 0x66, 2, 5, "Rotate zero page memory value right")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sRORZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sRORZ, (uint8_t)*(BP+PC+1));
     uint8_t* addr = BP + *(BP+PC+1);
+    MARK_DIRTY(addr - BP);
     uint8_t c = CARRYBIT;
     SET_CARRY((*addr&0x01));
     *addr = *addr>>1;
@@ -1934,8 +2059,9 @@ INSTRUCTION(RORZ, 0x66, 2, 5, "Rotate zero page memory value right")
 INSTRUCTION(RORA, 0x6E, 3, 6, "Rotate absolute memory address value right")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sRORA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sRORA, (uint16_t)addr16);
     uint8_t* addr = BP + addr16;
+    MARK_DIRTY(addr - BP);
     uint8_t c = CARRYBIT;
     SET_CARRY((*addr&0x01));
     *addr = *addr>>1;
@@ -1950,9 +2076,10 @@ INSTRUCTION(RORA, 0x6E, 3, 6, "Rotate absolute memory address value right")
  */
 INSTRUCTION(RORZX, 0x76, 2, 6, "Rotate zero page indexed memory address value right")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sRORZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sRORZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X; // zero page wrap
-    uint8_t* addr = BP + zx; 
+    uint8_t* addr = BP + zx;
+    MARK_DIRTY(addr - BP);
     uint8_t c = CARRYBIT;
     SET_CARRY((*addr&0x01));
     *addr = *addr>>1;
@@ -1968,8 +2095,10 @@ INSTRUCTION(RORZX, 0x76, 2, 6, "Rotate zero page indexed memory address value ri
 INSTRUCTION(RORX, 0x7E, 3, 7, "Rotate absolute memory value indexed by X to the right")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sRORX, (uint16_t)addr16);
-    uint8_t* addr = BP + addr16 + X;
+    ETRACE("%s %04x", __FILE__, __LINE__, sRORX, (uint16_t)addr16);
+    uint16_t ax = addr16 + X; // 64K wrap
+    uint8_t* addr = BP + ax;
+    MARK_DIRTY(ax);
     uint8_t c = CARRYBIT;
     SET_CARRY((*addr&0x01));
     *addr = *addr>>1;
@@ -1987,15 +2116,15 @@ INSTRUCTION(RORX, 0x7E, 3, 7, "Rotate absolute memory value indexed by X to the
  */
 INSTRUCTION(RTI, 0x40, 1, 6, "Return from interrupt, restoring status bits")
 {
-    FTRACE("%s", __FILE__, __LINE__, sRTI);
-    P = STACK[SP+1];
+    ETRACE("%s", __FILE__, __LINE__, sRTI);
+    P = STACK(SP+1);
     ZEROBIT = (P&(1<<kZEROBIT)) == (1<<kZEROBIT);
     SIGNBIT = (P&(1<<kSIGNBIT)) == (1<<kSIGNBIT);
     CARRYBIT = (P&(1<<kCARRYBIT)) == (1<<kCARRYBIT);
     OVERFLOWBIT = (P&(1<<kOVERFLOWBIT)) == (1<<kOVERFLOWBIT);
     DECIMALBIT = (P&(1<<kDECIMALBIT)) == (1<<kDECIMALBIT);
     BREAKBIT = (P&(1<<kBREAKBIT)) == (1<<kBREAKBIT);
-    PC = (uint16_t)(STACK[SP+3]<<8)+(uint16_t)STACK[SP+2];
+    PC = (uint16_t)(STACK(SP+3)<<8)+(uint16_t)STACK(SP+2);
     SP += 3;
 }
 
@@ -2004,8 +2133,8 @@ INSTRUCTION(RTI, 0x40, 1, 6, "Return from interrupt, restoring status bits")
  */
 INSTRUCTION(RTS, 0x60, 1, 6, "Return from subroutine")
 {
-    FTRACE("%s", __FILE__, __LINE__, sRTS);
-    PC = (uint16_t)(STACK[SP+2]<<8)+(uint16_t)STACK[SP+1]+1;
+    ETRACE("%s", __FILE__, __LINE__, sRTS);
+    PC = (uint16_t)(STACK(SP+2)<<8)+(uint16_t)STACK(SP+1)+1;
     SP += 2;
 }
 
@@ -2014,7 +2143,7 @@ INSTRUCTION(RTS, 0x60, 1, 6, "Return from subroutine")
  */
 INSTRUCTION(SBCI, 0xE9, 2, 2, "Subtract immediate value from accumulator with carry")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSBCI, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sSBCI, (uint8_t)*(BP+PC+1));
     A = A - *(BP+PC+1) - (1 - CARRYBIT);                 
     SET_CARRY(((A&0x80)==0x80));
     SET_ZERO(A);
@@ -2029,7 +2158,7 @@ INSTRUCTION(SBCI, 0xE9, 2, 2, "Subtract immediate value from accumulator with ca
  */
 INSTRUCTION(SBCZ, 0xE5, 2, 3, "Subtract memory from accumulator with carry, zero page")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSBCZ, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sSBCZ, (uint8_t)*(BP+PC+1));
     A = A - *(BP+*(BP+PC+1)) - (1 - CARRYBIT);
     SET_CARRY(((A&0x80)==0x80));
     SET_ZERO(A);
@@ -2044,7 +2173,7 @@ INSTRUCTION(SBCZ, 0xE5, 2, 3, "Subtract memory from accumulator with carry, zero
 INSTRUCTION(SBCA, 0xED, 3, 4, "Subtract absolute memory from accumulator with carry")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sSBCA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sSBCA, (uint16_t)addr16);
     A = A - *(BP + addr16) - (1 - CARRYBIT);
     SET_CARRY(((A&0x80)==0x80));
     SET_ZERO(A);
@@ -2058,7 +2187,7 @@ INSTRUCTION(SBCA, 0xED, 3, 4, "Subtract absolute memory from accumulator with ca
  */
 INSTRUCTION(SBCZX, 0xE1, 2, 6, "Subtract zero page memory from accumulator with carry")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSBCZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sSBCZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X;
     A = A - *(BP + zx) - (1 - CARRYBIT);
     SET_CARRY(((A&0x80)==0x80));
@@ -2074,7 +2203,7 @@ INSTRUCTION(SBCZX, 0xE1, 2, 6, "Subtract zero page memory from accumulator with
  */
 INSTRUCTION(SBCIX, 0xF5, 2, 4, "Subtract with carry from indirect, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSBCIX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sSBCIX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X;
     A = A - *(BP + (*(BP + zx + 1)<<8) + *(BP + zx)) - (1 - CARRYBIT);
     SET_CARRY(((A&0x80)==0x80));
@@ -2090,7 +2219,7 @@ INSTRUCTION(SBCIX, 0xF5, 2, 4, "Subtract with carry from indirect, X")
 INSTRUCTION(SBCY, 0xF9, 3, 4, "Subtract with carry from absolute, Y")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sSBCY, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sSBCY, (uint16_t)addr16);
     A = A - *(BP + addr16 + Y) - (1 - CARRYBIT);
     SET_CARRY(((A&0x80)==0x80));
     SET_ZERO(A);
@@ -2105,7 +2234,7 @@ INSTRUCTION(SBCY, 0xF9, 3, 4, "Subtract with carry from absolute, Y")
 INSTRUCTION(SBCX, 0xFD, 3, 4, "Subtract with carry from absolute, X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sSBCX, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sSBCX, (uint16_t)addr16);
     A = A - *(BP + addr16 + X) - (1 - CARRYBIT);
     SET_CARRY(((A&0x80)==0x80));
     SET_ZERO(A);
@@ -2119,7 +2248,7 @@ INSTRUCTION(SBCX, 0xFD, 3, 4, "Subtract with carry from absolute, X")
  */
 INSTRUCTION(SBCIY, 0xF1, 2, 5, "Subtract with carry from indirect, Y")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSBCIY, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sSBCIY, (uint8_t)*(BP+PC+1));
     uint8_t zi = *(BP+PC+1);
     A = A - *(BP + (*(BP+zi+1)<<8) + *(BP+zi) + Y) - (1 - CARRYBIT);
     SET_CARRY(((A&0x80)==0x80));
@@ -2134,7 +2263,7 @@ INSTRUCTION(SBCIY, 0xF1, 2, 5, "Subtract with carry from indirect, Y")
  */
 INSTRUCTION(SED, 0xF8, 1, 2, "Set decimal bit")
 {
-    FTRACE("%s", __FILE__, __LINE__, sSED);
+    ETRACE("%s", __FILE__, __LINE__, sSED);
     SET_DECIMAL(1);
     PC++;
 }
@@ -2144,7 +2273,7 @@ INSTRUCTION(SED, 0xF8, 1, 2, "Set decimal bit")
  */
 INSTRUCTION(SEC, 0x38, 1, 2, "Set carry bit")
 {
-    FTRACE("%s", __FILE__, __LINE__, sSEC);
+    ETRACE("%s", __FILE__, __LINE__, sSEC);
     SET_CARRY(1);
     PC++;
 }
@@ -2154,7 +2283,7 @@ INSTRUCTION(SEC, 0x38, 1, 2, "Set carry bit")
  */
 INSTRUCTION(SEI, 0x78, 1, 2, "Set interrupt bit")
 {
-    FTRACE("%s", __FILE__, __LINE__, sSEI);
+    ETRACE("%s", __FILE__, __LINE__, sSEI);
     SET_INTERRUPT(0);
     PC++;
 }
@@ -2164,8 +2293,9 @@ INSTRUCTION(SEI, 0x78, 1, 2, "Set interrupt bit")
  */
 INSTRUCTION(STAZ, 0x85, 2, 3, "Store accumulator to zero page memory")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSTAZ, (uint8_t)*(BP+PC+1));
-    *(BP+*(BP+PC+1)) = A;                 
+    ETRACE("%s %02x", __FILE__, __LINE__, sSTAZ, (uint8_t)*(BP+PC+1));
+    *(BP+*(BP+PC+1)) = A;
+    MARK_DIRTY(*(BP+PC+1));
     PC += 2;
 }  
 
@@ -2175,8 +2305,9 @@ INSTRUCTION(STAZ, 0x85, 2, 3, "Store accumulator to zero page memory")
 INSTRUCTION(STAA, 0x8D, 3, 4, "Store accumulator to absolute memory address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sSTAA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sSTAA, (uint16_t)addr16);
     *(BP + addr16) = A;
+    MARK_DIRTY(addr16);
     PC += 3;
 }
 
@@ -2186,9 +2317,10 @@ INSTRUCTION(STAA, 0x8D, 3, 4, "Store accumulator to absolute memory address")
  */
 INSTRUCTION(STAZX, 0x95, 2, 4, "Store accumulator to zero page, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSTAZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sSTAZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X; // zero page wrap
     *(BP + zx) = A;
+    MARK_DIRTY(zx);
     PC += 2;
 }
 
@@ -2199,8 +2331,10 @@ INSTRUCTION(STAZX, 0x95, 2, 4, "Store accumulator to zero page, X")
 INSTRUCTION(STAX, 0x9D, 3, 5, "Store accumulator to absolute address, X")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sSTAX, (uint16_t)addr16);
-    *(BP + addr16 + X) = A;
+    ETRACE("%s %04x", __FILE__, __LINE__, sSTAX, (uint16_t)addr16);
+    uint16_t ax = addr16 + X; // 64K wrap
+    *(BP + ax) = A;
+    MARK_DIRTY(ax);
     PC += 3;
 }
 
@@ -2211,8 +2345,10 @@ INSTRUCTION(STAX, 0x9D, 3, 5, "Store accumulator to absolute address, X")
 INSTRUCTION(STAY, 0x99, 3, 5, "Store accumulator to absolute address, Y")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sSTAY, (uint16_t)addr16);
-    *(BP + addr16 + Y) = A;
+    ETRACE("%s %04x", __FILE__, __LINE__, sSTAY, (uint16_t)addr16);
+    uint16_t ay = addr16 + Y; // 64K wrap
+    *(BP + ay) = A;
+    MARK_DIRTY(ay);
     PC += 3;
 }
 
@@ -2222,9 +2358,11 @@ INSTRUCTION(STAY, 0x99, 3, 5, "Store accumulator to absolute address, Y")
  */
 INSTRUCTION(STAIX, 0x81, 2, 6, "Store accumulator to indirect address, X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSTAIX, (uint16_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sSTAIX, (uint16_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1)+X; // zero page wrap
-    *(BP + (*(BP + zx + 1)<<8) + *(BP + zx)) = A;
+    uint16_t addr16 = (*(BP + zx + 1)<<8) + *(BP + zx);
+    *(BP + addr16) = A;
+    MARK_DIRTY(addr16);
     PC += 2;
 }
 
@@ -2234,9 +2372,11 @@ INSTRUCTION(STAIX, 0x81, 2, 6, "Store accumulator to indirect address, X")
  */
 INSTRUCTION(STAIY, 0x91, 2, 6, "Store accumulator to indirect address, Y")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSTAIY, (uint16_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sSTAIY, (uint16_t)*(BP+PC+1));
     uint8_t zi = *(BP+PC+1);
-    *(BP + (*(BP+zi+1)<<8) + *(BP+zi) + Y) = A;
+    uint16_t addr16 = (*(BP+zi+1)<<8) + *(BP+zi) + Y;
+    *(BP + addr16) = A;
+    MARK_DIRTY(addr16);
     PC += 2;
 }
 
@@ -2245,8 +2385,9 @@ INSTRUCTION(STAIY, 0x91, 2, 6, "Store accumulator to indirect address, Y")
  */
 INSTRUCTION(STXZ, 0x86, 2, 3, "Store X to zero page memory")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSTXZ, (uint16_t)*(BP+PC+1));
-    *(BP+*(BP+PC+1)) = X;                 
+    ETRACE("%s %02x", __FILE__, __LINE__, sSTXZ, (uint16_t)*(BP+PC+1));
+    *(BP+*(BP+PC+1)) = X;
+    MARK_DIRTY(*(BP+PC+1));
     PC += 2;
 }
 
@@ -2256,8 +2397,9 @@ INSTRUCTION(STXZ, 0x86, 2, 3, "Store X to zero page memory")
 INSTRUCTION(STXA, 0x8E, 3, 4, "Store X to absolute memory address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sSTXA, (uint16_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sSTXA, (uint16_t)addr16);
     *(BP + addr16) = X;
+    MARK_DIRTY(addr16);
     PC += 3;
 }
 
@@ -2266,9 +2408,10 @@ INSTRUCTION(STXA, 0x8E, 3, 4, "Store X to absolute memory address")
  */
 INSTRUCTION(STXZY, 0x96, 2, 4, "Store X to memory indexed by zero page address plus Y")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSTXZY, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sSTXZY, (uint8_t)*(BP+PC+1));
     uint8_t zy = *(BP+PC+1)+Y;
     *(BP + zy) = X;
+    MARK_DIRTY(zy);
     PC += 2;
 }
 
@@ -2277,8 +2420,9 @@ INSTRUCTION(STXZY, 0x96, 2, 4, "Store X to memory indexed by zero page address p
  */
 INSTRUCTION(STYZ, 0x84, 2, 3, "Store Y to zero page memory address")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSTYZ, (uint8_t)*(BP+PC+1));
-    *(BP+*(BP+PC+1)) = Y;                 
+    ETRACE("%s %02x", __FILE__, __LINE__, sSTYZ, (uint8_t)*(BP+PC+1));
+    *(BP+*(BP+PC+1)) = Y;
+    MARK_DIRTY(*(BP+PC+1));
     PC += 2;
 }
 
@@ -2288,8 +2432,9 @@ INSTRUCTION(STYZ, 0x84, 2, 3, "Store Y to zero page memory address")
 INSTRUCTION(STYA, 0x8C, 3, 4, "Store Y to absolute memory address")
 {
     uint16_t addr16 = getAbsoluteAddress();
-    FTRACE("%s %04x", __FILE__, __LINE__, sSTYA, (uint8_t)addr16);
+    ETRACE("%s %04x", __FILE__, __LINE__, sSTYA, (uint8_t)addr16);
     *(BP + addr16) = Y;
+    MARK_DIRTY(addr16);
     PC += 3;
 }
 
@@ -2298,9 +2443,10 @@ INSTRUCTION(STYA, 0x8C, 3, 4, "Store Y to absolute memory address")
  */
 INSTRUCTION(STYZX, 0x94, 2, 4, "Store Y to zero page memory address indexed by X")
 {
-    FTRACE("%s %02x", __FILE__, __LINE__, sSTYZX, (uint8_t)*(BP+PC+1));
+    ETRACE("%s %02x", __FILE__, __LINE__, sSTYZX, (uint8_t)*(BP+PC+1));
     uint8_t zx = *(BP+PC+1) + X; // zero page wrap
     *(BP + zx) = Y;
+    MARK_DIRTY(zx);
     PC += 2;
 }
 
@@ -2309,7 +2455,7 @@ INSTRUCTION(STYZX, 0x94, 2, 4, "Store Y to zero page memory address indexed by X
  */
 INSTRUCTION(TAX, 0xAA, 1, 2, "Transfer accumulator to X")
 {
-    FTRACE("%s", __FILE__, __LINE__, sTAX);
+    ETRACE("%s", __FILE__, __LINE__, sTAX);
     X = A;
     SET_ZERO(X);
     SET_SIGN(X);
@@ -2321,7 +2467,7 @@ INSTRUCTION(TAX, 0xAA, 1, 2, "Transfer accumulator to X")
  */
 INSTRUCTION(TAY, 0xA8, 1, 2, "Transfer accumulator to Y")
 {
-    FTRACE("%s", __FILE__, __LINE__, sTAY);
+    ETRACE("%s", __FILE__, __LINE__, sTAY);
     Y = A;
     SET_ZERO(Y);
     SET_SIGN(Y);
@@ -2333,7 +2479,7 @@ INSTRUCTION(TAY, 0xA8, 1, 2, "Transfer accumulator to Y")
  */
 INSTRUCTION(TSX, 0xBA, 1, 2, "Transfer stack pointer to X")
 {
-    FTRACE("%s", __FILE__, __LINE__, sTSX);
+    ETRACE("%s", __FILE__, __LINE__, sTSX);
     X = SP;
     SET_ZERO(X);
     SET_SIGN(X);
@@ -2345,7 +2491,7 @@ INSTRUCTION(TSX, 0xBA, 1, 2, "Transfer stack pointer to X")
  */
 INSTRUCTION(TXA, 0x8A, 1, 2, "Transfer X to accumulator")
 {
-    FTRACE("%s", __FILE__, __LINE__, sTXA);
+    ETRACE("%s", __FILE__, __LINE__, sTXA);
     A = X;
     SET_ZERO(A);
     SET_SIGN(A);
@@ -2357,7 +2503,7 @@ INSTRUCTION(TXA, 0x8A, 1, 2, "Transfer X to accumulator")
  */
 INSTRUCTION(TYA, 0x98, 1, 2, "Transfer Y to accumulator")
 {
-    FTRACE("%s", __FILE__, __LINE__, sTYA);
+    ETRACE("%s", __FILE__, __LINE__, sTYA);
     A = Y;
     SET_ZERO(A);
     SET_SIGN(A);
@@ -2369,7 +2515,7 @@ INSTRUCTION(TYA, 0x98, 1, 2, "Transfer Y to accumulator")
  */
 INSTRUCTION(TXS, 0x9A, 1, 2, "Transfer X to stack pointer")
 {
-    FTRACE("%s", __FILE__, __LINE__, sTXS);
+    ETRACE("%s", __FILE__, __LINE__, sTXS);
     SP = X;
     PC++;
 }
@@ -2486,6 +2632,54 @@ uint8_t p()
     return P;
 }
 
+/**
+ * Return the number of CPU cycles elapsed since the last reset.
+ */
+uint64_t cycles()
+{
+    return CYCLES;
+}
+
+/**
+ * Sum the opcode counts since the last reset.
+ */
+static uint64_t countInstructions()
+{
+    uint64_t count = 0;
+
+    for (int op=0; op < kInstrSetTableSize; op++) count += OPCOUNTS[op];
+
+    return count;
+}
+
+/**
+ * Fold the cycles run since the last reset or state load into the
+ * thread's retired count, before the cycle counter is replaced.
+ */
+static void retireCycles()
+{
+    RETIRED.cycles += CYCLES - RETIRED.base;
+}
+
+RETIRED_COUNTS::~RETIRED_COUNTS()
+{
+    s_exitedCycles += cycles + (CYCLES - base);
+    s_exitedInstructions += instructions + countInstructions();
+}
+
+/**
+ * Return the instructions and cycles executed by every machine in the
+ * process.
+ */
+void executedTotals(uint64_t* instructions, uint64_t* cycles)
+{
+    assert(instructions);
+    assert(cycles);
+
+    *instructions = s_exitedInstructions + RETIRED.instructions + countInstructions();
+    *cycles = s_exitedCycles + RETIRED.cycles + (CYCLES - RETIRED.base);
+}
+
 /**
  * Return the next input token from the sequence.
  */
@@ -2531,6 +2725,37 @@ uint16_t findLabel(const char* label)
     return (it != labels.end()) ? it->second : 0;
 }			
 
+/**
+ * Look up an assembler label for an address.
+ */
+const char* labelAt(uint16_t address)
+{
+    for (SymbolAddressMap::iterator it = labels.begin(); it != labels.end(); ++it)
+    {
+        if (it->second == address) return it->first.c_str();
+    }
+
+    return 0;
+}
+
+/**
+ * Look up the source line of the instruction at an address.
+ */
+unsigned int lineAt(uint16_t address)
+{
+    AddressLineMap::iterator it = lines.find(address);
+
+    return (it != lines.end()) ? it->second : 0;
+}
+
+/**
+ * Return the name of the last assembled source file.
+ */
+const char* sourceFile()
+{
+    return sourceName.c_str();
+}
+
 /*
  * Returns the offset between two addresses.
  */
@@ -2558,18 +2783,12 @@ void addBranch(const char* branch, uint16_t address)
 }
 
 /**
- * Initializes the instruction table and corresponding
- * functions, data structures, etc.
- *
- * @param rateHz CPU clock rate in Hz (default 1000000 = 1 MHz)
+ * Build the instruction set table.
  */
-int initialize(unsigned int rateHz)
+static constexpr INST_TABLE buildInstructions()
 {
-    int err = ticker_init(rateHz);
-    if (err != 0)
-    {
-        printf("Warning: clock timing initialization failed, error %d", err);
-    }
+    INST_TABLE table = {};
+
     MAP_INITIALIZE;
     MAP_INSTRUCTION(ADCA);
     MAP_INSTRUCTION(ADCI);
@@ -2722,6 +2941,30 @@ int initialize(unsigned int rateHz)
     MAP_INSTRUCTION(TXA);
     MAP_INSTRUCTION(TXS);
     MAP_INSTRUCTION(TYA);
+
+    return table;
+}
+
+//
+// 6502 instruction set table (indexed by opcode)
+//
+static constexpr INST_TABLE kInstructions = buildInstructions();
+static constexpr const INST_EXEC* i6502 = kInstructions.exec;
+static constexpr const INST_INFO* i6502Info = kInstructions.info;
+
+/**
+ * Initializes the clock and corresponding functions, data
+ * structures, etc. The instruction table needs no setup.
+ *
+ * @param rateHz CPU clock rate in Hz (default 1000000 = 1 MHz)
+ */
+int initialize(unsigned int rateHz)
+{
+    int err = ticker_init(rateHz);
+    if (err != 0)
+    {
+        printf("Warning: clock timing initialization failed, error %d", err);
+    }
     bInitialized = true;
     return 0;
 }
@@ -2748,9 +2991,14 @@ int load(const char* filename)
     FILE* fp = fopen(filename, "rb");
 
     if (fp == NULL) return errno;
+    MARK_ALL_DIRTY();
     if (k64K != fread(memory, sizeof(char), k64K, fp)) return errno;
     if (0 != fclose(fp)) return errno;
 
+    // Object code carries no line table
+    lines.clear();
+    sourceName.clear();
+
     return 0;
 }
 
@@ -2778,9 +3026,12 @@ int save(const char* filename)
 void prepare()
 {
     memset(memory, 0, k64K);
+    MARK_ALL_DIRTY();
     labels.clear();
     branches.clear();
     breakpoints.clear();
+    lines.clear();
+    sourceName.clear();
 }
 
 /**
@@ -2797,7 +3048,7 @@ short lookup(const char* str)
 
     for (int i=0; i < kInstrSetTableSize; i++)
     {
-        if (strcmp(str, i6502[i].symbol) == 0)
+        if (strcmp(str, i6502Info[i].symbol) == 0)
         {
             index = i;
             break;
@@ -2812,7 +3063,7 @@ short lookup(const char* str)
  */
 int resolve()
 {
-    FTRACE("Resolving %d branches\n", __FILE__, __LINE__, branches.size());
+    FTRACE_AT(kTraceAssembler, kTraceDebug, "Resolving %d branches\n", __FILE__, __LINE__, branches.size());
 
     // 
     // Resolve branches/jumps
@@ -2824,7 +3075,7 @@ int resolve()
         uint16_t brAddress = it->first; // address of unresolved branch
         const std::string& brLabel = it->second; // label to branch to
 
-        FTRACE("Resolving branch %s at %04x\n", __FILE__, __LINE__,
+        FTRACE_AT(kTraceAssembler, kTraceDebug, "Resolving branch %s at %04x\n", __FILE__, __LINE__,
             brLabel.c_str(), brAddress);
 
         //
@@ -2832,7 +3083,7 @@ int resolve()
         //
         uint16_t address = findLabel(brLabel.c_str());
 
-        FTRACE("Resolved label %s to %04x\n", __FILE__, __LINE__,
+        FTRACE_AT(kTraceAssembler, kTraceDebug, "Resolved label %s to %04x\n", __FILE__, __LINE__,
             brLabel.c_str(), address);
 
         if (address)
@@ -2840,7 +3091,7 @@ int resolve()
             //
             // Look for JSR or JMP instructions
             //
-            if (i6502[memory[brAddress-1]].symbol[0] == 'J')
+            if (i6502Info[memory[brAddress-1]].symbol[0] == 'J')
             {
                 //
                 // Store the destination address after the JMP/JSR
@@ -2866,23 +3117,17 @@ int resolve()
 }
 
 /*
- * Load the assembly program from the named file and attempt to
- * assemble it.
+ * Assemble the program read from an open stream. The stream is left
+ * open for the caller to close.
  */
-int assemble(const char* filename)
+static int assembleStream(FILE* fp)
 {
-    assert(filename);
+    assert(fp);
 
     // @todo add trace statements
     // @todo this whole block and related functions need to be refactored
     // @todo bestow award for worlds longest function
 
-    if (bInitialized == false) return -1;
-
-    FILE* fp = fopen(filename, "r");
-
-    if (fp == NULL) return errno; // @todo correct insufficient info passed to caller
-
     prepare();
 
     char line[kMaxLineLength+1];
@@ -2904,7 +3149,7 @@ int assemble(const char* filename)
 
             uppercase(line);
 
-            FTRACE("Assembler read line: %s",
+            FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler read line: %s",
                 __FILE__, __LINE__, line);
             
             // !!! refactor the following assembler to functions
@@ -2913,13 +3158,13 @@ int assemble(const char* filename)
             {
                 tokeno++;
 
-                FTRACE("Assembler got token (#%02x): %s",
+                FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler got token (#%02x): %s",
                     __FILE__, __LINE__, tokeno, token);
 
                 if (token[0] == ';') // comment
                 {
                     skip = true;
-                    FTRACE("Ignoring comment line: %s",
+                    FTRACE_AT(kTraceAssembler, kTraceDebug, "Ignoring comment line: %s",
                         __FILE__, __LINE__, line);
                 }
                 else if (token[0] == '$') // address 
@@ -2967,7 +3212,7 @@ int assemble(const char* filename)
                                 memory[ip++] = HIBYTE(hex);
                             }
 
-                            FTRACE("Assembler stored address: %04x",
+                            FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler stored address: %04x",
                                 __FILE__, __LINE__, hex);
                         }
                     }
@@ -2987,7 +3232,7 @@ int assemble(const char* filename)
                             uint16_t hex = getHex(token+2);
                             memory[ip++] = LOBYTE(hex);
 
-                            FTRACE("Assembler stored value: %02x",
+                            FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler stored value: %02x",
                                 __FILE__, __LINE__, hex);
                         }
                     }
@@ -3020,7 +3265,7 @@ int assemble(const char* filename)
                             {
                                 memory[ip++] = LOBYTE(value);
 
-                                FTRACE("Assembler stored value: %02x (%03d)",
+                                FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler stored value: %02x (%03d)",
                                     __FILE__, __LINE__, value, value);
                             }
                         }
@@ -3028,7 +3273,7 @@ int assemble(const char* filename)
                 }
                 else if (strcmp(token, ".DATA") == 0)
                 {
-                    FTRACE("Assembler processing data section",
+                    FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler processing data section",
                         __FILE__, __LINE__);
 
                     while (strlen(getToken(token,&tokens)))
@@ -3037,27 +3282,28 @@ int assemble(const char* filename)
                         memory[ip++] = LOBYTE(hex);
                         if (hex > 0xff) memory[ip++] = HIBYTE(hex);
 
-                        FTRACE("Assembler stored data section value: %04x",
+                        FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler stored data section value: %04x",
                             __FILE__, __LINE__, hex);
                     }
                 }
                 else if (strncmp(token, line, strlen(token)) == 0)
                 {
                     addLabel(token, ip);
-                    FTRACE("Assembler recording label: %s at %04x",
+                    FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler recording label: %s at %04x",
                         __FILE__, __LINE__, token, ip);
                 }
                 else
                 {
                     short instruction = lookup(token);
 
-                    FTRACE("Assembler looking up token: %s resolves to opcode %02x",
+                    FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler looking up token: %s resolves to opcode %02x",
                         __FILE__, __LINE__, token,instruction);
 
                     if (instruction >= 0)
                     {
-                        FTRACE("Assembler storing instruction: %02x at %04x",
+                        FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler storing instruction: %02x at %04x",
                             __FILE__, __LINE__, instruction,ip);
+                        lines[ip] = lineno;
                         memory[ip++] = (uint8_t)instruction;
                         lastInstruction = instruction;
                     }
@@ -3068,7 +3314,7 @@ int assemble(const char* filename)
                         // branch or jump. 
                         //
 
-                        FTRACE("Assembler adding branch to: %s at %04x",
+                        FTRACE_AT(kTraceAssembler, kTraceDebug, "Assembler adding branch to: %s at %04x",
                             __FILE__, __LINE__, token, ip);
 
                         //
@@ -3079,7 +3325,7 @@ int assemble(const char* filename)
                         //
                         // hack to distinguish between absolute and relative destinations
                         //
-                        ip += (i6502[memory[ip-1]].symbol[0] == 'J') ? 2:1;
+                        ip += (i6502Info[memory[ip-1]].symbol[0] == 'J') ? 2:1;
 
                         //printf("Line %d: unrecognized instruction, ->%s<-", __FILE__, __LINE__, lineno, token);
                         //exit(-3);
@@ -3090,7 +3336,6 @@ int assemble(const char* filename)
         else if (feof(fp) != 0)
         {
             done = 1;
-            if (0 != fclose(fp)) return errno;
         }
         else
         {
@@ -3106,6 +3351,55 @@ int assemble(const char* filename)
     return 0;
 }
 
+/*
+ * Load the assembly program from the named file and attempt to
+ * assemble it.
+ */
+int assemble(const char* filename)
+{
+    assert(filename);
+
+    if (bInitialized == false) return -1;
+
+    FILE* fp = fopen(filename, "r");
+
+    if (fp == NULL) return errno; // @todo correct insufficient info passed to caller
+
+    int nStatus = assembleStream(fp);
+
+    sourceName = filename;
+
+    if (0 != fclose(fp) && nStatus == 0) return errno;
+
+    return nStatus;
+}
+
+/*
+ * Assemble the program held in a null terminated buffer.
+ */
+int assembleBuffer(const char* source)
+{
+    assert(source);
+
+    if (bInitialized == false) return -1;
+
+    if (*source == '\0')
+    {
+        prepare();
+        return 0;
+    }
+
+    FILE* fp = fmemopen((void*)source, strlen(source), "r");
+
+    if (fp == NULL) return errno;
+
+    int nStatus = assembleStream(fp);
+
+    fclose(fp);
+
+    return nStatus;
+}
+
 /*
  * Reset run-time registers and status bits to defaults.
  */
@@ -3127,6 +3421,17 @@ void reset(uint16_t address)
     X = 0;
     Y = 0;
     P = 0;
+
+    retireCycles();
+    CYCLES = 0;
+    RETIRED.base = 0;
+
+    // Opcodes are only counted while profiling, so skip the sum otherwise
+    if (g_bProfile) RETIRED.instructions += countInstructions();
+    memset(OPCOUNTS, 0, sizeof OPCOUNTS);
+
+    if (g_bCallGraph) callgraph_reset(address);
+    if (g_bChromeTrace) chrometrace_reset(address);
 }
 
 /*
@@ -3155,9 +3460,9 @@ void dumpStack()
 {
     fprintf(stderr, "Stack Dump...");
 
-    for (uint8_t i=kStackSize-1; i > SP; i--)
+    for (uint8_t i=0xFF; i > SP; i--)
     {
-        fprintf(stderr, "%02x ", (uint8_t)STACK[i]);
+        fprintf(stderr, "%02x ", (uint8_t)STACK(i));
     }
 
     fprintf(stderr, "\n");
@@ -3174,7 +3479,7 @@ void dumpMemory(uint16_t first, uint16_t last)
 
     for (uint32_t dump=first; dump <= last; dump++)
     {
-        fprintf(stderr, "%02x ", (uint8_t)*(BP+dump));
+        fprintf(stderr, "%02x ", memory[dump]);
 
         if ((dump+1) < last && ((dump+1) % 8) == 0) 
         {
@@ -3199,17 +3504,17 @@ void dump(bool bRegisters, bool bFlags, bool bStack, bool bMemory)
 /*
  * Turn object code into instruction descriptions (disassembly).
  */
-void decodeAt(uint16_t address)
+void decodeAt(uint16_t address, FILE* out)
 {
-    fprintf(stdout, "PC=%04x %s ",
-        address, i6502[*(BP+address)].symbol);
+    fprintf(out, "PC=%04x %s ",
+        address, i6502Info[*(BP+address)].symbol);
 
     for (int i=1; i <= i6502[*(BP+address)].bytes-1; i++)
     {
-        fprintf(stdout, "%02x ", (uint8_t)*(BP+address+i));
+        fprintf(out, "%02x ", (uint8_t)*(BP+address+i));
     }
 
-    fprintf(stdout, "\n");
+    fprintf(out, "\n");
 }
 
 /**
@@ -3220,6 +3525,283 @@ uint8_t inspect(uint16_t address)
     return memory[address];
 }
 
+/**
+ * Set the value of memory at the given address.
+ */
+void poke(uint16_t address, uint8_t value)
+{
+    memory[address] = value;
+    MARK_DIRTY(address);
+}
+
+/**
+ * Copy a block of memory out to the given buffer.
+ */
+void readBlock(uint16_t address, uint8_t* buffer, uint32_t length)
+{
+    assert(buffer);
+    assert(address + length <= (uint32_t)k64K);
+    memcpy(buffer, memory + address, length);
+}
+
+/**
+ * Copy the given buffer into a block of memory.
+ */
+void writeBlock(uint16_t address, const uint8_t* buffer, uint32_t length)
+{
+    assert(buffer);
+    assert(address + length <= (uint32_t)k64K);
+    memcpy(memory + address, buffer, length);
+
+    for (uint32_t page=address/kPageSize; page*kPageSize < address+length; page++)
+    {
+        MARK_DIRTY(page*kPageSize);
+    }
+}
+
+/**
+ * Copy the complete state of the calling thread's machine.
+ */
+void saveState(MACHINE_STATE* state)
+{
+    assert(state);
+
+    memcpy(state, &MACHINE, sizeof MACHINE);
+    markClean();
+}
+
+/**
+ * Replace the complete state of the calling thread's machine.
+ */
+void loadState(const MACHINE_STATE* state)
+{
+    assert(state);
+
+    retireCycles();
+    memcpy(&MACHINE, state, sizeof MACHINE);
+    RETIRED.base = CYCLES;
+    BP = memory;
+    markClean();
+}
+
+/**
+ * Forget which pages have been written.
+ */
+void markClean()
+{
+    memset(DIRTY, 0, sizeof DIRTY);
+}
+
+/**
+ * Count the pages written since memory last matched a known state.
+ */
+unsigned int dirtyPages()
+{
+    unsigned int count = 0;
+
+    for (int i=0; i < kPageCount / 64; i++) count += __builtin_popcountll(DIRTY[i]);
+
+    return count;
+}
+
+/**
+ * Copy back from a baseline image only the pages written since memory
+ * last matched it.
+ */
+unsigned int restoreDirty(const uint8_t* baseline)
+{
+    assert(baseline);
+
+    unsigned int count = 0;
+
+    // Each run of consecutive dirty pages within a mask word is one copy
+    for (int i=0; i < kPageCount / 64; i++)
+    {
+        for (uint64_t bits = DIRTY[i]; bits; )
+        {
+            int first = __builtin_ctzll(bits);
+            uint64_t run = bits >> first;
+            int length = (~run == 0) ? 64 : __builtin_ctzll(~run);
+            uint32_t offset = (i*64 + first) * kPageSize;
+
+            memcpy(memory + offset, baseline + offset, length * kPageSize);
+            count += length;
+
+            bits = (first + length == 64) ? 0 : bits & (~0ULL << (first + length));
+        }
+    }
+
+    markClean();
+
+    return count;
+}
+
+/**
+ * Replace the state of the calling thread's machine with the state its
+ * memory last matched, copying only the pages written since.
+ */
+unsigned int restoreState(const MACHINE_STATE* state)
+{
+    assert(state);
+
+    retireCycles();
+    memcpy(&MACHINE, state, kRegistersSize);
+    RETIRED.base = CYCLES;
+    BP = memory;
+
+    // state->memory, spelled out as memory names the live block here
+    return restoreDirty((const uint8_t*)state + kRegistersSize);
+}
+
+static const char kSnapshotMagic[8]  = {'6', '5', '0', '2', 'S', 'N', 'A', 'P'};
+static const char kIncrementMagic[8] = {'6', '5', '0', '2', 'I', 'N', 'C', 'R'};
+
+/**
+ * Write a snapshot file: the header, then either the whole machine or,
+ * for an increment, the registers, the dirty page mask and the dirty
+ * pages in address order.
+ */
+static int writeSnapshot(const char* filename, bool bIncrement)
+{
+    assert(filename);
+
+    SNAPSHOT_HEADER header;
+
+    memcpy(header.magic, bIncrement ? kIncrementMagic : kSnapshotMagic, sizeof header.magic);
+    header.version = kSnapshotVersion;
+    header.size = sizeof MACHINE;
+
+    FILE* fp = fopen(filename, "wb");
+
+    if (fp == NULL) return errno;
+
+    bool bWritten = (fwrite(&header, sizeof header, 1, fp) == 1);
+
+    if (!bIncrement)
+    {
+        bWritten = bWritten && fwrite(&MACHINE, sizeof MACHINE, 1, fp) == 1;
+    }
+    else
+    {
+        bWritten = bWritten && fwrite(&MACHINE, kRegistersSize, 1, fp) == 1;
+        bWritten = bWritten && fwrite(DIRTY, sizeof DIRTY, 1, fp) == 1;
+
+        for (int page=0; bWritten && page < kPageCount; page++)
+        {
+            if (IS_DIRTY(page)) bWritten = (fwrite(memory + page*kPageSize, kPageSize, 1, fp) == 1);
+        }
+    }
+
+    int nStatus = bWritten ? 0 : (errno ? errno : EIO);
+
+    if (fclose(fp) != 0 && nStatus == 0) nStatus = errno;
+
+    FTRACE("Saved %s %s at PC=%04x with %u dirty pages", __FILE__, __LINE__,
+        bIncrement ? "increment" : "snapshot", filename, PC, dirtyPages());
+
+    if (nStatus == 0) markClean();
+
+    return nStatus;
+}
+
+/**
+ * Write the complete state of the calling thread's machine to a snapshot
+ * file.
+ */
+int saveSnapshot(const char* filename)
+{
+    return writeSnapshot(filename, false);
+}
+
+/**
+ * Write the registers and the pages written since the last snapshot to
+ * an incremental snapshot file.
+ */
+int saveIncrement(const char* filename)
+{
+    return writeSnapshot(filename, true);
+}
+
+/**
+ * Replace the state of the calling thread's machine with the contents of
+ * a snapshot file, or apply an incremental snapshot on top of it.
+ */
+int loadSnapshot(const char* filename)
+{
+    assert(filename);
+
+    FILE* fp = fopen(filename, "rb");
+
+    if (fp == NULL) return errno;
+
+    retireCycles();
+
+    SNAPSHOT_HEADER header;
+    int nStatus = 0;
+    bool bTouched = false;
+
+    memset(&header, 0, sizeof header);
+
+    if (fread(&header, sizeof header, 1, fp) != 1 ||
+        header.version != kSnapshotVersion ||
+        header.size != sizeof MACHINE)
+    {
+        nStatus = EINVAL;
+    }
+    else if (memcmp(header.magic, kSnapshotMagic, sizeof header.magic) == 0)
+    {
+        bTouched = true;
+        nStatus = (fread(&MACHINE, sizeof MACHINE, 1, fp) == 1) ? 0 : EINVAL;
+    }
+    else if (memcmp(header.magic, kIncrementMagic, sizeof header.magic) == 0)
+    {
+        uint64_t mask[kPageCount / 64];
+
+        bTouched = true;
+
+        if (fread(&MACHINE, kRegistersSize, 1, fp) != 1 ||
+            fread(mask, sizeof mask, 1, fp) != 1)
+        {
+            nStatus = EINVAL;
+        }
+
+        for (int page=0; nStatus == 0 && page < kPageCount; page++)
+        {
+            if (((mask[page >> 6] >> (page & 63)) & 1) &&
+                fread(memory + page*kPageSize, kPageSize, 1, fp) != 1)
+            {
+                nStatus = EINVAL;
+            }
+        }
+    }
+    else
+    {
+        nStatus = EINVAL;
+    }
+
+    fclose(fp);
+
+    if (nStatus == 0)
+    {
+        markClean();
+    }
+    else if (bTouched)
+    {
+        // A short read leaves the machine half restored, so start over clean
+        memset(&MACHINE, 0, sizeof MACHINE);
+        MARK_ALL_DIRTY();
+    }
+
+    RETIRED.base = CYCLES;
+    BP = memory;
+
+    FTRACE("Loaded %s %s status %d", __FILE__, __LINE__,
+        memcmp(header.magic, kIncrementMagic, sizeof header.magic) == 0 ? "increment" : "snapshot",
+        filename, nStatus);
+
+    return nStatus;
+}
+
 /**
  * Decode object code to symbolic instructions.
  */
@@ -3231,26 +3813,70 @@ void list(uint16_t first, uint16_t last)
     }
 }
 
+/**
+ * Report calls, returns and breaks to the call-graph profiler and the
+ * Chrome trace export.
+ */
+static void callEvent(uint8_t opcode)
+{
+    if (opcode == JSR)
+    {
+        if (g_bCallGraph) callgraph_call(PC, SP, CYCLES);
+        if (g_bChromeTrace) chrometrace_call(PC, SP, CYCLES);
+    }
+    else if (opcode == RTS || opcode == RTI)
+    {
+        if (g_bCallGraph) callgraph_return(SP, CYCLES);
+        if (g_bChromeTrace) chrometrace_return(opcode == RTI, SP, CYCLES);
+    }
+    else if (opcode == BRK)
+    {
+        if (g_bChromeTrace) chrometrace_break(CYCLES);
+    }
+}
+
 /**
  * Interpret and execute a single instruction.
  */
 int step()
 {
-    FTRACE("PC=%04x OPCODE=%02x (%s) SP=%02x A=%02x X=%02x Y=%02x P=%02x",
-        __FILE__, __LINE__,
-        PC, (int)*(BP+PC), i6502[*(BP+PC)].symbol, 
-        (int)SP, (int)A, (int)X, (int)Y, (int)P);
-    FTRACE("S=%01x V=%01x B=%01x D=%01x I=%01x Z=%01x C=%01x",
-        __FILE__, __LINE__,
-        (int)SIGNBIT, (int)OVERFLOWBIT, (int)BREAKBIT, (int)DECIMALBIT,
-        (int)INTERRUPTBIT, (int)ZEROBIT, (int)CARRYBIT);
- 
-    assert(i6502[*(BP+PC)].pFunc);
-
     uint8_t opcode = *(BP+PC);
+    uint16_t pc = PC;
+
+    bool bTraced = false;
+
+    HEATMAP_STEP(opcode, PC, X, Y, SP, BP);
+
+    if (g_bITrace.load(std::memory_order_relaxed))
+    {
+        ITRACE_RECORD record = {CYCLES, PC, opcode, A, X, Y, SP, P};
+        bTraced = itrace_push(record);
+    }
+
+    if (!bTraced)
+    {
+        FTRACE_AT(kTraceExec, kTraceVerbose, "PC=%04x OPCODE=%02x (%s) SP=%02x A=%02x X=%02x Y=%02x P=%02x",
+            __FILE__, __LINE__,
+            PC, (int)opcode, i6502Info[opcode].symbol, 
+            (int)SP, (int)A, (int)X, (int)Y, (int)P);
+        FTRACE_AT(kTraceExec, kTraceVerbose, "S=%01x V=%01x B=%01x D=%01x I=%01x Z=%01x C=%01x",
+            __FILE__, __LINE__,
+            (int)SIGNBIT, (int)OVERFLOWBIT, (int)BREAKBIT, (int)DECIMALBIT,
+            (int)INTERRUPTBIT, (int)ZEROBIT, (int)CARRYBIT);
+    }
+
+    assert(i6502[opcode].pFunc);
+
+    if (g_bProfile) OPCOUNTS[opcode]++;
+
     i6502[opcode].pFunc();
+    CYCLES += i6502[opcode].cycles;
     ticker_wait(i6502[opcode].cycles);
 
+    if (g_bCoverage) coverage_mark(opcode, pc, PC);
+
+    if (g_bCallGraph || g_bChromeTrace) callEvent(opcode);
+
     return 0;
 }
 
@@ -3263,6 +3889,33 @@ int run(uint16_t address)
    
     reset(address);
 
+    return resume();
+}
+
+/**
+ * Run from the given address until a break or until the cycle limit.
+ */
+int runFor(uint16_t address, uint64_t maxCycles)
+{
+    if (bInitialized == false) return -1;
+
+    reset(address);
+
+    while (BREAKBIT != 1 && CYCLES < maxCycles)
+    {
+        step();
+    }
+
+    return (BREAKBIT == 1) ? 0 : 1;
+}
+
+/**
+ * Continue running from the current program counter without a reset.
+ */
+int resume()
+{
+    if (bInitialized == false) return -1;
+
     for(;BREAKBIT != 1;)
     {
         step();
@@ -3271,6 +3924,24 @@ int run(uint16_t address)
     return 0;
 }
 
+/**
+ * Run from the given address until the program counter reaches the
+ * stop address or a break occurs.
+ */
+int runTo(uint16_t address, uint16_t stop)
+{
+    if (bInitialized == false) return -1;
+
+    reset(address);
+
+    while (BREAKBIT != 1 && PC != stop)
+    {
+        step();
+    }
+
+    return (PC == stop) ? 0 : -1;
+}
+
 /**
  * Tokenize assembler input.
  */
@@ -3294,7 +3965,7 @@ void tokenize(char* first, char* second, char* third, const char* input)
 
     while (strlen(getToken(token, &parsed)))
     {
-        FTRACE("Tokenize got token (#%d): %s", __FILE__, __LINE__, tokeno, token);
+        FTRACE_AT(kTraceDebugger, kTraceDebug, "Tokenize got token (#%d): %s", __FILE__, __LINE__, tokeno, token);
 
         switch(tokeno++)
         {
@@ -3425,11 +4096,11 @@ int debug(uint16_t address)
                 char param1[kMaxLineLength+1];
                 char param2[kMaxLineLength+1];
 
-                FTRACE("Debugger read line: %s", __FILE__ , __LINE__, line);
+                FTRACE_AT(kTraceDebugger, kTraceInfo, "Debugger read line: %s", __FILE__ , __LINE__, line);
                 
                 tokenize(command, param1, param2, line);
 
-                FTRACE("Debugger command and params are: CMD=%s, PARAM1=%s, PARAM2=%s",
+                FTRACE_AT(kTraceDebugger, kTraceInfo, "Debugger command and params are: CMD=%s, PARAM1=%s, PARAM2=%s",
                     __FILE__, __LINE__, command,param1,param2);
 
                 switch (getCommand(command))
@@ -3477,7 +4148,7 @@ int debug(uint16_t address)
                     }
                     break;
                 case kTrace:
-                    g_bTrace = !g_bTrace;
+                    FTRACE_TOGGLE();
                     break;
                 case kList:
                     {
@@ -3519,6 +4190,30 @@ void printVersion()
     fprintf(stderr, "%s (Build Time: %s)\n", kVersion, __TIMESTAMP__);
 }
 
+/**
+ * Look up the instruction table entry for an opcode.
+ */
+bool opcodeInfo(uint8_t opcode, const char** symbol, const char** desc,
+                uint8_t* bytes, uint8_t* cycles)
+{
+    const INST_EXEC& inst = i6502[opcode];
+
+    if (symbol) *symbol = i6502Info[opcode].symbol;
+    if (desc) *desc = i6502Info[opcode].desc;
+    if (bytes) *bytes = inst.bytes;
+    if (cycles) *cycles = inst.cycles;
+
+    return inst.pFunc != 0;
+}
+
+/**
+ * Copy the per-opcode execution counts.
+ */
+void opcodeCounts(uint64_t* counts)
+{
+    memcpy(counts, OPCOUNTS, sizeof OPCOUNTS);
+}
+
 /*
  * Print the instruction table to stderr.
  */
@@ -3526,7 +4221,7 @@ void printInstructions()
 {
     for (unsigned int ii=0; ii < kInstrSetTableSize; ii++)
     {
-        if (i6502[ii].symbol) fprintf(stderr, "%s - %s\n", i6502[ii].symbol, i6502[ii].desc);
+        if (i6502Info[ii].symbol) fprintf(stderr, "%s - %s\n", i6502Info[ii].symbol, i6502Info[ii].desc);
     }
 }
 
@@ -69,6 +69,8 @@
  * @todo would like to see the instruction set/assembler docs generated by doxy
  */
 
+#include <stdio.h>
+
 #include "platform.h"
 
 /**
@@ -76,11 +78,51 @@
  */
 static const int k64K = 0x10000;
 
+/**
+ * Complete machine state: registers, flags, cycle counter and memory. The
+ * program stack lives in page $01 of memory as on real hardware. Laid out
+ * without padding so a state can be hashed, compared or copied as raw
+ * bytes; the emulator keeps its live state in exactly this layout.
+ */
+typedef struct
+{
+    uint64_t cycles;          // Cycles elapsed since reset
+    uint16_t pc;              // Program counter
+    uint8_t a;                // Accumulator
+    uint8_t x;                // Index register X
+    uint8_t y;                // Index register Y
+    uint8_t sp;               // Stack pointer
+    uint8_t p;                // Status register
+    uint8_t flags[7];         // Carry, zero, interrupt, decimal, break, overflow, sign
+    uint8_t reserved[2];      // Always zero
+    uint8_t memory[k64K];     // Address space, stack in page $01
+} MACHINE_STATE;
+
+/**
+ * Snapshot file format version
+ */
+static const uint32_t kSnapshotVersion = 1;
+
+/**
+ * Header of a snapshot file. In a full snapshot ("6502SNAP") the header
+ * is followed by a MACHINE_STATE in host byte order, so a snapshot
+ * restores with a single read. An incremental snapshot ("6502INCR") is
+ * followed by the MACHINE_STATE fields before memory, a 256-bit mask of
+ * the pages written since the previous snapshot and those 256 byte pages
+ * in address order.
+ */
+typedef struct
+{
+    char magic[8];            // "6502SNAP" or "6502INCR"
+    uint32_t version;         // kSnapshotVersion
+    uint32_t size;            // sizeof(MACHINE_STATE)
+} SNAPSHOT_HEADER;
+
 /**
  * Initializes the instruction table and corresponding functions
  * data structures, etc. Call before anything else.
  *
- * @param rateHz CPU clock rate in Hz (default 1000000 = 1 MHz)
+ * @param rateHz CPU clock rate in Hz (default 1000000 = 1 MHz, 0 = unthrottled)
  * @return int 0 on success
  */
 int initialize(unsigned int rateHz = 1000000);
@@ -117,6 +159,25 @@ int save(const char* filename);
  */
 int assemble(const char* filename);
 
+/*
+ * Assemble the program held in a null terminated source buffer.
+ *
+ * @param const char* assembly source text
+ * @return int 0 on success; otherwise, error number
+ */
+int assembleBuffer(const char* source);
+
+/*
+ * Clear memory, assembler labels and breakpoints.
+ */
+void prepare();
+
+/**
+ * Reset registers, flags and the cycle counter, setting the program
+ * counter to the given address. Memory is left untouched.
+ */
+void reset(uint16_t address);
+
 /**
  * Enter the interactive debugger using the object code at given address.
  */
@@ -150,13 +211,105 @@ void dump(bool bRegisters=true, bool bFlags=true, bool bStack=true, bool bMemory
 /*
  * Turn object code into instruction descriptions (disassembly).
  */
-void decodeAt(uint16_t address);
+void decodeAt(uint16_t address, FILE* out=stdout);
 
 /**
  * Return the value of memory at the given address.
  */
 uint8_t inspect(uint16_t address);
 
+/**
+ * Set the value of memory at the given address.
+ */
+void poke(uint16_t address, uint8_t value);
+
+/**
+ * Copy length bytes of memory starting at address into buffer.
+ */
+void readBlock(uint16_t address, uint8_t* buffer, uint32_t length);
+
+/**
+ * Copy length bytes from buffer into memory starting at address.
+ */
+void writeBlock(uint16_t address, const uint8_t* buffer, uint32_t length);
+
+/**
+ * Copy the complete state of the calling thread's machine.
+ */
+void saveState(MACHINE_STATE* state);
+
+/**
+ * Replace the complete state of the calling thread's machine.
+ */
+void loadState(const MACHINE_STATE* state);
+
+//
+// Every store, read-modify-write, stack push and bus write (poke,
+// writeBlock) marks its 256 byte page dirty. The mask is cleared whenever
+// memory matches a known state: by saveState, loadState, restoreState,
+// restoreDirty, markClean and by saving or loading a snapshot file.
+// Assembling or loading a program marks every page dirty.
+//
+
+/**
+ * Mark every page clean, e.g. after copying memory out with readBlock
+ * as a baseline.
+ */
+void markClean();
+
+/**
+ * Count the pages written since memory last matched a known state.
+ */
+unsigned int dirtyPages();
+
+/**
+ * Copy back from a 64K baseline image only the pages written since
+ * memory last matched it, then mark every page clean.
+ *
+ * @param baseline image memory last matched
+ * @return unsigned int number of pages copied
+ */
+unsigned int restoreDirty(const uint8_t* baseline);
+
+/**
+ * Replace the state of the calling thread's machine with a state it
+ * last matched, e.g. the one passed to saveState, copying the registers
+ * and only the pages written since.
+ *
+ * @param state state memory last matched
+ * @return unsigned int number of pages copied
+ */
+unsigned int restoreState(const MACHINE_STATE* state);
+
+/**
+ * Write the complete state of the calling thread's machine to a snapshot
+ * file.
+ *
+ * @param filename name of snapshot file
+ * @return int 0 on success; otherwise, error number
+ */
+int saveSnapshot(const char* filename);
+
+/**
+ * Write the registers of the calling thread's machine and the pages
+ * written since the last snapshot was saved or loaded to an incremental
+ * snapshot file, which loadSnapshot applies on top of that snapshot.
+ *
+ * @param filename name of snapshot file
+ * @return int 0 on success; otherwise, error number
+ */
+int saveIncrement(const char* filename);
+
+/**
+ * Replace the complete state of the calling thread's machine with the
+ * contents of a snapshot file, or apply an incremental snapshot to it.
+ *
+ * @param filename name of snapshot file
+ * @return int 0 on success; EINVAL for a file that is not a snapshot;
+ *             otherwise, error number
+ */
+int loadSnapshot(const char* filename);
+
 /**
  * Decode object code to symbolic instructions.
  */
@@ -167,11 +320,39 @@ void list(uint16_t first, uint16_t last);
  */
 int step();
 
+/**
+ * Executes one instruction on the calling thread's machine, as step()
+ * does. Lets an alternative execution engine stand in for step().
+ */
+typedef int (*STEP_FUNCTION)();
+
 /**
  * Run the object code found at the given address.
  */
 int run(uint16_t address);
 
+/**
+ * Run from the given address until a break or until maxCycles cycles
+ * have elapsed.
+ *
+ * @return int 0 on break; 1 if the cycle limit was reached; -1 on error
+ */
+int runFor(uint16_t address, uint64_t maxCycles);
+
+/**
+ * Continue running from the current program counter until a break,
+ * without resetting registers.
+ */
+int resume();
+
+/**
+ * Run from the given address until the program counter reaches the
+ * stop address.
+ *
+ * @return int 0 if the stop address was reached; -1 on break or error
+ */
+int runTo(uint16_t address, uint16_t stop);
+
 /**
  * Set a breakpoint at the specified address.
  */
@@ -202,6 +383,48 @@ void printVersion();
  */
 void printInstructions();
 
+/**
+ * Look up the instruction table entry for an opcode. Any of the output
+ * pointers may be 0.
+ *
+ * @return bool true if the opcode is implemented; otherwise, false
+ */
+bool opcodeInfo(uint8_t opcode, const char** symbol, const char** desc,
+                uint8_t* bytes, uint8_t* cycles);
+
+/**
+ * Copy the calling thread's per-opcode execution counts since the last
+ * reset. Opcodes are only counted while g_bProfile (see profile.h) is set;
+ * --stats sets it to count instructions.
+ *
+ * @param counts array of 256 counts, indexed by opcode
+ */
+void opcodeCounts(uint64_t* counts);
+
+/**
+ * Look up an assembler label for an address. If several labels share the
+ * address the first in sort order is returned.
+ *
+ * @param address address to look up
+ * @return const char* label, or 0 if the address has none
+ */
+const char* labelAt(uint16_t address);
+
+/**
+ * Look up the source line the assembler emitted the instruction at an
+ * address from.
+ *
+ * @param address address of an instruction's opcode
+ * @return unsigned int line number starting at 1, or 0 if none
+ */
+unsigned int lineAt(uint16_t address);
+
+/**
+ * Return the name of the last assembled source file, or "" if the
+ * program was assembled from a buffer or loaded as object code.
+ */
+const char* sourceFile();
+
 /*
  * Assert value at given address.
  *
@@ -276,6 +499,22 @@ uint8_t sp(); /// Stack pointer
  */
 uint8_t p();  /// Status register
 
+/**
+ * Return the number of CPU cycles elapsed since the last reset.
+ */
+uint64_t cycles();
+
+/**
+ * Return the instructions and cycles executed by every machine in the
+ * process: the calling thread's and those of threads that have exited,
+ * across resets and state loads. Instructions are only counted while
+ * g_bProfile (see profile.h) is set.
+ *
+ * @param instructions filled in with the instructions executed
+ * @param cycles filled in with the cycles executed
+ */
+void executedTotals(uint64_t* instructions, uint64_t* cycles);
+
 #endif
 
 
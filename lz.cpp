@@ -0,0 +1,219 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the LZ77 block compressor.
+ *
+ */
+
+#include <assert.h>
+#include <string.h>
+
+#include "lz.h"
+
+/**
+ * Shortest match worth encoding
+ */
+static const int kMinMatch = 4;
+
+/**
+ * Farthest match offset (two byte offsets)
+ */
+static const int kMaxOffset = 0xffff;
+
+/**
+ * Match finder hash table size (a power of two)
+ */
+static const int kHashBits = 12;
+
+static uint32_t read32(const uint8_t* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof value);
+    return value;
+}
+
+static uint32_t hash(uint32_t value)
+{
+    return (value * 2654435761u) >> (32 - kHashBits);
+}
+
+/**
+ * Write a length continuation: 255 bytes until the remainder fits.
+ */
+static int putLength(uint8_t* out, int op, int capacity, int length)
+{
+    while (length >= 255)
+    {
+        if (op >= capacity) return -1;
+        out[op++] = 255;
+        length -= 255;
+    }
+
+    if (op >= capacity) return -1;
+    out[op++] = (uint8_t)length;
+
+    return op;
+}
+
+/**
+ * Write one sequence. A match length of zero writes a final,
+ * literal-only sequence.
+ */
+static int putSequence(uint8_t* out, int op, int capacity,
+                       const uint8_t* literals, int literalLength,
+                       int offset, int matchLength)
+{
+    int matchCode = matchLength ? matchLength - kMinMatch : 0;
+
+    if (op >= capacity) return -1;
+    out[op++] = (uint8_t)(((literalLength < 15 ? literalLength : 15) << 4) |
+                          (matchCode < 15 ? matchCode : 15));
+
+    if (literalLength >= 15 && (op = putLength(out, op, capacity, literalLength - 15)) < 0) return -1;
+
+    if (op + literalLength > capacity) return -1;
+    memcpy(out + op, literals, literalLength);
+    op += literalLength;
+
+    if (matchLength == 0) return op;
+
+    if (op + 2 > capacity) return -1;
+    out[op++] = (uint8_t)offset;
+    out[op++] = (uint8_t)(offset >> 8);
+
+    if (matchCode >= 15 && (op = putLength(out, op, capacity, matchCode - 15)) < 0) return -1;
+
+    return op;
+}
+
+/**
+ * Compress a block.
+ */
+int lz_compress(const uint8_t* in, int length, uint8_t* out, int capacity)
+{
+    assert(in && out);
+
+    int table[1 << kHashBits];
+    int ip = 0;
+    int anchor = 0;
+    int op = 0;
+
+    for (int i=0; i < (1 << kHashBits); i++) table[i] = -1;
+
+    while (ip + kMinMatch <= length)
+    {
+        uint32_t h = hash(read32(in + ip));
+        int ref = table[h];
+        table[h] = ip;
+
+        if (ref < 0 || ip - ref > kMaxOffset || read32(in + ref) != read32(in + ip))
+        {
+            ip++;
+            continue;
+        }
+
+        int matchLength = kMinMatch;
+        while (ip + matchLength < length && in[ref + matchLength] == in[ip + matchLength]) matchLength++;
+
+        op = putSequence(out, op, capacity, in + anchor, ip - anchor, ip - ref, matchLength);
+        if (op < 0) return -1;
+
+        ip += matchLength;
+        anchor = ip;
+    }
+
+    return putSequence(out, op, capacity, in + anchor, length - anchor, 0, 0);
+}
+
+/**
+ * Read a length continuation, returning -1 if it runs off the input.
+ */
+static int getLength(const uint8_t* in, int* ip, int length)
+{
+    int total = 0;
+    uint8_t byte;
+
+    do
+    {
+        if (*ip >= length) return -1;
+        byte = in[(*ip)++];
+        total += byte;
+    } while (byte == 255);
+
+    return total;
+}
+
+/**
+ * Decompress a block.
+ */
+int lz_decompress(const uint8_t* in, int length, uint8_t* out, int capacity)
+{
+    assert(in && out);
+
+    int ip = 0;
+    int op = 0;
+
+    while (ip < length)
+    {
+        uint8_t token = in[ip++];
+        int literalLength = token >> 4;
+
+        if (literalLength == 15)
+        {
+            int extra = getLength(in, &ip, length);
+            if (extra < 0) return -1;
+            literalLength += extra;
+        }
+
+        if (ip + literalLength > length || op + literalLength > capacity) return -1;
+        memcpy(out + op, in + ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        if (ip == length) break;
+
+        if (ip + 2 > length) return -1;
+        int offset = in[ip] | (in[ip+1] << 8);
+        ip += 2;
+
+        int matchLength = (token & 0xf) + kMinMatch;
+
+        if ((token & 0xf) == 15)
+        {
+            int extra = getLength(in, &ip, length);
+            if (extra < 0) return -1;
+            matchLength += extra;
+        }
+
+        if (offset == 0 || offset > op || op + matchLength > capacity) return -1;
+
+        //
+        // Byte by byte, since a match may overlap its own output.
+        //
+        for (int i=0; i < matchLength; i++, op++) out[op] = out[op - offset];
+    }
+
+    return op;
+}
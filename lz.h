@@ -0,0 +1,62 @@
+#ifndef _LZ_H_
+#define _LZ_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Small LZ77 block compressor in the style of LZ4, used for trace
+ *   files. Each block is compressed independently. A block is a series
+ *   of sequences, each a token byte (literal length in the high nibble,
+ *   match length less four in the low nibble, 15 meaning more length
+ *   bytes follow), the literals, a two byte little-endian match offset
+ *   and any extra match length bytes. The last sequence has literals only.
+ *
+ */
+
+#include "platform.h"
+
+/**
+ * Compress a block.
+ *
+ * @param in data to compress
+ * @param length length of the data
+ * @param out buffer for the compressed block
+ * @param capacity size of the output buffer
+ * @return int compressed length, or -1 if it does not fit in capacity
+ */
+int lz_compress(const uint8_t* in, int length, uint8_t* out, int capacity);
+
+/**
+ * Decompress a block.
+ *
+ * @param in compressed block
+ * @param length length of the compressed block
+ * @param out buffer for the decompressed data
+ * @param capacity size of the output buffer
+ * @return int decompressed length, or -1 if the block is malformed or
+ *         does not fit in capacity
+ */
+int lz_decompress(const uint8_t* in, int length, uint8_t* out, int capacity);
+
+#endif
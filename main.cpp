@@ -25,14 +25,32 @@
 
 
 #include <assert.h>
+#include <errno.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>  
 #include <ctype.h>
+#include <string>
+#include <vector>
 
 #include "platform.h"
 #include "l6502.h"
+#include "crosscheck.h"
+#include "forkserver.h"
+#include "fuzz.h"
 #include "ftrace.h"
+#include "itrace.h"
+#include "profile.h"
+#include "callgraph.h"
+#include "sample.h"
+#include "chrometrace.h"
+#include "heatmap.h"
+#include "coverage.h"
+#include "stats.h"
+#include "job.h"
+#include "multicpu.h"
+#include "replay.h"
+#include "server.h"
 #include "util.h"
 
 /**
@@ -47,6 +65,10 @@ int main(int argc, char** argv)
     char* pchSource = 0;
     char* pchLoad = 0;
     char* pchSave = 0;
+    std::vector<char*> loadStates;
+    char* pchSaveState = 0;
+    char* pchSaveIncrement = 0;
+    bool bSnapshotFailed = false;
     uint16_t address = 0x4000;
     uint16_t address2 = 0x0;
     uint8_t value = 0x00;
@@ -61,10 +83,90 @@ int main(int argc, char** argv)
     bool bPrintInsts = false;
     bool bAssert = false;
     bool bHelp = true;
+    CORE_DESCRIPTOR cores[kMaxCores];
+    unsigned int coreCount = 0;
+    uint16_t sharedFirst = 0x0200;
+    uint16_t sharedLast = 0x02ff;
+    unsigned int quantum = 1000;
+    uint64_t maxCycles = 100000000;
+    char* pchCases = 0;
+    uint16_t ready = 0;
+    bool bReady = false;
+    uint64_t caseCycles = 100000000;
+    unsigned int caseTimeout = 10;
+    char* pchSocket = 0;
+    unsigned int workers = 0;
+    bool bJsonLines = false;
+    FUZZ_CONFIG fuzz;
+    bool bFuzz = false;
+    uint64_t replayInterval = 0;
+    unsigned int replayJobs = 0;
+    uint64_t replayCycles = 100000000;
+    bool bCrosscheck = false;
+    unsigned int crosscheckBlock = 1000;
+    uint64_t crosscheckCycles = 100000000;
+    bool bCrosscheckThreads = false;
+    bool bCrosscheckPin = false;
+    bool bTrace = false;
+    bool bTraceDrop = false;
+    char* pchTraceFile = 0;
+    bool bTraceCompress = false;
+    bool bProfile = false;
+    char* pchProfileCsv = 0;
+    char* pchProfileCalls = 0;
+    unsigned int sampleHz = 0;
+    char* pchTraceJson = 0;
+    char* pchHeatmap = 0;
+    char* pchCoverage = 0;
+    bool bStats = false;
+    char* pchStatsJson = 0;
+
+    memset(&fuzz, 0, sizeof fuzz);
+    fuzz.maxCycles = 100000;
     
     // Long options
     static struct option long_options[] = {
         {"rate", required_argument, 0, 0},
+        {"core", required_argument, 0, 0},
+        {"shared", required_argument, 0, 0},
+        {"quantum", required_argument, 0, 0},
+        {"max-cycles", required_argument, 0, 0},
+        {"fork-server", required_argument, 0, 0},
+        {"ready", required_argument, 0, 0},
+        {"case-cycles", required_argument, 0, 0},
+        {"case-timeout", required_argument, 0, 0},
+        {"serve", required_argument, 0, 0},
+        {"workers", required_argument, 0, 0},
+        {"jsonl", no_argument, 0, 0},
+        {"fuzz", required_argument, 0, 0},
+        {"fuzz-region", required_argument, 0, 0},
+        {"fuzz-assert", required_argument, 0, 0},
+        {"fuzz-cycles", required_argument, 0, 0},
+        {"fuzz-jobs", required_argument, 0, 0},
+        {"fuzz-out", required_argument, 0, 0},
+        {"replay", required_argument, 0, 0},
+        {"replay-jobs", required_argument, 0, 0},
+        {"replay-cycles", required_argument, 0, 0},
+        {"crosscheck", no_argument, 0, 0},
+        {"crosscheck-block", required_argument, 0, 0},
+        {"crosscheck-threads", no_argument, 0, 0},
+        {"crosscheck-pin", no_argument, 0, 0},
+        {"crosscheck-cycles", required_argument, 0, 0},
+        {"trace-drop", no_argument, 0, 0},
+        {"trace-file", required_argument, 0, 0},
+        {"trace-compress", no_argument, 0, 0},
+        {"profile-opcodes", no_argument, 0, 0},
+        {"profile-csv", required_argument, 0, 0},
+        {"profile-calls", required_argument, 0, 0},
+        {"sample-hz", required_argument, 0, 0},
+        {"trace-json", required_argument, 0, 0},
+        {"heatmap", required_argument, 0, 0},
+        {"coverage", required_argument, 0, 0},
+        {"stats", no_argument, 0, 0},
+        {"stats-json", required_argument, 0, 0},
+        {"save-state", required_argument, 0, 0},
+        {"load-state", required_argument, 0, 0},
+        {"save-increment", required_argument, 0, 0},
         {0, 0, 0, 0}
     };
     
@@ -78,13 +180,260 @@ int main(int argc, char** argv)
             // Long option
             if (strcmp(long_options[option_index].name, "rate") == 0)
             {
-                clockRate = (unsigned int)atoi(optarg);
-                if (clockRate == 0)
+                char* end = optarg;
+                clockRate = (unsigned int)strtoul(optarg, &end, 10);
+                if (end == optarg || *end != '\0')
                 {
                     fprintf(stderr, "Warning: invalid clock rate specified, using default 1MHz (1000000 Hz)\n");
                     clockRate = 1000000;
                 }
             }
+            else if (strcmp(long_options[option_index].name, "core") == 0)
+            {
+                if (coreCount < kMaxCores)
+                {
+                    char* delim = strrchr(optarg, ':');
+                    if (delim) *delim++ = '\0';
+                    cores[coreCount].source = strdup(optarg);
+                    cores[coreCount].object = 0;
+                    cores[coreCount].address = delim ? (uint16_t)getHex(uppercase(delim)) : 0x4000;
+                    cores[coreCount].cycles = 0;
+                    cores[coreCount].halted = false;
+                    coreCount++;
+                }
+                else
+                {
+                    fprintf(stderr, "Warning: too many cores, ignoring %s\n", optarg);
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "shared") == 0)
+            {
+                char* delim = strchr(optarg, ':');
+                if (delim)
+                {
+                    *delim++ = '\0';
+                    sharedFirst = (uint16_t)getHex(uppercase(optarg));
+                    sharedLast = (uint16_t)getHex(uppercase(delim));
+                }
+                else
+                {
+                    fprintf(stderr, "Warning: shared window parameters malformed\n");
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "quantum") == 0)
+            {
+                quantum = (unsigned int)atoi(optarg);
+                if (quantum == 0)
+                {
+                    fprintf(stderr, "Warning: invalid quantum specified, using default 1000 cycles\n");
+                    quantum = 1000;
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "max-cycles") == 0)
+            {
+                maxCycles = strtoull(optarg, 0, 10);
+                if (maxCycles == 0)
+                {
+                    fprintf(stderr, "Warning: invalid core cycle limit specified, using default 100000000 cycles\n");
+                    maxCycles = 100000000;
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "fork-server") == 0)
+            {
+                pchCases = strdup(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "ready") == 0)
+            {
+                ready = (uint16_t)getHex(uppercase(optarg));
+                bReady = true;
+            }
+            else if (strcmp(long_options[option_index].name, "case-cycles") == 0)
+            {
+                caseCycles = strtoull(optarg, 0, 10);
+                if (caseCycles == 0)
+                {
+                    fprintf(stderr, "Warning: invalid case cycle limit specified, using default 100000000 cycles\n");
+                    caseCycles = 100000000;
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "case-timeout") == 0)
+            {
+                caseTimeout = (unsigned int)atoi(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "serve") == 0)
+            {
+                pchSocket = strdup(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "workers") == 0)
+            {
+                workers = (unsigned int)atoi(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "jsonl") == 0)
+            {
+                bJsonLines = true;
+            }
+            else if (strcmp(long_options[option_index].name, "fuzz") == 0)
+            {
+                fuzz.iterations = strtoull(optarg, 0, 10);
+                bFuzz = true;
+            }
+            else if (strcmp(long_options[option_index].name, "fuzz-region") == 0)
+            {
+                char* delim = strchr(optarg, ':');
+                if (delim && fuzz.regions < kMaxFuzzRegions)
+                {
+                    *delim++ = '\0';
+                    fuzz.first[fuzz.regions] = (uint16_t)getHex(uppercase(optarg));
+                    fuzz.last[fuzz.regions] = (uint16_t)getHex(uppercase(delim));
+                    fuzz.regions++;
+                }
+                else
+                {
+                    fprintf(stderr, "Warning: fuzz region parameters malformed or too many regions\n");
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "fuzz-assert") == 0)
+            {
+                fuzz.assertAddress = (uint16_t)getHex(uppercase(optarg));
+                fuzz.bAssert = true;
+            }
+            else if (strcmp(long_options[option_index].name, "fuzz-cycles") == 0)
+            {
+                fuzz.maxCycles = strtoull(optarg, 0, 10);
+                if (fuzz.maxCycles == 0)
+                {
+                    fprintf(stderr, "Warning: invalid fuzz cycle limit specified, using default 100000 cycles\n");
+                    fuzz.maxCycles = 100000;
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "fuzz-jobs") == 0)
+            {
+                fuzz.jobs = (unsigned int)atoi(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "fuzz-out") == 0)
+            {
+                fuzz.outDir = strdup(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "replay") == 0)
+            {
+                replayInterval = strtoull(optarg, 0, 10);
+                if (replayInterval == 0)
+                {
+                    fprintf(stderr, "Warning: invalid replay interval specified, using default 1000000 cycles\n");
+                    replayInterval = 1000000;
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "replay-cycles") == 0)
+            {
+                replayCycles = strtoull(optarg, 0, 10);
+                if (replayCycles == 0)
+                {
+                    fprintf(stderr, "Warning: invalid replay cycle limit specified, using default 100000000 cycles\n");
+                    replayCycles = 100000000;
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "replay-jobs") == 0)
+            {
+                replayJobs = (unsigned int)atoi(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "crosscheck") == 0)
+            {
+                bCrosscheck = true;
+            }
+            else if (strcmp(long_options[option_index].name, "crosscheck-block") == 0)
+            {
+                crosscheckBlock = (unsigned int)atoi(optarg);
+                if (crosscheckBlock == 0)
+                {
+                    fprintf(stderr, "Warning: invalid crosscheck block specified, using default 1000 instructions\n");
+                    crosscheckBlock = 1000;
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "crosscheck-threads") == 0)
+            {
+                bCrosscheckThreads = true;
+            }
+            else if (strcmp(long_options[option_index].name, "crosscheck-pin") == 0)
+            {
+                bCrosscheckThreads = true;
+                bCrosscheckPin = true;
+            }
+            else if (strcmp(long_options[option_index].name, "crosscheck-cycles") == 0)
+            {
+                crosscheckCycles = strtoull(optarg, 0, 10);
+                if (crosscheckCycles == 0)
+                {
+                    fprintf(stderr, "Warning: invalid crosscheck cycle limit specified, using default 100000000 cycles\n");
+                    crosscheckCycles = 100000000;
+                }
+            }
+            else if (strcmp(long_options[option_index].name, "trace-drop") == 0)
+            {
+                bTraceDrop = true;
+            }
+            else if (strcmp(long_options[option_index].name, "trace-file") == 0)
+            {
+                pchTraceFile = strdup(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "trace-compress") == 0)
+            {
+                bTraceCompress = true;
+            }
+            else if (strcmp(long_options[option_index].name, "profile-opcodes") == 0)
+            {
+                bProfile = true;
+            }
+            else if (strcmp(long_options[option_index].name, "profile-csv") == 0)
+            {
+                pchProfileCsv = strdup(optarg);
+                bProfile = true;
+            }
+            else if (strcmp(long_options[option_index].name, "profile-calls") == 0)
+            {
+                pchProfileCalls = strdup(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "trace-json") == 0)
+            {
+                pchTraceJson = strdup(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "heatmap") == 0)
+            {
+                pchHeatmap = strdup(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "coverage") == 0)
+            {
+                pchCoverage = strdup(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "stats") == 0)
+            {
+                bStats = true;
+            }
+            else if (strcmp(long_options[option_index].name, "stats-json") == 0)
+            {
+                pchStatsJson = strdup(optarg);
+                bStats = true;
+            }
+            else if (strcmp(long_options[option_index].name, "save-state") == 0)
+            {
+                pchSaveState = strdup(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "load-state") == 0)
+            {
+                loadStates.push_back(strdup(optarg));
+            }
+            else if (strcmp(long_options[option_index].name, "save-increment") == 0)
+            {
+                pchSaveIncrement = strdup(optarg);
+            }
+            else if (strcmp(long_options[option_index].name, "sample-hz") == 0)
+            {
+                sampleHz = (unsigned int)atoi(optarg);
+                if (sampleHz == 0)
+                {
+                    fprintf(stderr, "Error: sample rate must be positive\n");
+                    exit(1);
+                }
+            }
             break;
         case 'r':
             address = (uint16_t)getHex(uppercase(optarg)); 
@@ -101,6 +450,7 @@ int main(int argc, char** argv)
             break;
         case 't':
             FTRACE_ON();
+            bTrace = true;
             break;
         case 'p':
             //
@@ -159,12 +509,69 @@ int main(int argc, char** argv)
         goto usage;
     }
 
+    if (bFuzz || replayInterval || bCrosscheck || pchCases || pchSocket || bJsonLines)
+    {
+        clockRate = 0; // fuzzing, replay, crosscheck and test case modes always run unthrottled
+    }
+
     if ((nStatus = initialize(clockRate)) != 0) 
     {
         fprintf(stderr, "Error: initialization failed with error %d\n", nStatus);
         exit(nStatus);
     }
 
+    g_bProfile = bProfile;
+    g_bCallGraph = (pchProfileCalls != 0);
+
+    if ((bTrace || pchTraceFile) && pchCases)
+    {
+        // Forked children have no trace consumer thread, so their records
+        // would be lost and a child would stall once the ring fills
+        fprintf(stderr, "Error: -t and --trace-file cannot be used with --fork-server\n");
+        exit(EINVAL);
+    }
+
+    if (pchTraceFile)
+    {
+        nStatus = itrace_start_file(pchTraceFile, bTraceCompress, bTraceDrop);
+    }
+    else if (bTrace)
+    {
+        nStatus = itrace_start(ftrace_stream(), bTraceDrop);
+    }
+
+    if (nStatus != 0)
+    {
+        fprintf(stderr, "Error: cannot start instruction trace: %s\n", strerror(nStatus));
+        exit(nStatus);
+    }
+
+    if (pchHeatmap && (nStatus = heatmap_start()) != 0)
+    {
+        fprintf(stderr, "Error: cannot start heatmap: %s%s\n", strerror(nStatus),
+            nStatus == ENOTSUP ? " (release builds compile it out, use TYPE=debug or TYPE=profile)" : "");
+        exit(nStatus);
+    }
+
+    if (pchCoverage)
+    {
+        coverage_start();
+    }
+
+    if (pchTraceJson && (coreCount || bFuzz || replayInterval || bCrosscheck || pchCases || pchSocket))
+    {
+        // The exporter writes one timeline from one machine; these modes
+        // run machines on other threads or in forked children
+        fprintf(stderr, "Error: --trace-json traces run, debug and --jsonl only\n");
+        exit(EINVAL);
+    }
+
+    if (pchTraceJson && (nStatus = chrometrace_start(pchTraceJson)) != 0)
+    {
+        fprintf(stderr, "Error: cannot create %s: %s\n", pchTraceJson, strerror(nStatus));
+        exit(nStatus);
+    }
+
     if (bPrintVersion) 
     {
         printVersion();
@@ -175,12 +582,50 @@ int main(int argc, char** argv)
         printInstructions();
     }
 
+    if (pchSocket)
+    {
+        nStatus = server_run(pchSocket, workers);
+        if (nStatus) fprintf(stderr, "Error: server failed: %s\n", strerror(nStatus));
+        itrace_stop();
+        chrometrace_stop();
+        cleanup();
+        ftrace_cleanup();
+        exit(nStatus);
+    }
+
+    if (bJsonLines)
+    {
+        nStatus = job_stream(STDIN_FILENO, STDOUT_FILENO);
+        if (nStatus) fprintf(stderr, "Error: job stream failed: %s\n", strerror(nStatus));
+        itrace_stop();
+        chrometrace_stop();
+        cleanup();
+        ftrace_cleanup();
+        exit(nStatus);
+    }
+
     if (pchSource && pchLoad)
     {
         fprintf(stderr, "Warning: both -a and -l specified, will ignore load flag\n");
     }
 
-    if (pchSource)
+    if (!loadStates.empty() && (pchSource || pchLoad))
+    {
+        fprintf(stderr, "Warning: --load-state specified, will ignore compile and load flags\n");
+    }
+
+    if (!loadStates.empty())
+    {
+        for (size_t i=0; i < loadStates.size() && nStatus == 0; i++)
+        {
+            nStatus = loadSnapshot(loadStates[i]);
+            bSnapshotFailed = (nStatus != 0);
+
+            if (nStatus == EINVAL) fprintf(stderr, "Error: %s is not a machine snapshot\n", loadStates[i]);
+            else if (nStatus != 0) fprintf(stderr, "Error: cannot read snapshot %s: %s\n", loadStates[i], strerror(nStatus));
+        }
+    }
+    else if (pchSource)
     {
         nStatus = assemble(pchSource); // @todo log failed assemble
 
@@ -199,9 +644,66 @@ int main(int argc, char** argv)
         fprintf(stderr, "Warning: both -r and -d specified, will ignore debug flag\n");
     }
 
+    if (coreCount && (bRun || bDebug))
+    {
+        fprintf(stderr, "Warning: --core specified, will ignore run and debug flags\n");
+    }
+
+    if (bStats)
+    {
+        stats_start();
+    }
+
+    if (nStatus == 0 && sampleHz && (nStatus = sample_start(sampleHz)) != 0)
+    {
+        fprintf(stderr, "Error: cannot start sampling profiler: %s\n", strerror(nStatus));
+    }
+
     if (nStatus == 0)
     {
-        if (bRun)
+        if (coreCount)
+        {
+            nStatus = multicpu_run(cores, coreCount, sharedFirst, sharedLast, quantum, maxCycles);
+
+            for (unsigned int core=0; nStatus == ETIMEDOUT && core < coreCount; core++)
+            {
+                if (!cores[core].halted)
+                {
+                    fprintf(stderr, "Error: core %u (%s) did not reach BRK within %llu cycles\n",
+                        core, cores[core].source, (unsigned long long)maxCycles);
+                }
+            }
+        }
+        else if (bFuzz)
+        {
+            fuzz.address = address;
+            nStatus = fuzz_run(&fuzz);
+        }
+        else if (bCrosscheck)
+        {
+            nStatus = crosscheck_run(address, step, step, crosscheckBlock,
+                bCrosscheckThreads, bCrosscheckPin, crosscheckCycles);
+        }
+        else if (replayInterval)
+        {
+            nStatus = replay_verify(address, replayInterval, replayCycles, replayJobs, step);
+        }
+        else if (pchCases)
+        {
+            FILE* fp = (strcmp(pchCases, "-") == 0) ? stdin : fopen(pchCases, "r");
+
+            if (fp)
+            {
+                nStatus = forkserver_run(fp, address, bReady, ready, caseCycles, caseTimeout);
+                if (fp != stdin) fclose(fp);
+            }
+            else
+            {
+                perror("Error: cannot open test cases");
+                nStatus = errno;
+            }
+        }
+        else if (bRun)
         {
             nStatus = run(address); // @todo log failed run
         }
@@ -209,9 +711,81 @@ int main(int argc, char** argv)
         {
             nStatus = debug(address); // @todo log failed debug
         }
+        else if (!loadStates.empty())
+        {
+            nStatus = resume();
+        }
+    }
+
+    // The increment goes first, as saving a snapshot starts a new one
+    if (nStatus == 0 && pchSaveIncrement && (nStatus = saveIncrement(pchSaveIncrement)) != 0)
+    {
+        fprintf(stderr, "Error: cannot write snapshot %s: %s\n", pchSaveIncrement, strerror(nStatus));
+        bSnapshotFailed = true;
+    }
+
+    if (nStatus == 0 && pchSaveState && (nStatus = saveSnapshot(pchSaveState)) != 0)
+    {
+        fprintf(stderr, "Error: cannot write snapshot %s: %s\n", pchSaveState, strerror(nStatus));
+        bSnapshotFailed = true;
     }
 
-    if (nStatus) perror("Error"); // @todo this is kinda stupid and should use custom error strings
+    if (nStatus && !pchCases && !bFuzz && !replayInterval && !bCrosscheck && !bSnapshotFailed &&
+        !(coreCount && nStatus == ETIMEDOUT)) perror("Error"); // @todo this is kinda stupid and should use custom error strings
+
+    if (bStats)
+    {
+        RUN_STATS stats;
+
+        stats_stop(&stats, clockRate);
+        stats_report(stderr, &stats);
+
+        int nError = pchStatsJson ? stats_json(pchStatsJson, &stats) : 0;
+        if (nError != 0) fprintf(stderr, "Error: cannot write statistics to %s: %s\n", pchStatsJson, strerror(nError));
+    }
+
+    if (sampleHz)
+    {
+        sample_stop();
+        sample_report(stderr);
+    }
+
+    if (pchCoverage)
+    {
+        int nError = coverage_lcov(pchCoverage);
+
+        if (nError == ENOENT) fprintf(stderr, "Error: no coverage written, the program was not assembled from a source file\n");
+        else if (nError != 0) fprintf(stderr, "Error: cannot write coverage to %s: %s\n", pchCoverage, strerror(nError));
+    }
+
+    if (pchHeatmap)
+    {
+        std::string csv = std::string(pchHeatmap) + ".csv";
+        int nError = heatmap_csv(csv.c_str());
+
+        if (nError == 0) nError = heatmap_ppm(pchHeatmap);
+        if (nError != 0) fprintf(stderr, "Error: cannot write heatmap %s: %s\n", pchHeatmap, strerror(nError));
+    }
+
+    if (bProfile)
+    {
+        profile_report(stderr);
+
+        if (pchProfileCsv && profile_csv(pchProfileCsv) != 0)
+        {
+            fprintf(stderr, "Error: cannot write opcode profile to %s: %s\n", pchProfileCsv, strerror(errno));
+        }
+    }
+
+    if (pchProfileCalls)
+    {
+        callgraph_report(stderr);
+
+        if (callgraph_folded(pchProfileCalls) != 0)
+        {
+            fprintf(stderr, "Error: cannot write call graph to %s: %s\n", pchProfileCalls, strerror(errno));
+        }
+    }
 
     if (bDumpRegisters || bDumpFlags || bDumpStack || bDumpMemory) 
     {
@@ -224,6 +798,8 @@ int main(int argc, char** argv)
         fprintf(stderr, "Assert $%04x:%02x=%02x %s\n", address2, value,inspect(address2), (nStatus==0?"true":"false"));
     }
 
+    itrace_stop();
+    chrometrace_stop();
     cleanup();
     ftrace_cleanup();
 
@@ -241,11 +817,51 @@ usage:
     printf("\t-r <address> to run code from the address (hexadecimal, e.g. A000)\n");
     printf("\t-d <address> to debug code from the address (hexadecimal, e.g. A000)\n");
     printf("\t-a <address>:<value> to assert value matches at the given address\n");
-    printf("\t-t to turn on trace output\n");
+    printf("\t-t to turn on trace output (instructions are formatted on a separate thread)\n");
     printf("\t-i to list assembler instructions\n");
     printf("\t-p[rfsm] to print (dump) registers, flags, stack, and memory on exit\n");
     printf("\t-v to print version information\n");
-    printf("\t--rate <hz> to set CPU clock rate in Hz (default: 1000000)\n");
+    printf("\t--rate <hz> to set CPU clock rate in Hz (default: 1000000, 0 for unthrottled)\n");
+    printf("\t--core <filename>[:<address>] to add a core running the source file (repeatable)\n");
+    printf("\t--shared <first>:<last> to set the address window shared by all cores (default: 0200:02FF)\n");
+    printf("\t--quantum <cycles> to set cycles run by each core between exchanges (default: 1000)\n");
+    printf("\t--max-cycles <n> to stop the cores with an error when one runs this long without BRK (default: 100000000)\n");
+    printf("\t--fork-server <filename> to fork a child per test case read from the file (- for stdin), running unthrottled from the -r address (not with -t or --trace-file)\n");
+    printf("\t--ready <address> to run once to this address before forking test cases\n");
+    printf("\t--case-cycles <n> to set the fork server cycle limit per case (default: 100000000)\n");
+    printf("\t--case-timeout <seconds> to kill a fork server case still running after this long (default: 10, 0 for no limit)\n");
+    printf("\t--serve <path> to serve JSON jobs unthrottled on a Unix domain socket until interrupted\n");
+    printf("\t--workers <n> to set the number of server worker threads (default: one per CPU)\n");
+    printf("\t--fuzz <iterations> to fuzz the program unthrottled from the -r address, exiting 1 if a crash is found\n");
+    printf("\t--fuzz-region <first>:<last> to add a memory region the fuzzer mutates (repeatable)\n");
+    printf("\t--fuzz-assert <address> to treat reaching the address as a fuzzer crash\n");
+    printf("\t--fuzz-cycles <n> to set the fuzzer cycle limit per run (default: 100000)\n");
+    printf("\t--fuzz-jobs <n> to set the number of fuzzing threads (default: one per CPU)\n");
+    printf("\t--fuzz-out <dir> to save corpus and crash inputs to the directory\n");
+    printf("\t--replay <cycles> to run unthrottled from the -r address, checkpointing every <cycles>, and verify the run by parallel replay\n");
+    printf("\t--replay-jobs <n> to set the number of replay threads (default: one per CPU)\n");
+    printf("\t--replay-cycles <n> to set the replay recording cycle limit, ending with an error (default: 100000000)\n");
+    printf("\t--crosscheck to run unthrottled from the -r address on two engines in lockstep, stopping with a diff at the first divergence\n");
+    printf("\t--crosscheck-block <n> to set instructions run between comparisons (default: 1000)\n");
+    printf("\t--crosscheck-threads to run each engine on its own thread\n");
+    printf("\t--crosscheck-pin to run each engine on its own thread pinned to a separate CPU\n");
+    printf("\t--crosscheck-cycles <n> to set the crosscheck cycle limit, ending with an error (default: 100000000)\n");
+    printf("\t--trace-drop to drop instruction trace records when the trace falls behind instead of waiting\n");
+    printf("\t--trace-file <filename> to write the instruction trace to a binary trace file (see 6502-trace)\n");
+    printf("\t--trace-compress to compress binary trace file blocks\n");
+    printf("\t--trace-json <filename> to write subroutine calls as a Chrome trace (chrome://tracing, ui.perfetto.dev), one microsecond per cycle (run, debug and --jsonl only)\n");
+    printf("\t--profile-opcodes to count executions and cycles per opcode and addressing mode, printing a table on exit\n");
+    printf("\t--profile-csv <filename> to also write the opcode profile as CSV\n");
+    printf("\t--profile-calls <filename> to profile cycles per subroutine, printing a report on exit and writing folded stacks for flamegraph.pl\n");
+    printf("\t--coverage <filename> to write line and branch coverage of the assembled source as an lcov tracefile (see genhtml)\n");
+    printf("\t--heatmap <prefix> to count reads, writes and fetches per address, writing <prefix>.csv and <prefix>-{read,write,exec}.ppm (not in release builds)\n");
+    printf("\t--stats to print instructions, cycles, host time, achieved clock rate, throttling time and peak memory on exit\n");
+    printf("\t--stats-json <filename> to also write the statistics as JSON\n");
+    printf("\t--sample-hz <hz> to sample the guest PC at the given rate of host CPU time (run and debug only), printing the hottest instructions on exit\n");
+    printf("\t--save-state <filename> to write a snapshot of registers, flags, cycle count and memory on exit\n");
+    printf("\t--save-increment <filename> to write only the registers and the pages written since the last loaded snapshot on exit\n");
+    printf("\t--load-state <filename> to restore a snapshot instead of compiling or loading, resuming from its PC unless -r or -d is given (repeat to apply increments in order)\n");
+    printf("\t--jsonl to run JSON jobs unthrottled, read one per line from stdin, writing one result line per job to stdout\n");
 
     exit(0);
     return 0;
@@ -0,0 +1,220 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of multi-CPU system emulation.
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "l6502.h"
+#include "multicpu.h"
+#include "ftrace.h"
+
+/**
+ * Reusable barrier for a fixed number of threads.
+ */
+class Barrier
+{
+public:
+    Barrier(unsigned int count) : m_count(count), m_waiting(0), m_generation(0) {}
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        unsigned int generation = m_generation;
+
+        if (++m_waiting == m_count)
+        {
+            m_waiting = 0;
+            m_generation++;
+            m_cond.notify_all();
+        }
+        else
+        {
+            while (generation == m_generation) m_cond.wait(lock);
+        }
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    unsigned int m_count;
+    unsigned int m_waiting;
+    unsigned int m_generation;
+};
+
+/**
+ * State shared by all cores of a running system.
+ */
+typedef struct SYSTEM
+{
+    SYSTEM(unsigned int count) : barrier(count) {}
+
+    CORE_DESCRIPTOR* cores;
+    unsigned int count;
+    uint16_t first;
+    uint32_t length;
+    unsigned int quantum;
+    uint64_t maxCycles;
+    Barrier barrier;
+    bool done;
+    std::vector<uint8_t> shared;                // Window as of the last exchange
+    std::vector<std::vector<uint8_t> > outbox;  // Window as seen by each core
+    std::vector<int> status;
+    std::vector<char> halted;
+} SYSTEM;
+
+/**
+ * Merge each core's view of the shared window, in core order, into the
+ * shared copy. Called by core 0 while all other cores wait.
+ */
+static void exchange(SYSTEM* sys)
+{
+    std::vector<uint8_t> next(sys->shared);
+    bool halted = true;
+    bool failed = false;
+
+    for (unsigned int core=0; core < sys->count; core++)
+    {
+        const std::vector<uint8_t>& view = sys->outbox[core];
+
+        for (uint32_t i=0; i < sys->length; i++)
+        {
+            if (view[i] != sys->shared[i]) next[i] = view[i];
+        }
+
+        if (sys->status[core] != 0) failed = true;
+        if (!sys->halted[core]) halted = false;
+    }
+
+    sys->shared.swap(next);
+    sys->done = halted || failed;
+}
+
+/**
+ * Thread body for a single core.
+ */
+static void runCore(SYSTEM* sys, unsigned int core)
+{
+    CORE_DESCRIPTOR* desc = &sys->cores[core];
+
+    sys->status[core] = desc->source ? assemble(desc->source) : load(desc->object);
+    sys->halted[core] = false;
+
+    reset(desc->address);
+
+    for (;;)
+    {
+        readBlock(sys->first, &sys->outbox[core][0], sys->length);
+
+        sys->barrier.wait();
+        if (core == 0) exchange(sys);
+        sys->barrier.wait();
+
+        writeBlock(sys->first, &sys->shared[0], sys->length);
+
+        if (sys->done) break;
+
+        if (!sys->halted[core])
+        {
+            uint64_t until = cycles() + sys->quantum;
+
+            if (until > sys->maxCycles) until = sys->maxCycles;
+
+            while (brk() != 1 && cycles() < until) step();
+
+            sys->halted[core] = (brk() == 1);
+
+            // A core that never halts would hold every other core at the barrier
+            if (!sys->halted[core] && cycles() >= sys->maxCycles) sys->status[core] = ETIMEDOUT;
+        }
+    }
+
+    desc->cycles = cycles();
+    desc->halted = (brk() == 1);
+}
+
+/**
+ * Run a multi-CPU system.
+ */
+int multicpu_run(CORE_DESCRIPTOR* cores, unsigned int count,
+                 uint16_t sharedFirst, uint16_t sharedLast,
+                 unsigned int quantum, uint64_t maxCycles)
+{
+    assert(cores);
+
+    if (count == 0 || count > kMaxCores) return -1;
+    if (sharedLast < sharedFirst || quantum == 0 || maxCycles == 0) return -1;
+
+    for (unsigned int core=0; core < count; core++)
+    {
+        if ((cores[core].source == 0) == (cores[core].object == 0)) return -1;
+    }
+
+    SYSTEM sys(count);
+
+    sys.cores = cores;
+    sys.count = count;
+    sys.first = sharedFirst;
+    sys.length = (uint32_t)sharedLast - sharedFirst + 1;
+    sys.quantum = quantum;
+    sys.maxCycles = maxCycles;
+    sys.done = false;
+    sys.shared.assign(sys.length, 0);
+    sys.outbox.assign(count, std::vector<uint8_t>(sys.length, 0));
+    sys.status.assign(count, 0);
+    sys.halted.assign(count, 0);
+
+    FTRACE_AT(kTraceBus, kTraceInfo, "Starting %u cores sharing %04x-%04x with quantum %u",
+        __FILE__, __LINE__, count, sharedFirst, sharedLast, quantum);
+
+    std::vector<std::thread> threads;
+
+    for (unsigned int core=0; core < count; core++)
+    {
+        threads.push_back(std::thread(runCore, &sys, core));
+    }
+
+    for (unsigned int core=0; core < count; core++)
+    {
+        threads[core].join();
+    }
+
+    writeBlock(sys.first, &sys.shared[0], sys.length);
+
+    for (unsigned int core=0; core < count; core++)
+    {
+        if (sys.status[core] != 0) return sys.status[core];
+    }
+
+    return 0;
+}
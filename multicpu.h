@@ -0,0 +1,79 @@
+#ifndef _MULTICPU_H_
+#define _MULTICPU_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Multi-CPU system emulation. Each core runs on its own host thread
+ *   with a private 64K address space. A single window of addresses is
+ *   shared between all cores.
+ *
+ *   Cores run independently for a quantum of cycles and then meet at a
+ *   barrier where writes to the shared window are exchanged. Private
+ *   memory is never synchronized. Conflicting writes to the same shared
+ *   byte within a quantum resolve in core order (the highest numbered
+ *   core wins), so a run is deterministic regardless of host scheduling.
+ *
+ */
+
+#include "platform.h"
+
+/**
+ * Maximum number of cores in a system
+ */
+static const unsigned int kMaxCores = 64;
+
+/**
+ * Describes the program run by one core. Exactly one of source or
+ * object names the program to assemble or load.
+ */
+typedef struct
+{
+    const char* source;  // Assembly source file name or 0
+    const char* object;  // Object file name or 0
+    uint16_t address;    // Address execution begins at
+    uint64_t cycles;     // Cycles executed (filled in by multicpu_run)
+    bool halted;         // Reached BRK (filled in by multicpu_run)
+} CORE_DESCRIPTOR;
+
+/**
+ * Run a multi-CPU system until every core executes BRK. A core that
+ * reaches the cycle limit first stops the whole system and is left with
+ * halted false. On return the calling thread's memory holds the final
+ * contents of the shared window.
+ *
+ * @param cores array of core descriptors
+ * @param count number of cores (1 to kMaxCores)
+ * @param sharedFirst first address of the shared window
+ * @param sharedLast last address of the shared window
+ * @param quantum cycles each core runs between exchanges
+ * @param maxCycles per-core cycle limit
+ * @return int 0 on success; ETIMEDOUT if a core reached the cycle limit;
+ *         otherwise, error number
+ */
+int multicpu_run(CORE_DESCRIPTOR* cores, unsigned int count,
+                 uint16_t sharedFirst, uint16_t sharedLast,
+                 unsigned int quantum, uint64_t maxCycles);
+
+#endif
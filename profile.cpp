@@ -0,0 +1,243 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the opcode profiler.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "l6502.h"
+#include "profile.h"
+
+/**
+ * Number of opcodes
+ */
+static const unsigned int kOpcodes = 256;
+
+static const char* kModeNames[kModes] =
+{
+    "implied",
+    "accumulator",
+    "immediate",
+    "zeropage",
+    "zeropage,X",
+    "zeropage,Y",
+    "absolute",
+    "absolute,X",
+    "absolute,Y",
+    "(indirect)",
+    "(indirect,X)",
+    "(indirect),Y",
+    "relative"
+};
+
+/**
+ * Counts for one table row
+ */
+typedef struct
+{
+    unsigned int index;  // Opcode or addressing mode
+    uint64_t count;      // Executions
+    uint64_t cycles;     // Cycles
+} PROFILE_ROW;
+
+bool g_bProfile = false;
+
+/**
+ * Derive the addressing mode from the symbol, which is the mnemonic
+ * followed by a mode suffix (e.g. LDAZX, CMPIY).
+ */
+static ADDRESSING_MODE mode(const char* symbol, uint8_t bytes)
+{
+    const char* suffix = symbol + 3;
+
+    if (strlen(symbol) < 3 || *suffix == '\0')
+    {
+        if (bytes == 3) return kModeAbsolute;  // JMP, JSR, BIT
+        if (bytes == 2) return kModeRelative;  // Branches
+
+        if (strncmp(symbol, "ASL", 3) == 0 || strncmp(symbol, "LSR", 3) == 0 ||
+            strncmp(symbol, "ROL", 3) == 0 || strncmp(symbol, "ROR", 3) == 0)
+        {
+            return kModeAccumulator;
+        }
+
+        return kModeImplied;
+    }
+
+    if (strcmp(suffix, "I") == 0) return (bytes == 3) ? kModeIndirect : kModeImmediate;
+    if (strcmp(suffix, "Z") == 0) return kModeZeroPage;
+    if (strcmp(suffix, "ZX") == 0) return kModeZeroPageX;
+    if (strcmp(suffix, "ZY") == 0) return kModeZeroPageY;
+    if (strcmp(suffix, "A") == 0) return kModeAbsolute;
+    if (strcmp(suffix, "X") == 0) return kModeAbsoluteX;
+    if (strcmp(suffix, "Y") == 0) return kModeAbsoluteY;
+    if (strcmp(suffix, "IX") == 0) return kModeIndexedIndirect;
+    if (strcmp(suffix, "IY") == 0) return kModeIndirectIndexed;
+
+    return kModeImplied;
+}
+
+/**
+ * Return the addressing mode used by an opcode.
+ */
+ADDRESSING_MODE profile_addressing(uint8_t opcode)
+{
+    const char* symbol;
+    uint8_t bytes;
+
+    if (!opcodeInfo(opcode, &symbol, 0, &bytes, 0)) return kModeImplied;
+
+    return mode(symbol, bytes);
+}
+
+/**
+ * Return the name of the addressing mode used by an opcode.
+ */
+const char* profile_mode(uint8_t opcode)
+{
+    const char* symbol;
+    uint8_t bytes;
+
+    if (!opcodeInfo(opcode, &symbol, 0, &bytes, 0)) return "";
+
+    return kModeNames[mode(symbol, bytes)];
+}
+
+static bool byCycles(const PROFILE_ROW& a, const PROFILE_ROW& b)
+{
+    if (a.cycles != b.cycles) return a.cycles > b.cycles;
+    return a.index < b.index;
+}
+
+/**
+ * Print the opcode and addressing mode tables.
+ */
+void profile_report(FILE* out)
+{
+    uint64_t counts[kOpcodes];
+    PROFILE_ROW opcodes[kOpcodes];
+    PROFILE_ROW modes[kModes];
+    unsigned int used = 0;
+    uint64_t totalCount = 0;
+    uint64_t totalCycles = 0;
+
+    opcodeCounts(counts);
+
+    for (unsigned int m=0; m < kModes; m++)
+    {
+        modes[m].index = m;
+        modes[m].count = 0;
+        modes[m].cycles = 0;
+    }
+
+    for (unsigned int op=0; op < kOpcodes; op++)
+    {
+        const char* symbol;
+        uint8_t bytes;
+        uint8_t cycles;
+
+        if (counts[op] == 0 || !opcodeInfo((uint8_t)op, &symbol, 0, &bytes, &cycles)) continue;
+
+        PROFILE_ROW& row = opcodes[used++];
+        row.index = op;
+        row.count = counts[op];
+        row.cycles = counts[op] * cycles;
+
+        PROFILE_ROW& group = modes[mode(symbol, bytes)];
+        group.count += row.count;
+        group.cycles += row.cycles;
+
+        totalCount += row.count;
+        totalCycles += row.cycles;
+    }
+
+    std::sort(opcodes, opcodes + used, byCycles);
+    std::sort(modes, modes + kModes, byCycles);
+
+    double scale = totalCycles ? 100.0 / totalCycles : 0.0;
+
+    fprintf(out, "%-6s %-6s %-13s %14s %14s %7s  %s\n",
+        "opcode", "symbol", "mode", "count", "cycles", "cycles%", "description");
+
+    for (unsigned int ii=0; ii < used; ii++)
+    {
+        const char* symbol;
+        const char* desc;
+
+        opcodeInfo((uint8_t)opcodes[ii].index, &symbol, &desc, 0, 0);
+
+        fprintf(out, "$%02x    %-6s %-13s %14llu %14llu %6.2f%%  %s\n",
+            opcodes[ii].index, symbol, profile_mode((uint8_t)opcodes[ii].index),
+            (unsigned long long)opcodes[ii].count, (unsigned long long)opcodes[ii].cycles,
+            opcodes[ii].cycles * scale, desc);
+    }
+
+    fprintf(out, "\n%-13s %14s %14s %7s\n", "mode", "count", "cycles", "cycles%");
+
+    for (unsigned int m=0; m < kModes && modes[m].count; m++)
+    {
+        fprintf(out, "%-13s %14llu %14llu %6.2f%%\n", kModeNames[modes[m].index],
+            (unsigned long long)modes[m].count, (unsigned long long)modes[m].cycles,
+            modes[m].cycles * scale);
+    }
+
+    fprintf(out, "\n%-13s %14llu %14llu\n", "total",
+        (unsigned long long)totalCount, (unsigned long long)totalCycles);
+}
+
+/**
+ * Write the opcode counts as CSV.
+ */
+int profile_csv(const char* filename)
+{
+    uint64_t counts[kOpcodes];
+    FILE* fp = fopen(filename, "w");
+
+    if (!fp) return errno;
+
+    opcodeCounts(counts);
+
+    fprintf(fp, "opcode,symbol,mode,count,cycles\n");
+
+    for (unsigned int op=0; op < kOpcodes; op++)
+    {
+        const char* symbol;
+        uint8_t cycles;
+
+        if (counts[op] == 0 || !opcodeInfo((uint8_t)op, &symbol, 0, 0, &cycles)) continue;
+
+        fprintf(fp, "%02x,%s,\"%s\",%llu,%llu\n", op, symbol, profile_mode((uint8_t)op),
+            (unsigned long long)counts[op], (unsigned long long)(counts[op] * cycles));
+    }
+
+    if (fclose(fp) != 0) return errno;
+
+    return 0;
+}
@@ -0,0 +1,100 @@
+#ifndef _PROFILE_H_
+#define _PROFILE_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Opcode profiler. While g_bProfile is set step() counts executions of
+ *   each opcode in a flat per-thread array (see opcodeCounts), a single
+ *   increment per instruction. Cycles are derived from the counts and the
+ *   instruction table, since every opcode has a fixed cycle cost. The
+ *   report groups the same counts by addressing mode as well.
+ *
+ */
+
+#include <stdio.h>
+
+#include "platform.h"
+
+/**
+ * Addressing modes, in report order
+ */
+typedef enum
+{
+    kModeImplied,
+    kModeAccumulator,
+    kModeImmediate,
+    kModeZeroPage,
+    kModeZeroPageX,
+    kModeZeroPageY,
+    kModeAbsolute,
+    kModeAbsoluteX,
+    kModeAbsoluteY,
+    kModeIndirect,
+    kModeIndexedIndirect,
+    kModeIndirectIndexed,
+    kModeRelative,
+    kModes
+} ADDRESSING_MODE;
+
+//
+// True while opcodes are being counted
+//
+extern bool g_bProfile;
+
+/**
+ * Return the addressing mode used by an opcode, derived from the
+ * instruction symbol suffix and length.
+ *
+ * @param opcode opcode to look up
+ * @return ADDRESSING_MODE mode, kModeImplied for an unimplemented opcode
+ */
+ADDRESSING_MODE profile_addressing(uint8_t opcode);
+
+/**
+ * Return the name of the addressing mode used by an opcode.
+ *
+ * @param opcode opcode to look up
+ * @return const char* mode name, or "" for an unimplemented opcode
+ */
+const char* profile_mode(uint8_t opcode);
+
+/**
+ * Print the calling thread's opcode and addressing mode tables, sorted
+ * by cycles.
+ *
+ * @param out stream the report is written to
+ */
+void profile_report(FILE* out);
+
+/**
+ * Write the calling thread's opcode counts as CSV, one row per executed
+ * opcode.
+ *
+ * @param filename file to create
+ * @return int 0 on success; otherwise, error number
+ */
+int profile_csv(const char* filename);
+
+#endif
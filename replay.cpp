@@ -0,0 +1,252 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of deterministic replay verification.
+ *
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "l6502.h"
+#include "util.h"
+#include "ftrace.h"
+#include "replay.h"
+
+/**
+ * Most checkpoints a recording may keep, each a full machine state
+ */
+static const size_t kMaxCheckpoints = 4096;
+
+/**
+ * Hash a complete machine state, eight bytes at a time.
+ */
+static uint64_t hashState(const MACHINE_STATE* state)
+{
+    const uint64_t* words = (const uint64_t*)state;
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i=0; i < sizeof(MACHINE_STATE) / sizeof(uint64_t); i++)
+    {
+        hash = (hash ^ words[i]) * 0x100000001b3ull;
+    }
+
+    return hash;
+}
+
+/**
+ * Run one instruction with the given engine on the machine state held in
+ * state, updating it in place.
+ */
+static void stepState(STEP_FUNCTION engine, MACHINE_STATE* state)
+{
+    loadState(state);
+    engine();
+    saveState(state);
+}
+
+/**
+ * Replay thread body: claim segments by index, replay each with the
+ * reference interpreter and record whether its end state matches.
+ */
+static void replaySegments(const std::vector<MACHINE_STATE*>* checkpoints,
+                           const std::vector<uint64_t>* hashes,
+                           std::vector<char>* matched, std::atomic<size_t>* next)
+{
+    MACHINE_STATE* state = new MACHINE_STATE;
+
+    for (size_t i = next->fetch_add(1); i + 1 < checkpoints->size(); i = next->fetch_add(1))
+    {
+        uint64_t end = (*checkpoints)[i+1]->cycles;
+
+        loadState((*checkpoints)[i]);
+
+        while (brk() != 1 && cycles() < end) step();
+
+        saveState(state);
+        (*matched)[i] = (hashState(state) == (*hashes)[i+1]);
+    }
+
+    delete state;
+}
+
+/**
+ * Find the first instruction in a segment at which the engine and the
+ * reference interpreter disagree, returning the cycle count before it.
+ */
+static uint64_t locateDivergence(STEP_FUNCTION engine, const MACHINE_STATE* checkpoint,
+                                 uint64_t end, uint16_t* address)
+{
+    MACHINE_STATE* reference = new MACHINE_STATE;
+    MACHINE_STATE* candidate = new MACHINE_STATE;
+
+    memcpy(reference, checkpoint, sizeof(MACHINE_STATE));
+    memcpy(candidate, checkpoint, sizeof(MACHINE_STATE));
+
+    uint64_t cycle = checkpoint->cycles;
+    *address = checkpoint->pc;
+
+    while (reference->flags[4] != 1 && reference->cycles < end)
+    {
+        cycle = reference->cycles;
+        *address = reference->pc;
+
+        stepState(step, reference);
+        stepState(engine, candidate);
+
+        if (memcmp(reference, candidate, sizeof(MACHINE_STATE)) != 0) break;
+
+        cycle = reference->cycles;
+        *address = reference->pc;
+    }
+
+    delete reference;
+    delete candidate;
+
+    return cycle;
+}
+
+/**
+ * Record a run and verify it by parallel replay.
+ */
+int replay_verify(uint16_t address, uint64_t interval, uint64_t maxCycles,
+                  unsigned int jobs, STEP_FUNCTION engine)
+{
+    assert(engine);
+
+    if (interval == 0 || maxCycles == 0) return -1;
+
+    if (jobs == 0) jobs = std::thread::hardware_concurrency();
+    if (jobs == 0) jobs = 1;
+
+    //
+    // Recording run: checkpoint at reset, every interval cycles and at
+    // the final BRK.
+    //
+    std::vector<MACHINE_STATE*> checkpoints;
+    std::vector<uint64_t> hashes;
+
+    double start = clockSeconds();
+
+    reset(address);
+
+    uint64_t next = interval;
+
+    for (;;)
+    {
+        if (checkpoints.empty() || cycles() >= next || brk() == 1)
+        {
+            MACHINE_STATE* state = new MACHINE_STATE;
+            saveState(state);
+            checkpoints.push_back(state);
+            hashes.push_back(hashState(state));
+            next = cycles() - cycles() % interval + interval;
+        }
+
+        if (brk() == 1) break;
+
+        if (cycles() >= maxCycles || checkpoints.size() >= kMaxCheckpoints)
+        {
+            if (cycles() >= maxCycles)
+            {
+                fprintf(stderr, "Error: replay recording did not reach BRK within %llu cycles\n",
+                    (unsigned long long)maxCycles);
+            }
+            else
+            {
+                fprintf(stderr, "Error: replay recording reached %zu checkpoints at cycle %llu, use a longer interval\n",
+                    kMaxCheckpoints, (unsigned long long)cycles());
+            }
+
+            for (size_t i=0; i < checkpoints.size(); i++) delete checkpoints[i];
+            return -1;
+        }
+
+        engine();
+    }
+
+    double recorded = clockSeconds() - start;
+
+    FTRACE("Recorded %zu checkpoints over %llu cycles", __FILE__, __LINE__,
+        checkpoints.size(), (unsigned long long)cycles());
+
+    //
+    // Parallel replay of every segment with the reference interpreter.
+    //
+    size_t segments = checkpoints.size() - 1;
+    std::vector<char> matched(segments, 0);
+    std::atomic<size_t> index(0);
+    std::vector<std::thread> threads;
+
+    start = clockSeconds();
+
+    for (unsigned int i=0; i < jobs; i++)
+    {
+        threads.push_back(std::thread(replaySegments, &checkpoints, &hashes, &matched, &index));
+    }
+    for (unsigned int i=0; i < jobs; i++)
+    {
+        threads[i].join();
+    }
+
+    double replayed = clockSeconds() - start;
+
+    printf("Replay recorded %llu cycles in %zu segments of %llu cycles in %.3f s, replayed on %u threads in %.3f s\n",
+        (unsigned long long)checkpoints.back()->cycles, segments,
+        (unsigned long long)interval, recorded, jobs, replayed);
+
+    int nStatus = 0;
+
+    for (size_t i=0; i < segments; i++)
+    {
+        if (matched[i]) continue;
+
+        uint16_t pc = 0;
+        uint64_t cycle = locateDivergence(engine, checkpoints[i], checkpoints[i+1]->cycles, &pc);
+
+        printf("Replay diverged in segment %zu (cycles %llu-%llu), first at cycle %llu, PC $%04x\n",
+            i, (unsigned long long)checkpoints[i]->cycles,
+            (unsigned long long)checkpoints[i+1]->cycles,
+            (unsigned long long)cycle, pc);
+
+        nStatus = 1;
+        break;
+    }
+
+    if (nStatus == 0) printf("Replay verified %zu segments\n", segments);
+
+    //
+    // Leave the calling thread's machine in the recorded final state.
+    //
+    loadState(checkpoints.back());
+
+    for (size_t i=0; i < checkpoints.size(); i++) delete checkpoints[i];
+
+    return nStatus;
+}
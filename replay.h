@@ -0,0 +1,62 @@
+#ifndef _REPLAY_H_
+#define _REPLAY_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Deterministic replay verification. A recording run of a program
+ *   saves a full machine checkpoint every interval cycles. The segments
+ *   between consecutive checkpoints are then replayed in parallel, each
+ *   on its own thread starting from its checkpoint, with the reference
+ *   step() interpreter, and the state hash at the end of every segment
+ *   is compared against the recorded checkpoint.
+ *
+ *   A recording that runs past the cycle limit without reaching BRK, or
+ *   that would keep more than 4096 checkpoints, is abandoned with an
+ *   error rather than run or grown without bound.
+ *
+ *   The recording engine is passed in as a step function so an
+ *   alternative core can be checked against the reference interpreter.
+ *   When a segment diverges it is re-run instruction by instruction
+ *   with both engines to find the first divergent cycle.
+ *
+ */
+
+#include "l6502.h"
+
+/**
+ * Record a run of the program in the calling thread's memory from the
+ * given address until BRK, then verify it by parallel replay.
+ *
+ * @param address address execution begins at
+ * @param interval cycles between checkpoints
+ * @param maxCycles cycle limit for the recording run
+ * @param jobs replay threads, 0 for one per CPU
+ * @param engine step function of the recording engine
+ * @return int 0 if every segment matched; 1 on divergence; otherwise, error
+ */
+int replay_verify(uint16_t address, uint64_t interval, uint64_t maxCycles,
+                  unsigned int jobs, STEP_FUNCTION engine);
+
+#endif
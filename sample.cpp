@@ -0,0 +1,247 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the sampling profiler.
+ *
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "l6502.h"
+#include "sample.h"
+
+/**
+ * Sample buffer capacity; about an hour of CPU time at 1000 Hz
+ */
+static const uint32_t kMaxSamples = 1 << 22;
+
+/**
+ * Marks a sample taken on the sampled thread. A sample is the PC
+ * (bits 0-15), stack pointer (bits 16-23) and this flag.
+ */
+static const uint32_t kValid = 1u << 24;
+
+/**
+ * Samples taken at one PC
+ */
+typedef struct
+{
+    uint16_t pc;
+    uint64_t count;
+    uint64_t depth;  // Sum of stack bytes in use
+} SAMPLE_ROW;
+
+static uint32_t* s_samples = 0;
+static std::atomic<uint32_t> s_count(0);
+static struct sigaction s_previous;
+static bool s_bArmed = false;
+static thread_local bool s_bSampled = false;
+
+#ifdef __linux__
+static timer_t s_timer;
+#endif
+
+/**
+ * SIGPROF handler. Only async-signal-safe work: an atomic increment and
+ * a store into the preallocated buffer. The handler runs on the thread
+ * it interrupted, so on the sampled thread pc() and sp() read the
+ * machine as of the interrupted instruction.
+ */
+static void onSample(int)
+{
+    uint32_t index = s_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (index < kMaxSamples)
+    {
+        s_samples[index] = s_bSampled ? (pc() | ((uint32_t)sp() << 16) | kValid) : 0;
+    }
+}
+
+/**
+ * Arm the timer with the given period.
+ */
+static int arm(long usec)
+{
+#ifdef __linux__
+    struct sigevent event;
+    memset(&event, 0, sizeof event);
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event._sigev_un._tid = (pid_t)syscall(SYS_gettid);
+
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &s_timer) != 0) return errno;
+
+    struct itimerspec timer;
+    timer.it_interval.tv_sec = usec / 1000000;
+    timer.it_interval.tv_nsec = (usec % 1000000) * 1000;
+    timer.it_value = timer.it_interval;
+
+    if (timer_settime(s_timer, 0, &timer, 0) != 0)
+    {
+        int error = errno;
+        timer_delete(s_timer);
+        return error;
+    }
+#else
+    struct itimerval timer;
+    timer.it_interval.tv_sec = usec / 1000000;
+    timer.it_interval.tv_usec = usec % 1000000;
+    timer.it_value = timer.it_interval;
+
+    if (setitimer(ITIMER_PROF, &timer, 0) != 0) return errno;
+#endif
+
+    return 0;
+}
+
+/**
+ * Disarm the timer.
+ */
+static void disarm()
+{
+#ifdef __linux__
+    timer_delete(s_timer);
+#else
+    struct itimerval timer;
+    memset(&timer, 0, sizeof timer);
+    setitimer(ITIMER_PROF, &timer, 0);
+#endif
+}
+
+/**
+ * Install the SIGPROF handler and arm the timer.
+ */
+int sample_start(unsigned int hz)
+{
+    if (hz == 0 || hz > 1000000 || s_bArmed) return EINVAL;
+
+    if (!s_samples)
+    {
+        s_samples = new (std::nothrow) uint32_t[kMaxSamples];
+        if (!s_samples) return ENOMEM;
+    }
+
+    s_count.store(0);
+    s_bSampled = true;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof action);
+    action.sa_handler = onSample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    if (sigaction(SIGPROF, &action, &s_previous) != 0) return errno;
+
+    int error = arm(1000000L / hz);
+
+    if (error != 0)
+    {
+        sigaction(SIGPROF, &s_previous, 0);
+        return error;
+    }
+
+    s_bArmed = true;
+
+    return 0;
+}
+
+/**
+ * Disarm the timer and restore the previous handler.
+ */
+void sample_stop()
+{
+    if (!s_bArmed) return;
+
+    disarm();
+    sigaction(SIGPROF, &s_previous, 0);
+
+    s_bSampled = false;
+    s_bArmed = false;
+}
+
+static bool byCount(const SAMPLE_ROW& a, const SAMPLE_ROW& b)
+{
+    if (a.count != b.count) return a.count > b.count;
+    return a.pc < b.pc;
+}
+
+/**
+ * Print sampled PCs sorted by sample count.
+ */
+void sample_report(FILE* out)
+{
+    uint32_t taken = s_count.load();
+    uint32_t kept = std::min(taken, kMaxSamples);
+    uint64_t guest = 0;
+    std::vector<SAMPLE_ROW> rows(65536);
+
+    for (uint32_t pc=0; pc < rows.size(); pc++)
+    {
+        rows[pc].pc = (uint16_t)pc;
+        rows[pc].count = 0;
+        rows[pc].depth = 0;
+    }
+
+    for (uint32_t ii=0; ii < kept; ii++)
+    {
+        uint32_t point = s_samples[ii];
+
+        if (!(point & kValid)) continue;
+
+        SAMPLE_ROW& row = rows[point & 0xffff];
+        row.count++;
+        row.depth += 0xff - ((point >> 16) & 0xff);
+        guest++;
+    }
+
+    std::sort(rows.begin(), rows.end(), byCount);
+
+    fprintf(out, "%u samples, %llu in guest code", taken, (unsigned long long)guest);
+    if (taken > kept) fprintf(out, ", %u dropped (buffer full)", taken - kept);
+    fprintf(out, "\n%10s %7s %6s  %s\n", "samples", "%", "stack", "instruction");
+
+    double scale = guest ? 100.0 / guest : 0.0;
+
+    for (size_t ii=0; ii < rows.size() && rows[ii].count; ii++)
+    {
+        fprintf(out, "%10llu %6.2f%% %6.1f  ", (unsigned long long)rows[ii].count,
+            rows[ii].count * scale, (double)rows[ii].depth / rows[ii].count);
+        decodeAt(rows[ii].pc, out);
+    }
+}
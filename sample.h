@@ -0,0 +1,68 @@
+#ifndef _SAMPLE_H_
+#define _SAMPLE_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Sampling profiler. A host timer delivers SIGPROF at a fixed rate of
+ *   CPU time to the thread running the emulator, and the signal handler
+ *   records the interrupted machine's PC and stack pointer into a
+ *   preallocated buffer. Nothing is added to step(), so a sampled run
+ *   costs only the signals themselves.
+ *
+ *   On Linux the timer is a per-thread CPU-time timer aimed at the
+ *   calling thread. Elsewhere ITIMER_PROF is used, and samples landing
+ *   on other threads are counted but not attributed.
+ *
+ *   The stack pointer stands in for call depth: the report gives the
+ *   average number of stack bytes in use at each sampled PC.
+ *
+ */
+
+#include <stdio.h>
+
+#include "platform.h"
+
+/**
+ * Install the SIGPROF handler and start sampling the calling thread's
+ * machine.
+ *
+ * @param hz samples per second of CPU time
+ * @return int 0 on success; otherwise, error number
+ */
+int sample_start(unsigned int hz);
+
+/**
+ * Stop the timer and restore the previous SIGPROF handler.
+ */
+void sample_stop();
+
+/**
+ * Print sampled PCs sorted by sample count, with disassembly.
+ *
+ * @param out stream the report is written to
+ */
+void sample_report(FILE* out);
+
+#endif
@@ -0,0 +1,263 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of the Unix domain socket job server.
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "l6502.h"
+#include "ftrace.h"
+#include "job.h"
+#include "server.h"
+
+/**
+ * Pending connection backlog for listen()
+ */
+static const int kBacklog = 64;
+
+/**
+ * Set by the signal handler to stop the server.
+ */
+static volatile sig_atomic_t s_bStop = 0;
+
+/**
+ * Connections waiting for a worker, and those being served.
+ */
+static std::mutex s_mutex;
+static std::condition_variable s_cond;
+static std::deque<int> s_pending;
+static std::set<int> s_active;
+static bool s_bDone = false;
+
+static void onSignal(int)
+{
+    s_bStop = 1;
+}
+
+/**
+ * Worker thread body. Touches its machine once so the first job does
+ * not pay for faulting in memory.
+ */
+static void worker()
+{
+    prepare();
+
+    for (;;)
+    {
+        int fd;
+
+        {
+            std::unique_lock<std::mutex> lock(s_mutex);
+            while (s_pending.empty() && !s_bDone) s_cond.wait(lock);
+            if (s_bDone) return;
+            fd = s_pending.front();
+            s_pending.pop_front();
+            s_active.insert(fd);
+        }
+
+        job_stream(fd, fd);
+
+        {
+            std::lock_guard<std::mutex> lock(s_mutex);
+            s_active.erase(fd);
+        }
+
+        close(fd);
+    }
+}
+
+/**
+ * Remove a socket left at addr by a server that is no longer running.
+ *
+ * @return int 0 if nothing is left at the path; EADDRINUSE if the path
+ *         is not a socket or a server still accepts on it
+ */
+static int removeStale(const struct sockaddr_un* addr)
+{
+    struct stat st;
+
+    if (lstat(addr->sun_path, &st) != 0) return (errno == ENOENT) ? 0 : errno;
+    if (!S_ISSOCK(st.st_mode)) return EADDRINUSE;
+
+    int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (probe < 0) return errno;
+
+    bool bLive = connect(probe, (const struct sockaddr*)addr, sizeof *addr) == 0;
+    close(probe);
+
+    if (bLive) return EADDRINUSE;
+
+    return (unlink(addr->sun_path) == 0 || errno == ENOENT) ? 0 : errno;
+}
+
+/**
+ * Serve jobs on the socket at path until SIGINT or SIGTERM.
+ */
+int server_run(const char* path, unsigned int workers)
+{
+    assert(path);
+
+    struct sockaddr_un addr;
+
+    if (strlen(path) >= sizeof addr.sun_path) return ENAMETOOLONG;
+
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    int err = removeStale(&addr);
+
+    if (err) return err;
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (listener < 0) return errno;
+
+    if (bind(listener, (struct sockaddr*)&addr, sizeof addr) != 0 ||
+        listen(listener, kBacklog) != 0)
+    {
+        err = errno;
+        close(listener);
+        return err;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof action);
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, 0);
+    sigaction(SIGTERM, &action, 0);
+    signal(SIGPIPE, SIG_IGN);
+
+    if (workers == 0) workers = std::thread::hardware_concurrency();
+    if (workers == 0) workers = 1;
+
+    FTRACE("Serving on %s with %u workers", __FILE__, __LINE__, path, workers);
+
+    std::vector<std::thread> threads;
+
+    // SIGINT and SIGTERM stay blocked everywhere except inside pselect()
+    // below, so workers never take them and a signal arriving after the
+    // s_bStop test is held until pselect() can return EINTR for it.
+    sigset_t stop;
+    sigset_t previous;
+    sigset_t waiting;
+    sigemptyset(&stop);
+    sigaddset(&stop, SIGINT);
+    sigaddset(&stop, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop, &previous);
+
+    waiting = previous;
+    sigdelset(&waiting, SIGINT);
+    sigdelset(&waiting, SIGTERM);
+
+    // Non-blocking, so a connection dropped between pselect() and
+    // accept() cannot stall the loop
+    fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+
+    for (unsigned int i=0; i < workers; i++)
+    {
+        threads.push_back(std::thread(worker));
+    }
+
+    int nStatus = 0;
+
+    while (!s_bStop)
+    {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listener, &readable);
+
+        if (pselect(listener + 1, &readable, 0, 0, 0, &waiting) < 0)
+        {
+            if (errno == EINTR) continue;
+            nStatus = errno;
+            break;
+        }
+
+        int fd = accept(listener, 0, 0);
+
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+            nStatus = errno;
+            break;
+        }
+
+        // BSD accept() passes O_NONBLOCK on to the connection
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_pending.push_back(fd);
+        s_cond.notify_one();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        s_bDone = true;
+        for (std::set<int>::iterator it=s_active.begin(); it != s_active.end(); it++)
+        {
+            shutdown(*it, SHUT_RDWR);
+        }
+        s_cond.notify_all();
+    }
+
+    for (unsigned int i=0; i < workers; i++)
+    {
+        threads[i].join();
+    }
+
+    while (!s_pending.empty())
+    {
+        close(s_pending.front());
+        s_pending.pop_front();
+    }
+
+    close(listener);
+    unlink(path);
+
+    pthread_sigmask(SIG_SETMASK, &previous, 0);
+
+    return nStatus;
+}
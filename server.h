@@ -0,0 +1,56 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Long-running job server listening on a Unix domain socket. Clients
+ *   send newline terminated JSON job requests (see job.h) and receive
+ *   one newline terminated JSON reply per request, in order.
+ *
+ *   Each connection is served by one thread from a fixed worker pool.
+ *   Every worker owns a preallocated machine, so connections are
+ *   processed concurrently without reinitializing the emulator.
+ *
+ *   Jobs on one connection run one after another, since a job that
+ *   names no program reuses the one loaded by the jobs before it. A
+ *   client wanting jobs run in parallel opens one connection per job it
+ *   keeps in flight.
+ *
+ */
+
+#include "platform.h"
+
+/**
+ * Serve jobs on the socket at path until SIGINT or SIGTERM.
+ *
+ * @param path file system path of the socket, replacing only a stale
+ *        socket that no server accepts on
+ * @param workers number of worker threads, 0 for one per host CPU
+ * @return int 0 on clean shutdown; EADDRINUSE if path is not a socket or
+ *         another server is live on it; otherwise, error number
+ */
+int server_run(const char* path, unsigned int workers);
+
+#endif
@@ -0,0 +1,138 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of host throughput statistics.
+ *
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/resource.h>
+
+#include "l6502.h"
+#include "profile.h"
+#include "stats.h"
+#include "ticker.h"
+#include "util.h"
+
+static double s_wall;
+static double s_cpu;
+static unsigned long long s_waited;
+static uint64_t s_instructions;
+static uint64_t s_cycles;
+
+/**
+ * Record the start of a run.
+ */
+void stats_start()
+{
+    g_bProfile = true;  // Opcode counts give the instruction count
+
+    s_wall = clockSeconds(CLOCK_MONOTONIC);
+    s_cpu = clockSeconds(CLOCK_PROCESS_CPUTIME_ID);
+    s_waited = ticker_waited();
+    executedTotals(&s_instructions, &s_cycles);
+}
+
+/**
+ * Measure the run since stats_start.
+ */
+void stats_stop(RUN_STATS* stats, unsigned int rate)
+{
+    memset(stats, 0, sizeof *stats);
+
+    stats->wall = clockSeconds(CLOCK_MONOTONIC) - s_wall;
+    stats->cpu = clockSeconds(CLOCK_PROCESS_CPUTIME_ID) - s_cpu;
+    stats->waited = (ticker_waited() - s_waited) / 1e9;
+
+    // Totals cover worker threads and resets, and exclude whatever a
+    // restored state had already run
+    executedTotals(&stats->instructions, &stats->cycles);
+    stats->instructions -= s_instructions;
+    stats->cycles -= s_cycles;
+    stats->targetMhz = rate / 1e6;
+
+    if (stats->wall > 0.0) stats->mhz = stats->cycles / stats->wall / 1e6;
+    if (stats->instructions) stats->nsPerInstruction = stats->wall * 1e9 / stats->instructions;
+
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#ifdef __APPLE__
+        stats->peakRss = usage.ru_maxrss;         // bytes
+#else
+        stats->peakRss = usage.ru_maxrss * 1024ULL; // kilobytes
+#endif
+    }
+}
+
+/**
+ * Print statistics as a table.
+ */
+void stats_report(FILE* out, const RUN_STATS* stats)
+{
+    fprintf(out, "instructions      %llu\n", (unsigned long long)stats->instructions);
+    fprintf(out, "cycles            %llu\n", (unsigned long long)stats->cycles);
+    fprintf(out, "wall time         %.6f s\n", stats->wall);
+    fprintf(out, "cpu time          %.6f s\n", stats->cpu);
+    fprintf(out, "ticker wait       %.6f s (%.1f%% of wall)\n", stats->waited,
+        stats->wall > 0.0 ? 100.0 * stats->waited / stats->wall : 0.0);
+
+    if (stats->targetMhz > 0.0)
+    {
+        fprintf(out, "clock rate        %.3f MHz (target %.3f MHz, %.1f%%)\n", stats->mhz,
+            stats->targetMhz, 100.0 * stats->mhz / stats->targetMhz);
+    }
+    else
+    {
+        fprintf(out, "clock rate        %.3f MHz (unthrottled)\n", stats->mhz);
+    }
+
+    fprintf(out, "ns/instruction    %.2f\n", stats->nsPerInstruction);
+    fprintf(out, "peak rss          %.1f MB\n", stats->peakRss / 1048576.0);
+}
+
+/**
+ * Write statistics as a JSON object.
+ */
+int stats_json(const char* filename, const RUN_STATS* stats)
+{
+    FILE* fp = fopen(filename, "w");
+
+    if (!fp) return errno;
+
+    fprintf(fp, "{\"instructions\":%llu,\"cycles\":%llu,\"wall_s\":%.6f,\"cpu_s\":%.6f,"
+        "\"ticker_wait_s\":%.6f,\"mhz\":%.6f,\"target_mhz\":%.6f,"
+        "\"ns_per_instruction\":%.3f,\"peak_rss_bytes\":%llu}\n",
+        (unsigned long long)stats->instructions, (unsigned long long)stats->cycles,
+        stats->wall, stats->cpu, stats->waited, stats->mhz, stats->targetMhz,
+        stats->nsPerInstruction, (unsigned long long)stats->peakRss);
+
+    if (fclose(fp) != 0) return errno;
+
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Host throughput statistics for a run: instructions and cycles
+ *   emulated by every machine in the process (worker threads included
+ *   once they have exited), host wall and CPU time,
+ *   achieved clock rate against the target, time spent throttling in
+ *   ticker_wait, and peak resident set size.
+ *
+ */
+
+#include <stdio.h>
+
+#include "platform.h"
+
+/**
+ * Statistics for one run
+ */
+typedef struct
+{
+    uint64_t instructions;  // Instructions executed
+    uint64_t cycles;        // Emulated cycles
+    double wall;            // Host wall time in seconds
+    double cpu;             // Host CPU time (user + system) in seconds
+    double waited;          // Wall time spent in ticker_wait in seconds
+    double mhz;             // Achieved emulated clock rate
+    double targetMhz;       // Requested clock rate, 0 for unthrottled
+    double nsPerInstruction;
+    uint64_t peakRss;       // Peak resident set size in bytes
+} RUN_STATS;
+
+/**
+ * Record the start of a run. Enables opcode counting (see profile.h),
+ * from which the instruction count is taken.
+ */
+void stats_start();
+
+/**
+ * Measure the run since stats_start.
+ *
+ * @param stats filled in
+ * @param rate target clock rate in Hz, 0 for unthrottled
+ */
+void stats_stop(RUN_STATS* stats, unsigned int rate);
+
+/**
+ * Print statistics as a table.
+ *
+ * @param out stream the report is written to
+ * @param stats statistics to print
+ */
+void stats_report(FILE* out, const RUN_STATS* stats);
+
+/**
+ * Write statistics as a JSON object.
+ *
+ * @param filename file to create
+ * @param stats statistics to write
+ * @return int 0 on success; otherwise, error number
+ */
+int stats_json(const char* filename, const RUN_STATS* stats);
+
+#endif
@@ -0,0 +1,21 @@
+;; Call graph test: a loop calling nested subroutines, with a leaf
+;; reached through two different paths.
+;; run 4000
+;; expect 8000:03
+$4000   LDXI #$00
+loop    JSR outer
+        INX
+        CPXI #$03
+        BNE loop
+        JSR leaf
+        STXA $8000
+        BRK
+outer   JSR leaf
+        JSR middle
+        RTS
+middle  JSR leaf
+        NOP
+        RTS
+leaf    NOP
+        NOP
+        RTS
@@ -0,0 +1,9 @@
+;; Coverage test: a branch that is always taken, so the line it skips
+;; is never executed and the fall-through outcome is never seen.
+;; run 4000
+;; expect 8000:01
+$4000   LDAI #$01
+        BNE skip
+        LDAI #$02
+skip    STAA $8000
+        BRK
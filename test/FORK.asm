@@ -0,0 +1,11 @@
+;; Fork-server test: clear the result, then add the inputs at $10 and $11
+;; and store the sum at $8000. Cases fork from the ready address $4005.
+;; run 4000
+;; expect 8000:00
+$4000   LDAI #$00
+        STAA $8000
+        CLC
+        LDAZ $10
+        ADCZ $11
+        STAA $8000
+        BRK
@@ -0,0 +1,12 @@
+;; Fuzzer test: the input bytes at $10 and $11 guard a path to $4100,
+;; which the fuzzer reports as a crash when run with --fuzz-assert 4100.
+$4000   LDAZ $10
+        CMPI #$42
+        BNE done
+        LDAZ $11
+        CMPI #$17
+        BNE done
+        JMP $4100
+done    BRK
+$4100   NOP
+        BRK
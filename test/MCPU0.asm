@@ -0,0 +1,4 @@
+;; Multi-CPU test, core 0: publish a value in the shared window
+$4000   LDAI #$5A
+        STAA $0200
+        BRK
@@ -0,0 +1,7 @@
+;; Multi-CPU test, core 1: wait for core 0, then answer in the shared window
+$4000   NOP
+wait    LDAA $0200
+        BEQ wait
+        ADCI #$01
+        STAA $0201
+        BRK
@@ -0,0 +1,21 @@
+;; Replay test: nested loops calling a subroutine that pushes, pulls and
+;; stores, so every checkpoint segment touches registers, stack and memory.
+;; run 4000
+;; expect 8000:00 8001:fe
+$4000   LDYI #$00
+outer   LDXI #$00
+inner   JSR bump
+        INX
+        BNE inner
+        INY
+        CPYI #$40
+        BNE outer
+        BRK
+bump    PHA
+        INCA $8000
+        LDAA $8000
+        STAX $3000
+        PLA
+        ADCI #$03
+        STAA $8001
+        RTS
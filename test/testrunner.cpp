@@ -0,0 +1,433 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Native test runner. Discovers every .asm file in the test directory,
+ *   assembles and runs each one in-process on a pool of threads (one
+ *   machine per thread) and checks the expected memory values.
+ *
+ *   Expectations come from the manifest (tests.manifest) or, for sources
+ *   not listed there, from header comment lines of the form
+ *
+ *     ;; run 4000
+ *     ;; expect 8000:80 8001:00
+ *
+ *   Sources with neither are reported as skipped. Results are written as
+ *   TAP (default) or JUnit XML with per-test timings.
+ *
+ *   Usage: 6502test [-d <dir>] [-j <jobs>] [-f tap|junit] [-o <filename>]
+ *
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "l6502.h"
+#include "util.h"
+
+/**
+ * Maximum manifest or header line length
+ */
+static const int kMaxLineLength = 1024;
+
+/**
+ * Cycle limit per test, so a runaway program fails rather than hangs
+ */
+static const uint64_t kMaxCycles = 10000000;
+
+/**
+ * One memory expectation
+ */
+typedef struct
+{
+    uint16_t address;
+    uint8_t value;
+    uint8_t actual;
+} EXPECT;
+
+/**
+ * One discovered test and its result
+ */
+typedef struct
+{
+    std::string name;             // Source file name
+    uint16_t address;             // Address execution begins at
+    std::vector<EXPECT> expects;  // Expected memory values
+    bool bSkip;                   // True if no expectations were found
+    bool bPass;                   // True if every expectation held
+    std::string message;          // Failure reason
+    double seconds;               // Assemble and run time
+} TEST;
+
+/**
+ * Parse whitespace separated <address>:<value> pairs into expects.
+ * Returns false if any pair is malformed.
+ */
+static bool parseExpects(char* str, std::vector<EXPECT>& expects)
+{
+    for (char* tok = strtok(str, " \t\r\n"); tok; tok = strtok(0, " \t\r\n"))
+    {
+        char* delim = strchr(tok, ':');
+        if (delim == NULL) return false;
+        *delim++ = '\0';
+
+        EXPECT expect;
+        expect.address = getHex(uppercase(tok));
+        expect.value = (uint8_t)getHex(uppercase(delim));
+        expect.actual = 0;
+        expects.push_back(expect);
+    }
+
+    return true;
+}
+
+/**
+ * Read the manifest into a map of source name to test description.
+ * A missing manifest is not an error.
+ */
+static void readManifest(const std::string& dir, std::map<std::string, TEST>& manifest)
+{
+    FILE* fp = fopen((dir + "/tests.manifest").c_str(), "r");
+    if (fp == NULL) return;
+
+    char line[kMaxLineLength+1];
+
+    while (fgets(line, sizeof line, fp))
+    {
+        char* name = strtok(line, " \t\r\n");
+        if (name == NULL || *name == '#') continue;
+
+        char* address = strtok(0, " \t\r\n");
+        char* rest = strtok(0, "\r\n");
+        if (address == NULL || rest == NULL) continue;
+
+        TEST test;
+        test.name = name;
+        test.address = getHex(uppercase(address));
+        test.bSkip = !parseExpects(rest, test.expects) || test.expects.empty();
+        manifest[test.name] = test;
+    }
+
+    fclose(fp);
+}
+
+/**
+ * Read run and expect lines from the leading ;; comment block of a source.
+ */
+static void readHeader(const std::string& path, TEST& test)
+{
+    FILE* fp = fopen(path.c_str(), "r");
+    if (fp == NULL) return;
+
+    char line[kMaxLineLength+1];
+
+    while (fgets(line, sizeof line, fp) && strncmp(line, ";;", 2) == 0)
+    {
+        char* key = strtok(line + 2, " \t\r\n");
+
+        if (key && strcmp(key, "run") == 0)
+        {
+            char* address = strtok(0, " \t\r\n");
+            if (address) test.address = getHex(uppercase(address));
+        }
+        else if (key && strcmp(key, "expect") == 0)
+        {
+            char* rest = strtok(0, "\r\n");
+            if (rest) parseExpects(rest, test.expects);
+        }
+    }
+
+    fclose(fp);
+
+    test.bSkip = test.expects.empty();
+}
+
+/**
+ * Assemble and run one test on the calling thread's machine.
+ */
+static void runTest(const std::string& dir, TEST& test)
+{
+    double start = clockSeconds();
+
+    int nStatus = assemble((dir + "/" + test.name).c_str());
+
+    if (nStatus != 0)
+    {
+        test.message = "assembly failed";
+    }
+    else if ((nStatus = runFor(test.address, kMaxCycles)) != 0)
+    {
+        test.message = (nStatus == 1) ? "cycle limit reached" : "run failed";
+    }
+    else
+    {
+        test.bPass = true;
+
+        for (size_t i=0; i < test.expects.size(); i++)
+        {
+            EXPECT& expect = test.expects[i];
+            expect.actual = inspect(expect.address);
+
+            if (expect.actual != expect.value)
+            {
+                char message[64];
+                snprintf(message, sizeof message, "Assert $%04x:%02x=%02x false",
+                    expect.address, expect.value, expect.actual);
+                test.message = message;
+                test.bPass = false;
+                break;
+            }
+        }
+    }
+
+    test.seconds = clockSeconds() - start;
+}
+
+/**
+ * Worker thread body: claim tests by index until none remain.
+ */
+static void worker(const std::string* dir, std::vector<TEST>* tests, std::atomic<size_t>* next)
+{
+    for (size_t i = next->fetch_add(1); i < tests->size(); i = next->fetch_add(1))
+    {
+        if (!(*tests)[i].bSkip) runTest(*dir, (*tests)[i]);
+    }
+}
+
+/**
+ * Write a string with XML special characters escaped.
+ */
+static void xmlEscape(FILE* out, const std::string& str)
+{
+    for (size_t i=0; i < str.size(); i++)
+    {
+        switch (str[i])
+        {
+        case '<': fputs("&lt;", out); break;
+        case '>': fputs("&gt;", out); break;
+        case '&': fputs("&amp;", out); break;
+        case '"': fputs("&quot;", out); break;
+        default: fputc(str[i], out); break;
+        }
+    }
+}
+
+/**
+ * Write results in Test Anything Protocol format.
+ */
+static void reportTap(FILE* out, const std::vector<TEST>& tests, double elapsed)
+{
+    fprintf(out, "TAP version 13\n1..%zu\n", tests.size());
+
+    for (size_t i=0; i < tests.size(); i++)
+    {
+        const TEST& test = tests[i];
+
+        if (test.bSkip)
+        {
+            fprintf(out, "ok %zu - %s # SKIP no expectations\n", i + 1, test.name.c_str());
+            continue;
+        }
+
+        fprintf(out, "%s %zu - %s\n", test.bPass ? "ok" : "not ok", i + 1, test.name.c_str());
+        fprintf(out, "  ---\n  duration_ms: %.3f\n", test.seconds * 1e3);
+        if (!test.bPass) fprintf(out, "  message: '%s'\n", test.message.c_str());
+        fprintf(out, "  ...\n");
+    }
+
+    fprintf(out, "# elapsed %.3f s\n", elapsed);
+}
+
+/**
+ * Write results as a JUnit XML test suite.
+ */
+static void reportJunit(FILE* out, const std::vector<TEST>& tests, double elapsed,
+                        size_t failures, size_t skipped)
+{
+    fprintf(out, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+    fprintf(out, "<testsuite name=\"6502\" tests=\"%zu\" failures=\"%zu\" skipped=\"%zu\" time=\"%.6f\">\n",
+        tests.size(), failures, skipped, elapsed);
+
+    for (size_t i=0; i < tests.size(); i++)
+    {
+        const TEST& test = tests[i];
+
+        fprintf(out, "  <testcase classname=\"6502\" name=\"");
+        xmlEscape(out, test.name);
+        fprintf(out, "\" time=\"%.6f\"", test.seconds);
+
+        if (test.bSkip)
+        {
+            fprintf(out, "><skipped/></testcase>\n");
+        }
+        else if (!test.bPass)
+        {
+            fprintf(out, "><failure message=\"");
+            xmlEscape(out, test.message);
+            fprintf(out, "\"/></testcase>\n");
+        }
+        else
+        {
+            fprintf(out, "/>\n");
+        }
+    }
+
+    fprintf(out, "</testsuite>\n");
+}
+
+int main(int argc, char** argv)
+{
+    std::string dir = ".";
+    unsigned int jobs = 0;
+    bool bJunit = false;
+    const char* pchOutput = 0;
+    int chOption;
+
+    while ((chOption = getopt(argc, argv, "d:j:f:o:h")) != -1)
+    {
+        switch (chOption)
+        {
+        case 'd':
+            dir = optarg;
+            break;
+        case 'j':
+            jobs = (unsigned int)atoi(optarg);
+            break;
+        case 'f':
+            bJunit = (strcmp(optarg, "junit") == 0);
+            break;
+        case 'o':
+            pchOutput = optarg;
+            break;
+        case 'h':
+        default:
+            fprintf(stderr, "Usage: %s [-d <dir>] [-j <jobs>] [-f tap|junit] [-o <filename>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (jobs == 0) jobs = std::thread::hardware_concurrency();
+    if (jobs == 0) jobs = 1;
+
+    //
+    // Discover sources and attach their expectations.
+    //
+    std::map<std::string, TEST> manifest;
+    readManifest(dir, manifest);
+
+    DIR* dp = opendir(dir.c_str());
+    if (dp == NULL)
+    {
+        perror("Error: cannot open test directory");
+        return 1;
+    }
+
+    std::vector<std::string> names;
+    for (struct dirent* entry = readdir(dp); entry; entry = readdir(dp))
+    {
+        size_t length = strlen(entry->d_name);
+        if (length > 4 && strcmp(entry->d_name + length - 4, ".asm") == 0) names.push_back(entry->d_name);
+    }
+    closedir(dp);
+
+    std::sort(names.begin(), names.end());
+
+    std::vector<TEST> tests;
+    for (size_t i=0; i < names.size(); i++)
+    {
+        std::map<std::string, TEST>::iterator it = manifest.find(names[i]);
+
+        TEST test;
+        if (it != manifest.end())
+        {
+            test = it->second;
+        }
+        else
+        {
+            test.name = names[i];
+            test.address = 0x4000;
+            readHeader(dir + "/" + names[i], test);
+        }
+
+        test.bPass = false;
+        test.seconds = 0.0;
+        tests.push_back(test);
+    }
+
+    //
+    // Run the suite, unthrottled, on the thread pool.
+    //
+    initialize(0);
+
+    double start = clockSeconds();
+    std::atomic<size_t> next(0);
+    std::vector<std::thread> threads;
+
+    for (unsigned int i=0; i < jobs; i++)
+    {
+        threads.push_back(std::thread(worker, &dir, &tests, &next));
+    }
+    for (unsigned int i=0; i < jobs; i++)
+    {
+        threads[i].join();
+    }
+
+    double elapsed = clockSeconds() - start;
+
+    cleanup();
+
+    size_t failures = 0;
+    size_t skipped = 0;
+    for (size_t i=0; i < tests.size(); i++)
+    {
+        if (tests[i].bSkip) skipped++;
+        else if (!tests[i].bPass) failures++;
+    }
+
+    FILE* out = pchOutput ? fopen(pchOutput, "w") : stdout;
+    if (out == NULL)
+    {
+        perror("Error: cannot open report");
+        return 1;
+    }
+
+    if (bJunit) reportJunit(out, tests, elapsed, failures, skipped);
+    else reportTap(out, tests, elapsed);
+
+    if (out != stdout) fclose(out);
+
+    fprintf(stderr, "%zu tests, %zu passed, %zu failed, %zu skipped in %.3f s on %u threads\n",
+        tests.size(), tests.size() - failures - skipped, failures, skipped, elapsed, jobs);
+
+    return failures ? 1 : 0;
+}
@@ -31,40 +31,102 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "ticker.h"
 
 const unsigned int kNanoSeconds = 1000000000;
 
+//
+// Sleep only once the emulated clock is this far ahead of the wall clock,
+// so short instructions do not each pay for a system call
+//
+const unsigned long long kSliceNanoSeconds = 100000;
+
+//
+// Restart from the wall clock rather than catch up after falling this far
+// behind (a debugger prompt, a stopped process)
+//
+const long long kMaxLagNanoSeconds = 50000000;
+
 static unsigned int rate = 0;
 
-#include <time.h>
+static thread_local unsigned long long waited = 0;
+
+static thread_local bool started = false;        // Deadline has been anchored
+static thread_local struct timespec deadline;    // Wall time the emulated clock has reached
+static thread_local unsigned long long pending;  // Nanoseconds added since the last check
+static thread_local unsigned long long carry;    // Remainder of cycles * kNanoSeconds / rate
+
+/**
+ * Return a - b in nanoseconds.
+ */
+static long long elapsed(const struct timespec& a, const struct timespec& b)
+{
+    return (a.tv_sec - b.tv_sec) * (long long)kNanoSeconds + a.tv_nsec - b.tv_nsec;
+}
 
 int ticker_init(unsigned int rateHz)
 {
     rate = rateHz;
+    started = false;
     return 0;
 }
 
 int ticker_wait(unsigned int cycles)
 {
-    struct timespec ts;
+    // A rate of zero runs unthrottled
+    if (rate == 0) return 0;
+
+    if (!started)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        pending = 0;
+        carry = 0;
+        started = true;
+    }
+
     // rate = Hz (cycles per second)
-    // nanoseconds per cycle = 1,000,000,000 / rate
-    // total nanoseconds = cycles * (nanoseconds per cycle)
-    unsigned long long nanos = ((unsigned long long)cycles * kNanoSeconds) / rate;
-    
-    ts.tv_sec = nanos / kNanoSeconds;
-    ts.tv_nsec = nanos % kNanoSeconds;
-    
-    // Debug output
-    // fprintf(stderr, "ticker_wait: cycles=%u, rate=%u, nanos=%llu, sec=%ld, nsec=%ld\n", 
-    //         cycles, rate, nanos, ts.tv_sec, ts.tv_nsec);
-    
-    nanosleep(&ts, NULL);
+    // nanoseconds = cycles * 1,000,000,000 / rate, carrying the remainder
+    // so that fractional nanoseconds are not lost at high rates
+    unsigned long long scaled = (unsigned long long)cycles * kNanoSeconds + carry;
+    unsigned long long nanos = scaled / rate;
+    carry = scaled % rate;
+
+    deadline.tv_sec += (deadline.tv_nsec + nanos) / kNanoSeconds;
+    deadline.tv_nsec = (deadline.tv_nsec + nanos) % kNanoSeconds;
+
+    pending += nanos;
+    if (pending < kSliceNanoSeconds) return 0;
+    pending = 0;
+
+    struct timespec before, after;
+
+    clock_gettime(CLOCK_MONOTONIC, &before);
+
+    long long ahead = elapsed(deadline, before);
+
+    if (ahead > 0)
+    {
+        // Sleep to the absolute deadline so oversleeping is not compounded
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+        clock_gettime(CLOCK_MONOTONIC, &after);
+
+        waited += elapsed(after, before);
+    }
+    else if (-ahead > kMaxLagNanoSeconds)
+    {
+        deadline = before;
+    }
+
     return 0;
 }
 
+unsigned long long ticker_waited()
+{
+    return waited;
+}
+
 int ticker_cleanup()
 {
     return 0;
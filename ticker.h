@@ -27,9 +27,15 @@
 //
 //   Function definitions simulation of CPU cycle timing (i.e. clock rate).
 //
+//   Each thread keeps a wall-clock deadline that advances by the time its
+//   cycles take at the configured rate. ticker_wait sleeps to that deadline
+//   once it is at least 100 us ahead, so the clock runs in short bursts
+//   rather than sleeping after every instruction.
+//
 
-int ticker_init(unsigned int rateHz); // Hz
+int ticker_init(unsigned int rateHz); // Hz, 0 for unthrottled
 int ticker_wait(unsigned int cycles);
+unsigned long long ticker_waited(); // Nanoseconds the calling thread spent in ticker_wait
 int ticker_cleanup();
 
 #endif
@@ -0,0 +1,206 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Decoder for binary instruction trace files written with --trace-file.
+ *   Prints records in the text trace format, optionally filtered by
+ *   program counter range or opcode, or prints summary statistics.
+ *
+ *   Usage: 6502-trace [-a <first>:<last>] [-o <opcode|mnemonic>] [-s] <filename>
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include "l6502.h"
+#include "itrace.h"
+#include "tracefile.h"
+#include "util.h"
+
+/**
+ * Number of opcodes listed in the statistics
+ */
+static const int kTopOpcodes = 10;
+
+static void usage(const char* name)
+{
+    fprintf(stderr, "Usage: %s [-a <first>:<last>] [-o <opcode|mnemonic>] [-s] <filename>\n", name);
+    fprintf(stderr, "\t-a <first>:<last> to print only records with PC in the range (hexadecimal)\n");
+    fprintf(stderr, "\t-o <opcode|mnemonic> to print only records for the opcode (e.g. a9 or LDAI)\n");
+    fprintf(stderr, "\t-s to print summary statistics instead of records\n");
+}
+
+/**
+ * Resolve an opcode given in hex or as an instruction mnemonic.
+ * Returns -1 if it matches neither.
+ */
+static int parseOpcode(char* str)
+{
+    uppercase(str);
+
+    for (unsigned int op=0; op < 256; op++)
+    {
+        const char* symbol = "";
+        if (opcodeInfo((uint8_t)op, &symbol, 0, 0, 0) && strcmp(symbol, str) == 0) return (int)op;
+    }
+
+    char* end = str;
+    unsigned long value = strtoul(str, &end, 16);
+
+    return (end != str && *end == '\0' && value < 256) ? (int)value : -1;
+}
+
+int main(int argc, char** argv)
+{
+    uint16_t first = 0;
+    uint16_t last = 0xffff;
+    int opcode = -1;
+    bool bStats = false;
+    int chOption;
+
+    initialize(0);
+
+    while ((chOption = getopt(argc, argv, "a:o:sh")) != -1)
+    {
+        switch (chOption)
+        {
+        case 'a':
+            {
+                char* delim = strchr(optarg, ':');
+                if (delim == NULL)
+                {
+                    fprintf(stderr, "Error: address range malformed\n");
+                    return 1;
+                }
+                *delim++ = '\0';
+                first = getHex(uppercase(optarg));
+                last = getHex(uppercase(delim));
+            }
+            break;
+        case 'o':
+            if ((opcode = parseOpcode(optarg)) < 0)
+            {
+                fprintf(stderr, "Error: unknown opcode %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 's':
+            bStats = true;
+            break;
+        case 'h':
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind != argc - 1)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int nStatus = 0;
+    TRACE_READER* reader = tracefile_open(argv[optind], &nStatus);
+
+    if (reader == 0)
+    {
+        fprintf(stderr, "Error: cannot open trace %s: %s\n", argv[optind], strerror(nStatus));
+        return 1;
+    }
+
+    ITRACE_RECORD record;
+    uint64_t counts[256] = {0};
+    uint64_t matched = 0;
+    uint64_t firstCycle = 0;
+    uint64_t lastCycle = 0;
+    std::vector<bool> visited(0x10000, false);
+    char line[128];
+
+    while ((nStatus = tracefile_read(reader, &record)) == 1)
+    {
+        if (record.pc < first || record.pc > last) continue;
+        if (opcode >= 0 && record.opcode != opcode) continue;
+
+        if (bStats)
+        {
+            if (matched == 0) firstCycle = record.cycles;
+            lastCycle = record.cycles;
+            counts[record.opcode]++;
+            visited[record.pc] = true;
+        }
+        else
+        {
+            char* end = itrace_format(line, record);
+            fwrite(line, 1, end - line, stdout);
+        }
+
+        matched++;
+    }
+
+    TRACE_INFO info;
+    tracefile_info(reader, &info);
+    tracefile_close(reader);
+
+    if (nStatus < 0)
+    {
+        fprintf(stderr, "Error: trace is truncated or malformed after %llu records\n",
+            (unsigned long long)info.records);
+    }
+
+    if (bStats)
+    {
+        printf("Records:        %llu (%llu matched)\n", (unsigned long long)info.records, (unsigned long long)matched);
+        printf("Blocks:         %llu%s\n", (unsigned long long)info.blocks,
+            (info.flags & kTraceCompressed) ? " (compressed)" : "");
+        printf("File bytes:     %llu (%.2f per record)\n", (unsigned long long)info.bytes,
+            info.records ? (double)info.bytes / info.records : 0.0);
+        printf("Cycles:         %llu-%llu\n", (unsigned long long)firstCycle, (unsigned long long)lastCycle);
+        printf("Distinct PCs:   %ld\n", (long)std::count(visited.begin(), visited.end(), true));
+
+        std::vector<std::pair<uint64_t, int> > ranked;
+        for (int op=0; op < 256; op++)
+        {
+            if (counts[op]) ranked.push_back(std::make_pair(counts[op], op));
+        }
+        std::sort(ranked.rbegin(), ranked.rend());
+
+        printf("Top opcodes:\n");
+        for (size_t i=0; i < ranked.size() && i < (size_t)kTopOpcodes; i++)
+        {
+            const char* symbol = "";
+            opcodeInfo((uint8_t)ranked[i].second, &symbol, 0, 0, 0);
+            printf("  %02x %-6s %12llu %6.2f%%\n", ranked[i].second, symbol,
+                (unsigned long long)ranked[i].first, 100.0 * ranked[i].first / matched);
+        }
+    }
+
+    cleanup();
+
+    return nStatus < 0 ? 1 : 0;
+}
@@ -0,0 +1,466 @@
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Implementation of binary instruction trace files.
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "l6502.h"
+#include "lz.h"
+#include "tracefile.h"
+
+static const char kMagic[8] = {'6', '5', '0', '2', 'T', 'R', 'C', 'E'};
+static const uint16_t kVersion = 1;
+
+/**
+ * Records per block
+ */
+static const uint32_t kBlockRecords = 8192;
+
+/**
+ * Largest encoded record: mask, opcode, PC and cycle varints, registers
+ */
+static const uint32_t kMaxRecordBytes = 2 + 3 + 10 + 5;
+
+/**
+ * Change mask bits
+ */
+static const uint8_t kChangeA = 0x01;
+static const uint8_t kChangeX = 0x02;
+static const uint8_t kChangeY = 0x04;
+static const uint8_t kChangeSP = 0x08;
+static const uint8_t kChangeP = 0x10;
+static const uint8_t kChangePC = 0x20;
+static const uint8_t kChangeCycles = 0x40;
+static const uint8_t kKeyframe = 0x80;
+
+struct TRACE_WRITER
+{
+    FILE* fp;
+    bool bCompress;
+    uint32_t records;               // Records in the current block
+    ITRACE_RECORD last;             // Previous record in the block
+    std::vector<uint8_t> block;     // Encoded records
+    std::vector<uint8_t> packed;    // Compression buffer
+};
+
+struct TRACE_READER
+{
+    FILE* fp;
+    TRACE_INFO info;
+    uint32_t remaining;             // Records left in the current block
+    ITRACE_RECORD last;
+    std::vector<uint8_t> block;
+    std::vector<uint8_t> packed;
+    size_t pos;                     // Read position in block
+};
+
+static void put16(uint8_t* p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t value)
+{
+    put16(p, (uint16_t)value);
+    put16(p + 2, (uint16_t)(value >> 16));
+}
+
+static uint16_t get16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static void putVarint(std::vector<uint8_t>& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static bool getVarint(const std::vector<uint8_t>& in, size_t* pos, uint64_t* value)
+{
+    *value = 0;
+
+    for (int shift=0; shift < 64; shift += 7)
+    {
+        if (*pos >= in.size()) return false;
+        uint8_t byte = in[(*pos)++];
+        *value |= (uint64_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) return true;
+    }
+
+    return false;
+}
+
+/**
+ * Where the next record's PC and cycle count are expected to be if
+ * execution simply fell through the previous instruction.
+ */
+static void expected(const ITRACE_RECORD& last, uint16_t* pc, uint64_t* cycles)
+{
+    uint8_t bytes = 0;
+    uint8_t count = 0;
+
+    opcodeInfo(last.opcode, 0, 0, &bytes, &count);
+
+    *pc = (uint16_t)(last.pc + bytes);
+    *cycles = last.cycles + count;
+}
+
+/**
+ * Write the current block, compressing it if that makes it smaller.
+ */
+static int flushBlock(TRACE_WRITER* writer)
+{
+    if (writer->records == 0) return 0;
+
+    uint32_t raw = (uint32_t)writer->block.size();
+    const uint8_t* payload = &writer->block[0];
+    uint32_t stored = raw;
+
+    if (writer->bCompress)
+    {
+        writer->packed.resize(raw);
+        int packed = lz_compress(&writer->block[0], (int)raw, &writer->packed[0], (int)raw - 1);
+
+        if (packed > 0)
+        {
+            payload = &writer->packed[0];
+            stored = (uint32_t)packed;
+        }
+    }
+
+    uint8_t header[12];
+    put32(header, writer->records);
+    put32(header + 4, raw);
+    put32(header + 8, stored);
+
+    if (fwrite(header, 1, sizeof header, writer->fp) != sizeof header ||
+        fwrite(payload, 1, stored, writer->fp) != stored) return errno ? errno : EIO;
+
+    writer->records = 0;
+    writer->block.clear();
+
+    return 0;
+}
+
+/**
+ * Create a trace file.
+ */
+TRACE_WRITER* tracefile_create(const char* filename, bool bCompress, int* error)
+{
+    assert(filename && error);
+
+    FILE* fp = fopen(filename, "wb");
+
+    if (fp == NULL)
+    {
+        *error = errno;
+        return 0;
+    }
+
+    uint8_t header[16];
+    memcpy(header, kMagic, sizeof kMagic);
+    put16(header + 8, kVersion);
+    put16(header + 10, bCompress ? kTraceCompressed : 0);
+    put32(header + 12, kBlockRecords);
+
+    if (fwrite(header, 1, sizeof header, fp) != sizeof header)
+    {
+        *error = errno ? errno : EIO;
+        fclose(fp);
+        return 0;
+    }
+
+    TRACE_WRITER* writer = new TRACE_WRITER;
+    writer->fp = fp;
+    writer->bCompress = bCompress;
+    writer->records = 0;
+    writer->block.reserve(kBlockRecords * kMaxRecordBytes);
+
+    return writer;
+}
+
+/**
+ * Append a record.
+ */
+int tracefile_write(TRACE_WRITER* writer, const ITRACE_RECORD& record)
+{
+    assert(writer);
+
+    std::vector<uint8_t>& out = writer->block;
+    const ITRACE_RECORD& last = writer->last;
+    uint8_t mask = kKeyframe | kChangeA | kChangeX | kChangeY | kChangeSP | kChangeP;
+    uint16_t pc = 0;
+    uint64_t cycles = 0;
+
+    if (writer->records != 0)
+    {
+        expected(last, &pc, &cycles);
+
+        mask = 0;
+        if (record.a != last.a) mask |= kChangeA;
+        if (record.x != last.x) mask |= kChangeX;
+        if (record.y != last.y) mask |= kChangeY;
+        if (record.sp != last.sp) mask |= kChangeSP;
+        if (record.p != last.p) mask |= kChangeP;
+        if (record.pc != pc) mask |= kChangePC;
+        if (record.cycles != cycles) mask |= kChangeCycles;
+    }
+
+    out.push_back(mask);
+    out.push_back(record.opcode);
+
+    if (mask & kKeyframe)
+    {
+        out.push_back((uint8_t)record.pc);
+        out.push_back((uint8_t)(record.pc >> 8));
+        putVarint(out, record.cycles);
+    }
+    else
+    {
+        if (mask & kChangePC)
+        {
+            int16_t delta = (int16_t)(record.pc - pc);
+            putVarint(out, (uint16_t)((delta << 1) ^ (delta >> 15)));
+        }
+
+        if (mask & kChangeCycles) putVarint(out, record.cycles - cycles);
+    }
+
+    if (mask & kChangeA) out.push_back(record.a);
+    if (mask & kChangeX) out.push_back(record.x);
+    if (mask & kChangeY) out.push_back(record.y);
+    if (mask & kChangeSP) out.push_back(record.sp);
+    if (mask & kChangeP) out.push_back(record.p);
+
+    writer->last = record;
+
+    return (++writer->records == kBlockRecords) ? flushBlock(writer) : 0;
+}
+
+/**
+ * Flush the last block and close the file.
+ */
+int tracefile_finish(TRACE_WRITER* writer)
+{
+    assert(writer);
+
+    int nStatus = flushBlock(writer);
+
+    if (fclose(writer->fp) != 0 && nStatus == 0) nStatus = errno;
+
+    delete writer;
+
+    return nStatus;
+}
+
+/**
+ * Open a trace file for reading.
+ */
+TRACE_READER* tracefile_open(const char* filename, int* error)
+{
+    assert(filename && error);
+
+    FILE* fp = fopen(filename, "rb");
+
+    if (fp == NULL)
+    {
+        *error = errno;
+        return 0;
+    }
+
+    uint8_t header[16];
+
+    if (fread(header, 1, sizeof header, fp) != sizeof header ||
+        memcmp(header, kMagic, sizeof kMagic) != 0 || get16(header + 8) != kVersion)
+    {
+        *error = EINVAL;
+        fclose(fp);
+        return 0;
+    }
+
+    TRACE_READER* reader = new TRACE_READER;
+    reader->fp = fp;
+    reader->info.version = get16(header + 8);
+    reader->info.flags = get16(header + 10);
+    reader->info.blocks = 0;
+    reader->info.records = 0;
+    reader->info.bytes = sizeof header;
+    reader->remaining = 0;
+    reader->pos = 0;
+
+    return reader;
+}
+
+/**
+ * Read and, if needed, decompress the next block. Returns 1 on success,
+ * 0 at end of file and -1 if the block is malformed.
+ */
+static int readBlock(TRACE_READER* reader)
+{
+    uint8_t header[12];
+    size_t length = fread(header, 1, sizeof header, reader->fp);
+
+    if (length == 0) return 0;
+    if (length != sizeof header) return -1;
+
+    uint32_t records = get32(header);
+    uint32_t raw = get32(header + 4);
+    uint32_t stored = get32(header + 8);
+
+    if (records == 0 || stored > raw || raw > kBlockRecords * kMaxRecordBytes) return -1;
+
+    reader->packed.resize(stored);
+    if (fread(&reader->packed[0], 1, stored, reader->fp) != stored) return -1;
+
+    if (stored < raw)
+    {
+        reader->block.resize(raw);
+        if (lz_decompress(&reader->packed[0], (int)stored, &reader->block[0], (int)raw) != (int)raw) return -1;
+    }
+    else
+    {
+        reader->block.swap(reader->packed);
+    }
+
+    reader->remaining = records;
+    reader->pos = 0;
+    reader->info.blocks++;
+    reader->info.bytes += sizeof header + stored;
+
+    return 1;
+}
+
+/**
+ * Read the next record.
+ */
+int tracefile_read(TRACE_READER* reader, ITRACE_RECORD* record)
+{
+    assert(reader && record);
+
+    if (reader->remaining == 0)
+    {
+        int nStatus = readBlock(reader);
+        if (nStatus <= 0) return nStatus;
+    }
+
+    const std::vector<uint8_t>& in = reader->block;
+    size_t& pos = reader->pos;
+    ITRACE_RECORD& last = reader->last;
+
+    if (pos + 2 > in.size()) return -1;
+
+    uint8_t mask = in[pos++];
+    uint8_t opcode = in[pos++];
+    uint64_t value;
+
+    if (mask & kKeyframe)
+    {
+        if (pos + 2 > in.size()) return -1;
+        last.pc = get16(&in[pos]);
+        pos += 2;
+        if (!getVarint(in, &pos, &value)) return -1;
+        last.cycles = value;
+    }
+    else
+    {
+        uint16_t pc;
+        uint64_t cycles;
+        expected(last, &pc, &cycles);
+
+        if (mask & kChangePC)
+        {
+            if (!getVarint(in, &pos, &value)) return -1;
+            uint16_t zigzag = (uint16_t)value;
+            pc = (uint16_t)(pc + (int16_t)((zigzag >> 1) ^ -(zigzag & 1)));
+        }
+
+        if (mask & kChangeCycles)
+        {
+            if (!getVarint(in, &pos, &value)) return -1;
+            cycles += value;
+        }
+
+        last.pc = pc;
+        last.cycles = cycles;
+    }
+
+    last.opcode = opcode;
+
+    uint8_t* registers[] = {&last.a, &last.x, &last.y, &last.sp, &last.p};
+
+    for (int i=0; i < 5; i++)
+    {
+        if ((mask & (1 << i)) == 0) continue;
+        if (pos >= in.size()) return -1;
+        *registers[i] = in[pos++];
+    }
+
+    reader->remaining--;
+    reader->info.records++;
+
+    *record = last;
+
+    return 1;
+}
+
+/**
+ * Describe the file and what has been read so far.
+ */
+void tracefile_info(const TRACE_READER* reader, TRACE_INFO* info)
+{
+    assert(reader && info);
+
+    *info = reader->info;
+}
+
+/**
+ * Close a trace file opened for reading.
+ */
+void tracefile_close(TRACE_READER* reader)
+{
+    assert(reader);
+
+    fclose(reader->fp);
+
+    delete reader;
+}
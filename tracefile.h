@@ -0,0 +1,120 @@
+#ifndef _TRACEFILE_H_
+#define _TRACEFILE_H_
+/**
+ * @section copyright_sec Copyright and License
+ *
+ * Copyright (c) 1998-2012 Jeff Budzinski
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Purpose:
+ *
+ *   Binary instruction trace files. A file is a 16 byte header followed
+ *   by blocks of records:
+ *
+ *     header  "6502TRCE", uint16 version, uint16 flags, uint32 records
+ *             per block (all integers little-endian)
+ *     block   uint32 records, uint32 raw length, uint32 stored length,
+ *             then the payload, LZ compressed (see lz.h) when the stored
+ *             length is less than the raw length
+ *
+ *   Each record is a change mask byte and the opcode, followed by only
+ *   what the mask says changed: a zigzag varint PC delta when the PC is
+ *   not the previous PC plus the previous instruction's length, a varint
+ *   cycle delta when it is not the previous instruction's cycle count,
+ *   and any changed registers. The first record of every block is a
+ *   keyframe with the absolute PC, cycle count and all registers, so
+ *   blocks decode independently.
+ *
+ *   Encoding and decoding use the instruction table, so initialize()
+ *   must be called first.
+ *
+ */
+
+#include "itrace.h"
+
+/**
+ * Header flag: blocks may be compressed
+ */
+static const uint16_t kTraceCompressed = 0x0001;
+
+typedef struct TRACE_WRITER TRACE_WRITER;
+typedef struct TRACE_READER TRACE_READER;
+
+/**
+ * Summary of an open trace file
+ */
+typedef struct
+{
+    uint16_t version;      // Format version
+    uint16_t flags;        // Header flags
+    uint64_t blocks;       // Blocks read so far
+    uint64_t records;      // Records read so far
+    uint64_t bytes;        // File bytes read so far
+} TRACE_INFO;
+
+/**
+ * Create a trace file.
+ *
+ * @param filename file to create
+ * @param bCompress true to compress blocks
+ * @param error set to the error number on failure
+ * @return TRACE_WRITER* writer, or 0 on failure
+ */
+TRACE_WRITER* tracefile_create(const char* filename, bool bCompress, int* error);
+
+/**
+ * Append a record.
+ * @return int 0 on success; otherwise, error number
+ */
+int tracefile_write(TRACE_WRITER* writer, const ITRACE_RECORD& record);
+
+/**
+ * Flush the last block and close the file.
+ * @return int 0 on success; otherwise, error number
+ */
+int tracefile_finish(TRACE_WRITER* writer);
+
+/**
+ * Open a trace file for reading.
+ *
+ * @param filename file to open
+ * @param error set to the error number on failure
+ * @return TRACE_READER* reader, or 0 on failure
+ */
+TRACE_READER* tracefile_open(const char* filename, int* error);
+
+/**
+ * Read the next record.
+ * @return int 1 if a record was read; 0 at end of file; -1 if the file is
+ *         truncated or malformed
+ */
+int tracefile_read(TRACE_READER* reader, ITRACE_RECORD* record);
+
+/**
+ * Describe the file and what has been read so far.
+ */
+void tracefile_info(const TRACE_READER* reader, TRACE_INFO* info);
+
+/**
+ * Close a trace file opened for reading.
+ */
+void tracefile_close(TRACE_READER* reader);
+
+#endif
@@ -60,3 +60,12 @@ uint16_t getHex(const char* str)
     return value;
 }
 
+/**
+ * Return the time of the given clock in seconds.
+ */
+double clockSeconds(clockid_t clock)
+{
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
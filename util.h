@@ -25,6 +25,8 @@
  *
  */
 
+#include <time.h>
+
 #include "platform.h"
 
 /**
@@ -37,4 +39,10 @@ char* uppercase(char* str);
  */
 uint16_t getHex(const char* str);
 
+/**
+ * Return the time of the given clock in seconds, by default monotonic
+ * wall time for measuring intervals.
+ */
+double clockSeconds(clockid_t clock=CLOCK_MONOTONIC);
+
 #endif